@@ -0,0 +1,36 @@
+#ifndef DIFF_VIEW_BENCH_H
+#define DIFF_VIEW_BENCH_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace diff_view::bench {
+
+/**
+ * Run `fn` `repeats` times and return the fastest run in milliseconds.
+ */
+template <typename Fn>
+double measure_ms(Fn fn, const int repeats = 3) {
+    double best = 0.0;
+    for (int i = 0; i < repeats; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto end = std::chrono::steady_clock::now();
+        const double elapsed = std::chrono::duration<double, std::milli>(end - start).count();
+        best = i == 0 ? elapsed : std::min(best, elapsed);
+    }
+    return best;
+}
+
+inline void print_header(const std::string& title) {
+    std::printf("\n== %s ==\n", title.c_str());
+}
+
+void bench_diff_lines();
+void bench_view_model();
+
+} // namespace diff_view::bench
+
+#endif //DIFF_VIEW_BENCH_H
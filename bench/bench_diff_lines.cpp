@@ -0,0 +1,148 @@
+#include "bench.h"
+#include "diff.h"
+#include "thread_pool.h"
+
+#include <memory_resource>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace diff_view::bench {
+
+namespace {
+
+/**
+ * A C-like function body: unique signature and statements, shared braces and blank lines.
+ */
+std::string make_function(const size_t id, std::mt19937& rng) {
+    std::string text = "int function_" + std::to_string(id) + "(int value) {\n";
+    for (size_t i = 2 + rng() % 12; i > 0; --i) {
+        if (rng() % 4 == 0) {
+            text += "    if (value > " + std::to_string(rng() % 100) + ") {\n";
+            text += "        value -= " + std::to_string(rng() % 10) + ";\n";
+            text += "    }\n";
+        } else {
+            text += "    value = value * " + std::to_string(rng() % 7) + " + " + std::to_string(id) + ";\n";
+        }
+    }
+    text += "    return value;\n}\n\n";
+    return text;
+}
+
+size_t changed_lines(const DiffResult& result) {
+    size_t count = 0;
+    for (const auto& hunk : result.hunks) {
+        for (const auto& [op, length] : hunk.runs) {
+            count += op != DiffOp::Equal ? length : 0;
+        }
+    }
+    return count;
+}
+
+void run_case(const std::string& name, const std::string& old_text, const std::string& new_text) {
+    std::printf("%-28s", name.c_str());
+    for (const auto algorithm : {DiffAlgorithm::Myers, DiffAlgorithm::Patience, DiffAlgorithm::Histogram}) {
+        DiffOptions options;
+        options.algorithm = algorithm;
+        size_t changes = 0;
+        const double ms = measure_ms([&] { changes = changed_lines(diff_lines(old_text, new_text, options)); }, 1);
+        std::printf(" %10.1f ms %8zu", ms, changes);
+    }
+    std::printf("\n");
+}
+
+/**
+ * Myers on a pool of each size, against the serial search.
+ */
+void run_scaling_case(const std::string& name, const std::string& old_text, const std::string& new_text) {
+    DiffOptions options;
+    size_t changes = 0;
+    const double serial = measure_ms([&] { changes = changed_lines(diff_lines(old_text, new_text, options)); }, 1);
+    std::printf("%-28s %8s %10.1f ms %8zu\n", name.c_str(), "serial", serial, changes);
+    for (const size_t threads : {1, 2, 4, 8, 16, 32}) {
+        ThreadPool pool(threads);
+        options.pool = &pool;
+        const double ms = measure_ms([&] { changes = changed_lines(diff_lines(old_text, new_text, options)); }, 1);
+        std::printf("%-28s %8zu %10.1f ms %8zu %6.2fx\n", "", threads, ms, changes, serial / ms);
+    }
+}
+
+/**
+ * Many small file pairs, as a service diffing them one after another would.
+ */
+void run_small_pairs_case(std::mt19937& rng) {
+    std::vector<std::pair<std::string, std::string>> pairs;
+    for (size_t i = 0; i < 20000; ++i) {
+        const auto function = make_function(i, rng);
+        pairs.emplace_back(function, rng() % 2 == 0 ? function : make_function(i, rng));
+    }
+    size_t results = 0;
+    const double free_ms = measure_ms([&] {
+        for (const auto& [old_text, new_text] : pairs) {
+            results += diff_lines(std::string_view(old_text), std::string_view(new_text), 3).hunks.size();
+        }
+    });
+    std::pmr::monotonic_buffer_resource resource;
+    DiffEngine engine(&resource);
+    const double engine_ms = measure_ms([&] {
+        for (const auto& [old_text, new_text] : pairs) {
+            results += engine.edit_runs(old_text, new_text).size();
+        }
+        resource.release();
+    });
+    std::printf("%-28s %10.1f ms (diff_lines) %10.1f ms (DiffEngine::edit_runs) %zu\n", "20000 small pairs", free_ms,
+                engine_ms, results);
+}
+
+} // namespace
+
+void bench_diff_lines() {
+    print_header("diff_lines algorithms (time, changed lines)");
+    std::printf("%-28s %22s %22s %22s\n", "case", "myers", "patience", "histogram");
+    std::mt19937 rng(2024);
+
+    std::vector<std::string> functions;
+    for (size_t i = 0; i < 3000; ++i) {
+        functions.push_back(make_function(i, rng));
+    }
+    std::string original;
+    for (const auto& function : functions) {
+        original += function;
+    }
+
+    // Large refactor: every function moves to a new place
+    auto shuffled = functions;
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+    std::string moved;
+    for (const auto& function : shuffled) {
+        moved += function;
+    }
+    run_case("moved functions", original, moved);
+
+    // Half of the functions rewritten: the remaining common lines are mostly braces
+    std::string rewritten;
+    for (size_t i = 0; i < functions.size(); ++i) {
+        rewritten += i % 2 == 0 ? make_function(i + functions.size(), rng) : functions[i];
+    }
+    run_case("rewritten functions", original, rewritten);
+
+    // Blocks swapped pairwise
+    std::string swapped;
+    for (size_t i = 0; i + 1 < functions.size(); i += 2) {
+        swapped += functions[i + 1] + functions[i];
+    }
+    run_case("swapped neighbours", original, swapped);
+
+    // Few scattered edits: every algorithm should be cheap
+    std::string edited;
+    for (size_t i = 0; i < functions.size(); ++i) {
+        edited += i % 100 == 0 ? make_function(i + 2 * functions.size(), rng) : functions[i];
+    }
+    run_case("scattered edits", original, edited);
+    run_small_pairs_case(rng);
+
+    print_header("parallel myers (threads, time, changed lines, speedup)");
+    run_scaling_case("rewritten functions", original, rewritten);
+}
+
+} // namespace diff_view::bench
@@ -0,0 +1,227 @@
+#include "batch.h"
+#include "bench.h"
+#include "diff_cache.h"
+#include "diff_session.h"
+#include "view_model.h"
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace diff_view::bench {
+
+namespace {
+
+/**
+ * One line of minified JavaScript made of `count` short statements.
+ */
+std::string make_minified_line(const size_t count, std::mt19937& rng) {
+    std::string line;
+    for (size_t i = 0; i < count; ++i) {
+        line += "var a" + std::to_string(rng() % 1000) + "=b.c(" + std::to_string(rng() % 100) + ");";
+    }
+    return line;
+}
+
+/**
+ * Change every `stride`-th statement digit of a line.
+ */
+std::string edit_line(std::string line, const size_t stride, std::mt19937& rng) {
+    for (size_t i = rng() % stride; i < line.size(); i += stride) {
+        if (line[i] >= '0' && line[i] <= '9') {
+            line[i] = static_cast<char>('0' + rng() % 10);
+        }
+    }
+    return line;
+}
+
+void run_case(const std::string& name, const std::string& old_text, const std::string& new_text,
+              ThreadPool* pool = nullptr) {
+    size_t highlights = 0;
+    SimilarityStats stats;
+    ViewOptions options;
+    options.pool = pool;
+    const double ms = measure_ms([&] {
+        LazyViewModel lazy(old_text, new_text, options);
+        stats = lazy.similarity_stats();
+        highlights = std::move(lazy).to_view_model().highlights.size();
+    });
+    std::printf("%-28s %10.1f ms %8zu %8zu/%zu\n", name.c_str(), ms, highlights, stats.avoided(), stats.compared);
+}
+
+void run_char_case(const std::string& name, const std::vector<std::pair<std::string, std::string>>& pairs) {
+    size_t changed = 0, similar = 0;
+    const double diff_ms = measure_ms([&] {
+        changed = 0;
+        for (const auto& [old_line, new_line] : pairs) {
+            changed += diff_char_ranges(old_line, new_line).old_ranges.size();
+        }
+    });
+    const double similar_ms = measure_ms([&] {
+        similar = 0;
+        for (const auto& [old_line, new_line] : pairs) {
+            similar += similar_char_ranges(old_line, new_line, 0.5).has_value();
+        }
+    });
+    std::printf("%-28s %10.1f ms %10.1f ms %8zu\n", name.c_str(), diff_ms, similar_ms, similar);
+}
+
+/**
+ * A changeset of mixed-size files: mostly small, a few large.
+ */
+void run_batch_case(std::mt19937& rng) {
+    std::vector<std::string> texts;
+    for (size_t i = 0; i < 1000; ++i) {
+        const size_t lines = i % 100 == 0 ? 20000 : 10 + rng() % 500;
+        std::string old_text, new_text;
+        for (size_t j = 0; j < lines; ++j) {
+            const auto line = "    auto value" + std::to_string(rng() % 1000) + " = compute(" +
+                              std::to_string(rng() % 10000) + ");";
+            old_text += line + "\n";
+            new_text += (j % 5 == 0 ? edit_line(line, 7, rng) : line) + "\n";
+        }
+        texts.push_back(std::move(old_text));
+        texts.push_back(std::move(new_text));
+    }
+    std::vector<FilePair> pairs;
+    for (size_t i = 0; i < texts.size(); i += 2) {
+        pairs.push_back({texts[i], texts[i + 1]});
+    }
+    size_t rows = 0;
+    const double loop_ms = measure_ms([&] {
+        for (const auto& [old_text, new_text] : pairs) {
+            rows += create_view_model(std::string(old_text), std::string(new_text)).lines.size();
+        }
+    }, 1);
+    ThreadPool pool;
+    BatchOptions options;
+    options.pool = &pool;
+    std::chrono::nanoseconds slowest{0};
+    const double batch_ms = measure_ms([&] {
+        for (const auto& item : create_view_models(pairs, options)) {
+            slowest = std::max(slowest, item.elapsed);
+        }
+    }, 1);
+    std::printf("%-28s %10.1f ms (loop) %10.1f ms (batch on %zu threads, slowest item %.1f ms)\n",
+                "1000 mixed file pairs", loop_ms, batch_ms, pool.size(),
+                std::chrono::duration<double, std::milli>(slowest).count());
+}
+
+} // namespace
+
+/**
+ * Keystrokes typed into the new side of a 50000-line file: a session edit
+ * against a full create_view_model() of the edited texts.
+ */
+void run_session_case(std::mt19937& rng) {
+    std::string old_text, new_text;
+    for (size_t i = 0; i < 50000; ++i) {
+        const auto line = "    auto value" + std::to_string(rng() % 1000) + " = compute(" +
+                          std::to_string(rng() % 10000) + ");";
+        old_text += line + "\n";
+        new_text += (i % 500 == 0 ? edit_line(line, 7, rng) : line) + "\n";
+    }
+    constexpr size_t KEYSTROKES = 50;
+    DiffSession session(old_text, new_text);
+    const double session_ms = measure_ms([&] {
+        for (size_t i = 0; i < KEYSTROKES; ++i) {
+            const size_t pos = session.new_text().find('\n', session.new_text().size() * i / KEYSTROKES);
+            session.apply({DiffSide::New, pos, pos, "x"});
+        }
+    }, 1);
+    const double full_ms = measure_ms([&] {
+        for (size_t i = 0; i < KEYSTROKES; ++i) {
+            const size_t pos = new_text.find('\n', new_text.size() * i / KEYSTROKES);
+            new_text.insert(pos, "x");
+            (void)create_view_model(old_text, new_text);
+        }
+    }, 1);
+    std::printf("%-28s %10.3f ms (session) %10.3f ms (create_view_model) per keystroke\n",
+                "50000 lines", session_ms / KEYSTROKES, full_ms / KEYSTROKES);
+}
+
+/**
+ * The same 50000-line pair viewed again: a cache miss, which builds and
+ * stores the view model, against a hit.
+ */
+void run_cache_case(std::mt19937& rng) {
+    std::string old_text, new_text;
+    for (size_t i = 0; i < 50000; ++i) {
+        const auto line = "    auto value" + std::to_string(rng() % 1000) + " = compute(" +
+                          std::to_string(rng() % 10000) + ");";
+        old_text += line + "\n";
+        new_text += (i % 3 == 0 ? edit_line(line, 7, rng) : line) + "\n";
+    }
+    DiffCache cache;
+    const double miss_ms = measure_ms([&] { (void)cache.view_model(old_text, new_text); }, 1);
+    const double hit_ms = measure_ms([&] { (void)cache.view_model(old_text, new_text); });
+    std::printf("%-28s %10.3f ms (miss) %10.3f ms (hit) %10zu bytes cached\n",
+                "50000 lines", miss_ms, hit_ms, cache.stats().bytes);
+}
+
+void bench_view_model() {
+    print_header("create_view_model (time, inline highlights, char diffs avoided/pairs)");
+    std::mt19937 rng(7);
+
+    // Minified bundles: a few very long lines with scattered small edits
+    for (const size_t statements : {200, 1000, 4000}) {
+        std::string old_text, new_text;
+        for (size_t i = 0; i < 8; ++i) {
+            const auto line = make_minified_line(statements, rng);
+            old_text += line + "\n";
+            new_text += edit_line(line, 97, rng) + "\n";
+        }
+        run_case("minified, " + std::to_string(statements) + " statements", old_text, new_text);
+    }
+
+    // Source code: short lines, a third of them edited in place
+    for (const size_t lines : {10000, 100000}) {
+        std::string old_text, new_text;
+        for (size_t i = 0; i < lines; ++i) {
+            const auto line = "    auto value" + std::to_string(rng() % 1000) + " = compute(items[" +
+                              std::to_string(rng() % 100) + "], offset + " + std::to_string(rng() % 10000) + ");";
+            old_text += line + "\n";
+            new_text += (i % 3 == 0 ? edit_line(line, 7, rng) : line) + "\n";
+        }
+        run_case("source, " + std::to_string(lines) + " lines", old_text, new_text);
+        ThreadPool pool;
+        run_case("  on " + std::to_string(pool.size()) + " threads", old_text, new_text, &pool);
+    }
+
+    // Rewrites: hunks of unrelated lines, where most candidate pairs fail
+    for (const size_t lines : {1000, 10000}) {
+        std::string old_text, new_text;
+        for (size_t i = 0; i < lines; ++i) {
+            old_text += make_minified_line(1 + rng() % 4, rng) + "\n";
+            new_text += (i % 10 == 0 ? edit_line(make_minified_line(3, rng), 13, rng)
+                                     : "  return x" + std::to_string(rng() % 1000) + ";") + "\n";
+        }
+        run_case("rewrite, " + std::to_string(lines) + " lines", old_text, new_text);
+    }
+
+    print_header("batch of view models");
+    run_batch_case(rng);
+
+    print_header("incremental session");
+    run_session_case(rng);
+
+    print_header("diff cache");
+    run_cache_case(rng);
+
+    print_header("character diffs of 100000 line pairs (diff_char_ranges, similar_char_ranges, similar)");
+    for (const bool ascii : {true, false}) {
+        std::vector<std::pair<std::string, std::string>> pairs;
+        for (size_t i = 0; i < 100000; ++i) {
+            auto line = "    auto value" + std::to_string(rng() % 1000) + " = compute(items[" +
+                        std::to_string(rng() % 100) + "], offset + " + std::to_string(rng() % 10000) + ");";
+            if (!ascii) {
+                line += " // é";
+            }
+            pairs.emplace_back(line, i % 2 == 0 ? edit_line(line, 7, rng) : make_minified_line(3, rng));
+        }
+        run_char_case(ascii ? "short ASCII lines" : "short UTF-8 lines", pairs);
+    }
+}
+
+} // namespace diff_view::bench
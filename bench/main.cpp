@@ -0,0 +1,7 @@
+#include "bench.h"
+
+int main() {
+    diff_view::bench::bench_diff_lines();
+    diff_view::bench::bench_view_model();
+    return 0;
+}
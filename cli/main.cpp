@@ -0,0 +1,359 @@
+#include "diff.h"
+#include "mapped_file.h"
+#include "unified_diff.h"
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+using namespace diff_view;
+using Clock = std::chrono::steady_clock;
+
+constexpr int EXIT_SAME = 0;
+constexpr int EXIT_DIFFERENT = 1;
+constexpr int EXIT_TROUBLE = 2;
+
+constexpr std::string_view USAGE =
+    "Usage: diff-view [OPTION]... OLD NEW\n"
+    "Compare two files line by line; '-' reads the standard input.\n"
+    "\n"
+    "  -U, --context=N          show N lines of context (default 3)\n"
+    "  -u                       unified output (the default)\n"
+    "      --algorithm=NAME     myers (default), patience or histogram\n"
+    "      --format=FORMAT      unified (default) or json\n"
+    "      --no-function-names  leave the enclosing function out of hunk headers\n"
+    "      --stats              print sizes and timings to the standard error\n"
+    "  -h, --help               show this help\n"
+    "\n"
+    "Exit status is 0 if the files are the same, 1 if they differ, 2 on trouble.\n";
+
+enum class Format : uint8_t {
+    Unified,
+    Json,
+};
+
+struct Arguments {
+    std::string old_path;
+    std::string new_path;
+    DiffOptions diff;
+    Format format = Format::Unified;
+    bool function_names = true;
+    bool stats = false;
+    bool help = false;
+};
+
+std::optional<size_t> parse_count(const std::string_view text) {
+    size_t value = 0;
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc{} || end != text.data() + text.size() || text.empty()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+std::optional<DiffAlgorithm> parse_algorithm(const std::string_view name) {
+    if (name == "myers") {
+        return DiffAlgorithm::Myers;
+    }
+    if (name == "patience") {
+        return DiffAlgorithm::Patience;
+    }
+    if (name == "histogram") {
+        return DiffAlgorithm::Histogram;
+    }
+    return std::nullopt;
+}
+
+/**
+ * Parse the command line; on failure, `error` describes the bad argument.
+ */
+std::optional<Arguments> parse_arguments(const int argc, char** argv, std::string& error) {
+    Arguments arguments;
+    std::vector<std::string_view> paths;
+    bool options_done = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (options_done || arg == "-" || !arg.starts_with('-')) {
+            paths.push_back(arg);
+            continue;
+        }
+        if (arg == "--") {
+            options_done = true;
+            continue;
+        }
+        // Split "--name=value" and "-Uvalue"; other options take the next argument
+        std::string_view name = arg;
+        std::optional<std::string_view> value;
+        if (arg.starts_with("--")) {
+            if (const size_t equal = arg.find('='); equal != std::string_view::npos) {
+                name = arg.substr(0, equal);
+                value = arg.substr(equal + 1);
+            }
+        } else if (arg.size() > 2) {
+            name = arg.substr(0, 2);
+            value = arg.substr(2);
+        }
+        const auto take_value = [&]() -> std::optional<std::string_view> {
+            if (value) {
+                return value;
+            }
+            if (i + 1 < argc) {
+                return std::string_view(argv[++i]);
+            }
+            error = "option '" + std::string(name) + "' requires a value";
+            return std::nullopt;
+        };
+        if (name == "-h" || name == "--help") {
+            arguments.help = true;
+        } else if (name == "-u") {
+            // Unified output is the default; accepted for compatibility with diff
+        } else if (name == "--no-function-names") {
+            arguments.function_names = false;
+        } else if (name == "--stats") {
+            arguments.stats = true;
+        } else if (name == "-U" || name == "--context" || name == "--unified") {
+            const auto text = take_value();
+            if (!text) {
+                return std::nullopt;
+            }
+            const auto count = parse_count(*text);
+            if (!count) {
+                error = "invalid context length '" + std::string(*text) + "'";
+                return std::nullopt;
+            }
+            arguments.diff.context_lines = *count;
+        } else if (name == "--algorithm") {
+            const auto text = take_value();
+            if (!text) {
+                return std::nullopt;
+            }
+            const auto algorithm = parse_algorithm(*text);
+            if (!algorithm) {
+                error = "unknown algorithm '" + std::string(*text) + "'";
+                return std::nullopt;
+            }
+            arguments.diff.algorithm = *algorithm;
+        } else if (name == "--format") {
+            const auto text = take_value();
+            if (!text) {
+                return std::nullopt;
+            }
+            if (*text == "unified") {
+                arguments.format = Format::Unified;
+            } else if (*text == "json") {
+                arguments.format = Format::Json;
+            } else {
+                error = "unknown format '" + std::string(*text) + "'";
+                return std::nullopt;
+            }
+        } else {
+            error = "unrecognized option '" + std::string(arg) + "'";
+            return std::nullopt;
+        }
+    }
+    if (arguments.help) {
+        return arguments;
+    }
+    if (paths.size() != 2) {
+        error = paths.size() < 2 ? "missing operand" : "extra operand '" + std::string(paths[2]) + "'";
+        return std::nullopt;
+    }
+    arguments.old_path = paths[0];
+    arguments.new_path = paths[1];
+    return arguments;
+}
+
+void write(const std::string_view text) {
+    std::fwrite(text.data(), 1, text.size(), stdout);
+}
+
+/**
+ * Write a JSON string literal. Bytes of 0x80 and above are copied as they
+ * are, so valid UTF-8 input gives valid JSON.
+ */
+void write_json_string(const std::string_view text) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    std::fputc('"', stdout);
+    size_t plain = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const auto c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        write(text.substr(plain, i - plain));
+        plain = i + 1;
+        switch (c) {
+            case '"':
+                write("\\\"");
+                break;
+            case '\\':
+                write("\\\\");
+                break;
+            case '\n':
+                write("\\n");
+                break;
+            case '\r':
+                write("\\r");
+                break;
+            case '\t':
+                write("\\t");
+                break;
+            default: {
+                const char escape[] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF]};
+                write({escape, sizeof(escape)});
+                break;
+            }
+        }
+    }
+    write(text.substr(plain));
+    std::fputc('"', stdout);
+}
+
+void write_json_line(const char* op, const size_t old_no, const size_t new_no, const std::string_view text) {
+    write("{\"op\":\"");
+    write(op);
+    write("\",\"old\":");
+    write(old_no == 0 ? "null" : std::to_string(old_no));
+    write(",\"new\":");
+    write(new_no == 0 ? "null" : std::to_string(new_no));
+    write(",\"text\":");
+    write_json_string(text);
+    write("}");
+}
+
+/**
+ * Write the result as one JSON object; line numbers are 1-based, line texts
+ * keep their line endings.
+ */
+void write_json(const Arguments& arguments, const DiffResult& result) {
+    write("{\"old_path\":");
+    write_json_string(arguments.old_path);
+    write(",\"new_path\":");
+    write_json_string(arguments.new_path);
+    write(",\"approximate\":");
+    write(result.approximate ? "true" : "false");
+    write(",\"hunks\":[");
+    for (size_t h = 0; h < result.hunks.size(); ++h) {
+        const auto& hunk = result.hunks[h];
+        write(h == 0 ? "\n" : ",\n");
+        write("{\"old_start\":" + std::to_string(hunk.old_start + 1) +
+              ",\"old_count\":" + std::to_string(hunk.old_count) +
+              ",\"new_start\":" + std::to_string(hunk.new_start + 1) +
+              ",\"new_count\":" + std::to_string(hunk.new_count) + ",\"lines\":[");
+        size_t old_index = hunk.old_start;
+        size_t new_index = hunk.new_start;
+        bool first = true;
+        for (const auto& [op, length] : hunk.runs) {
+            for (size_t i = 0; i < length; ++i) {
+                write(first ? "\n" : ",\n");
+                first = false;
+                switch (op) {
+                    case DiffOp::Equal:
+                        write_json_line("equal", old_index + 1, new_index + 1, result.old_lines[old_index]);
+                        ++old_index;
+                        ++new_index;
+                        break;
+                    case DiffOp::Delete:
+                        write_json_line("delete", old_index + 1, 0, result.old_lines[old_index]);
+                        ++old_index;
+                        break;
+                    case DiffOp::Insert:
+                        write_json_line("insert", 0, new_index + 1, result.new_lines[new_index]);
+                        ++new_index;
+                        break;
+                }
+            }
+        }
+        write("]}");
+    }
+    write("]}\n");
+}
+
+double elapsed_ms(const Clock::time_point start, const Clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void print_stats(const Arguments& arguments, const MappedFile& old_file, const MappedFile& new_file,
+                 const DiffResult& result, const double read_ms, const double diff_ms, const double write_ms) {
+    size_t deleted = 0;
+    size_t inserted = 0;
+    for (const auto& hunk : result.hunks) {
+        for (const auto& [op, length] : hunk.runs) {
+            deleted += op == DiffOp::Delete ? length : 0;
+            inserted += op == DiffOp::Insert ? length : 0;
+        }
+    }
+    const auto print_file = [](const char* side, const std::string& path, const MappedFile& file,
+                               const LineTable& lines) {
+        std::fprintf(stderr, "%s: %s, %zu bytes, %zu lines, %s\n", side, path.c_str(), file.text().size(),
+                     lines.size(), file.mapped() ? "mapped" : "read");
+    };
+    print_file("old", arguments.old_path, old_file, result.old_lines);
+    print_file("new", arguments.new_path, new_file, result.new_lines);
+    std::fprintf(stderr, "hunks: %zu, -%zu +%zu lines%s\n", result.hunks.size(), deleted, inserted,
+                 result.approximate ? " (approximate)" : "");
+    std::fprintf(stderr, "time: read %.3f ms, diff %.3f ms, write %.3f ms\n", read_ms, diff_ms, write_ms);
+}
+
+} // namespace
+
+int main(const int argc, char** argv) {
+    std::string error;
+    const auto arguments = parse_arguments(argc, argv, error);
+    if (!arguments) {
+        std::fprintf(stderr, "diff-view: %s\nTry 'diff-view --help' for more information.\n", error.c_str());
+        return EXIT_TROUBLE;
+    }
+    if (arguments->help) {
+        write(USAGE);
+        return EXIT_SAME;
+    }
+
+    const auto read_start = Clock::now();
+    const auto old_file = MappedFile::open(arguments->old_path, &error);
+    if (!old_file) {
+        std::fprintf(stderr, "diff-view: %s\n", error.c_str());
+        return EXIT_TROUBLE;
+    }
+    const auto new_file = MappedFile::open(arguments->new_path, &error);
+    if (!new_file) {
+        std::fprintf(stderr, "diff-view: %s\n", error.c_str());
+        return EXIT_TROUBLE;
+    }
+
+    // The tables view the mapped files; lines keep their endings, as in diff
+    const auto diff_start = Clock::now();
+    const auto result = diff_lines(LineTable::view_with_endings(old_file->text()),
+                                   LineTable::view_with_endings(new_file->text()), arguments->diff);
+
+    const auto write_start = Clock::now();
+    bool written = true;
+    if (arguments->format == Format::Json) {
+        static char buffer[1 << 16];
+        std::setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+        write_json(*arguments, result);
+        written = std::fflush(stdout) == 0 && !std::ferror(stdout);
+    } else {
+        // Streamed from the mapped files straight to the descriptor
+        const UnifiedDiffOptions options{arguments->old_path, arguments->new_path, arguments->function_names};
+        written = write_unified_diff(result, options, fileno(stdout));
+    }
+    const auto write_end = Clock::now();
+    if (!written) {
+        std::fprintf(stderr, "diff-view: write error\n");
+        return EXIT_TROUBLE;
+    }
+
+    if (arguments->stats) {
+        print_stats(*arguments, *old_file, *new_file, result, elapsed_ms(read_start, diff_start),
+                    elapsed_ms(diff_start, write_start), elapsed_ms(write_start, write_end));
+    }
+    return result.hunks.empty() ? EXIT_SAME : EXIT_DIFFERENT;
+}
@@ -0,0 +1,50 @@
+#ifndef DIFF_VIEW_ANCHORED_DIFF_H
+#define DIFF_VIEW_ANCHORED_DIFF_H
+
+#include "diff.h"
+#include "line_intern.h"
+#include "myers.h"
+
+#include <vector>
+
+namespace diff_view {
+
+/**
+ * Patience diff on interned lines.
+ *
+ * Lines that occur exactly once on both sides of a region are matched, the
+ * longest increasing sequence of those matches becomes the anchors, and the
+ * gaps between anchors are diffed recursively. Regions without unique common
+ * lines fall back to Myers.
+ *
+ * @param interned Class IDs of both sides (see intern_lines).
+ * @param options Budget for the Myers fallback; the deadline and the cancel
+ *                token also stop the anchoring, every few regions, and the
+ *                progress covers both (default: unbounded).
+ * @param approximate If not null, set to whether a budget was hit.
+ * @return Runs of steps, like myers_edit_runs.
+ */
+std::vector<EditRun> patience_diff(const InternedLines& interned, const MyersOptions& options = {},
+                                   bool* approximate = nullptr);
+
+/**
+ * Histogram diff on interned lines (as in git).
+ *
+ * In each region, the longest common run that contains the lowest-occurrence
+ * line of the old side is used as the anchor, and both sides of it are diffed
+ * recursively. Only regions without a common line that occurs rarely enough
+ * fall back to Myers, so the expensive search runs on small gaps.
+ *
+ * @param interned Class IDs of both sides (see intern_lines).
+ * @param options Budget for the Myers fallback; the deadline and the cancel
+ *                token also stop the anchoring, every few regions, and the
+ *                progress covers both (default: unbounded).
+ * @param approximate If not null, set to whether a budget was hit.
+ * @return Runs of steps, like myers_edit_runs.
+ */
+std::vector<EditRun> histogram_diff(const InternedLines& interned, const MyersOptions& options = {},
+                                    bool* approximate = nullptr);
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_ANCHORED_DIFF_H
@@ -0,0 +1,76 @@
+#ifndef DIFF_VIEW_BATCH_H
+#define DIFF_VIEW_BATCH_H
+
+#include "thread_pool.h"
+#include "view_model.h"
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace diff_view {
+
+/**
+ * One (old, new) pair of a batch. The texts are not copied by the batch;
+ * they must stay valid until it returns.
+ */
+struct FilePair {
+    std::string_view old_text;
+    std::string_view new_text;
+};
+
+struct BatchOptions {
+    // Options of every view model; the pools in it are set by the batch
+    ViewOptions view;
+    // Run the batch on this pool (nullptr = on the calling thread)
+    ThreadPool* pool = nullptr;
+    // Pairs of at least this many bytes (old + new) are built one at a time
+    // with the whole pool, their line diff included (see DiffOptions::pool)
+    size_t split_bytes = size_t{4} << 20;
+    // Smaller pairs are grouped into tasks of about this many bytes
+    size_t group_bytes = size_t{256} << 10;
+};
+
+/**
+ * A view model built by a batch.
+ */
+struct BatchItem {
+    ViewModel view_model;
+    // Wall-clock time spent building this pair
+    std::chrono::nanoseconds elapsed{0};
+};
+
+/**
+ * Build the view models of many file pairs, spread over a pool.
+ *
+ * Large pairs are built one after another, each with the whole pool. The
+ * others are grouped into tasks, largest pairs first, that threads take as
+ * they free up, so a mix of sizes keeps every thread busy. Each view model is
+ * the one create_view_model() builds with the same options; only the large
+ * pairs may get a different, equally minimal, line diff from the pool.
+ *
+ * @param pairs The file pairs.
+ * @param options View options, pool and task sizes.
+ * @param on_done Called once per pair as soon as it is built, with its
+ *                index in `pairs`. Calls may come from the calling thread
+ *                (large pairs) or the pool threads, concurrently, so it must
+ *                not rely on running on a given thread.
+ */
+void create_view_models(std::span<const FilePair> pairs, const BatchOptions& options,
+                        const std::function<void(size_t, BatchItem&&)>& on_done);
+
+/**
+ * Same as above, with the results collected in the order of `pairs`.
+ *
+ * @param pairs The file pairs.
+ * @param options View options, pool and task sizes.
+ * @return One item per pair.
+ */
+std::vector<BatchItem> create_view_models(std::span<const FilePair> pairs, const BatchOptions& options = {});
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_BATCH_H
@@ -0,0 +1,71 @@
+#ifndef DIFF_VIEW_BIT_LCS_H
+#define DIFF_VIEW_BIT_LCS_H
+
+#include "diff.h"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace diff_view {
+
+/**
+ * Longest common subsequence of two byte strings, 64 bytes of the old string
+ * per machine word (Allison-Dix / Hyyrö bit-vector algorithm).
+ *
+ * Each byte of the new string updates the whole column of LCS differences
+ * with a few word operations, O(N * M / 64) in total regardless of how
+ * different the strings are. The columns are kept, so an alignment can be
+ * read back in O(N + M) steps.
+ */
+class BitLcs {
+public:
+    // Longest string on either side; the columns take (M + 1) * N / 64 words
+    static constexpr size_t MAX_LENGTH = 1024;
+
+    BitLcs() = default;
+
+    /**
+     * @param old_str The original string, at most MAX_LENGTH bytes.
+     * @param new_str The new string, at most MAX_LENGTH bytes.
+     */
+    BitLcs(std::string_view old_str, std::string_view new_str);
+
+    /**
+     * Recompute for another pair of strings, reusing the memory of the columns.
+     *
+     * @param old_str The original string, at most MAX_LENGTH bytes.
+     * @param new_str The new string, at most MAX_LENGTH bytes.
+     */
+    void assign(std::string_view old_str, std::string_view new_str);
+
+    /** Number of bytes in a longest common subsequence. */
+    [[nodiscard]] size_t length() const { return length_; }
+
+    /**
+     * A minimal edit script over bytes. Matches are taken as early as
+     * possible and deletions come before insertions in a change.
+     *
+     * @return Runs of steps; adjacent runs have different ops.
+     */
+    [[nodiscard]] std::vector<EditRun> edit_runs() const;
+
+    /** Same as edit_runs(), appended to `runs` so that its memory is reused. */
+    void edit_runs(std::vector<EditRun>& runs) const;
+
+private:
+    std::string_view old_str_;
+    std::string_view new_str_;
+    size_t words_ = 0;
+    size_t length_ = 0;
+    // Match masks of the bytes of the old string, words_ words each
+    std::vector<uint64_t> masks_;
+    // Column q covers the last q bytes of the new string: bit p of it is set
+    // when the last p + 1 bytes of the old string have the same LCS with
+    // them as the last p bytes
+    std::vector<uint64_t> columns_;
+};
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_BIT_LCS_H
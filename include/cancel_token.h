@@ -0,0 +1,41 @@
+#ifndef DIFF_VIEW_CANCEL_TOKEN_H
+#define DIFF_VIEW_CANCEL_TOKEN_H
+
+#include <atomic>
+#include <chrono>
+
+namespace diff_view {
+
+/**
+ * Asks the diffs it is given to (see DiffOptions::cancel) to stop early.
+ *
+ * cancel() may be called from any thread while they run. With a deadline the
+ * token also counts as cancelled once the deadline has passed. Diffs check it
+ * at coarse points, every few search steps, line pairs or hunks.
+ */
+class CancelToken {
+public:
+    CancelToken() = default;
+
+    /** A token that cancels itself at `deadline`. */
+    explicit CancelToken(const std::chrono::steady_clock::time_point deadline) : deadline_(deadline) {}
+
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+    /** Whether cancel() was called or the deadline passed; reads the clock if there is a deadline. */
+    [[nodiscard]] bool cancelled() const {
+        if (cancelled_.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        return deadline_ != std::chrono::steady_clock::time_point::max() &&
+               std::chrono::steady_clock::now() >= deadline_;
+    }
+
+private:
+    std::atomic<bool> cancelled_{false};
+    std::chrono::steady_clock::time_point deadline_ = std::chrono::steady_clock::time_point::max();
+};
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_CANCEL_TOKEN_H
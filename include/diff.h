@@ -1,19 +1,66 @@
 #ifndef DIFF_VIEW_DIFF_H
 #define DIFF_VIEW_DIFF_H
 
+#include "cancel_token.h"
+#include "line_table.h"
+
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
 
 namespace diff_view {
 
+class PhaseProgress;
+class ThreadPool;
+
 enum class DiffOp : uint8_t {
     Equal,
     Delete,
     Insert,
 };
 
+/**
+ * `length` consecutive steps of the same operation. Line indices are implicit:
+ * Equal and Delete consume old lines, Equal and Insert consume new lines.
+ */
+struct EditRun {
+    DiffOp op;
+    size_t length;
+
+    bool operator==(const EditRun&) const = default;
+};
+
+/**
+ * Append `length` steps of `op`, extending the last run when it has the same op.
+ */
+inline void append_run(std::vector<EditRun>& runs, const DiffOp op, const size_t length) {
+    if (length == 0) {
+        return;
+    }
+    if (!runs.empty() && runs.back().op == op) {
+        runs.back().length += length;
+    } else {
+        runs.push_back({op, length});
+    }
+}
+
+/**
+ * Expand runs into one DiffOp per step.
+ */
+inline std::vector<DiffOp> expand_runs(const std::vector<EditRun>& runs) {
+    std::vector<DiffOp> script;
+    for (const auto& [op, length] : runs) {
+        script.insert(script.end(), length, op);
+    }
+    return script;
+}
+
 struct DiffLine {
     DiffOp op;
     size_t old_index;
@@ -23,26 +70,114 @@ struct DiffLine {
 /**
  * A contiguous block of changes with optional context lines.
  *
- * Lines are ordered: context (Equal) -> deletions -> insertions -> context.
- * Adjacent Delete/Insert pairs represent modified lines (for char-level diff).
+ * The runs start at (old_start, new_start) and cover old_count old lines and
+ * new_count new lines. Adjacent Delete/Insert runs represent modified lines
+ * (for char-level diff).
+ * A hunk without old lines has old_start at the insertion point.
  */
 struct DiffHunk {
     size_t old_start;
     size_t old_count;
     size_t new_start;
     size_t new_count;
-    std::vector<DiffLine> lines;
+    std::vector<EditRun> runs;
+
+    bool operator==(const DiffHunk&) const = default;
 };
 
+/**
+ * Expand a hunk into one DiffLine per step, with explicit line indices.
+ * The index of the side a step does not consume is SIZE_MAX.
+ *
+ * @param hunk The hunk to expand.
+ * @return One DiffLine per line of the hunk.
+ */
+std::vector<DiffLine> expand_hunk(const DiffHunk& hunk);
+
+/**
+ * Group the changes of an edit script into hunks with context, the way
+ * diff_lines() does.
+ *
+ * @param runs Runs of steps over all lines.
+ * @param context_lines Number of context lines around changes.
+ * @return The hunks.
+ */
+std::vector<DiffHunk> hunks_from_runs(const std::vector<EditRun>& runs, size_t context_lines);
+
+/**
+ * Result of a line-level diff.
+ *
+ * The line tables share the storage (or the viewed buffers) of the tables
+ * passed to diff_lines; see LineTable for the lifetime rules.
+ */
 struct DiffResult {
-    std::vector<std::string> old_lines;
-    std::vector<std::string> new_lines;
+    LineTable old_lines;
+    LineTable new_lines;
     std::vector<DiffHunk> hunks;
+    // Set when a cost or time budget was hit and the hunks may not be minimal
+    bool approximate = false;
+    // Set when the diff was cancelled (see DiffOptions::cancel); hunks is empty
+    bool cancelled = false;
+};
+
+/**
+ * Line diff algorithms, as offered by git.
+ */
+enum class DiffAlgorithm : uint8_t {
+    Myers,      // Minimal edit script
+    Patience,   // Anchors on lines unique to both sides
+    Histogram,  // Anchors on the lowest-occurrence lines, Myers only on the gaps
+};
+
+/**
+ * Phases of a diff reported to DiffOptions::progress.
+ */
+enum class DiffPhase : uint8_t {
+    Lines,       // The line diff
+    Pairing,     // Deciding which deleted and inserted lines share a row
+    Highlights,  // Building rows and inline highlights
+};
+
+/**
+ * Told the phase and the fraction of it done (0 to 1) as a diff runs. Each
+ * phase reports 0 first and, unless cancelled, 1 last; calls are serialized,
+ * but may come from pool threads.
+ *
+ * The callback runs in the middle of the line search, while the engine of
+ * the call (see DiffEngine) holds its scratch memory. It may run other diffs
+ * through the free functions, which then use another engine of the thread,
+ * but must not use the engine running the call.
+ */
+using DiffProgress = std::function<void(DiffPhase phase, double fraction)>;
+
+struct DiffOptions {
+    size_t context_lines = 3;
+    DiffAlgorithm algorithm = DiffAlgorithm::Myers;
+    // Edit cost explored by one Myers search before it falls back to a
+    // heuristic split (0 = unbounded, always minimal)
+    size_t max_cost = 0;
+    // Wall-clock budget for the search; once exceeded, the remaining changed
+    // regions are reported as whole replacements (0 = unbounded)
+    std::chrono::milliseconds time_budget{0};
+    // Run the Myers searches of large regions on this pool (nullptr = on the
+    // calling thread). The script stays minimal but may align differently.
+    ThreadPool* pool = nullptr;
+    // Regions with fewer lines (old + new) than this are searched serially
+    size_t parallel_threshold = size_t{1} << 14;
+    // Stop as soon as this token is cancelled (nullptr = never); unlike
+    // time_budget, the result is then empty and marked cancelled. The token
+    // must outlive the call.
+    const CancelToken* cancel = nullptr;
+    // Progress of the call (empty = not reported)
+    DiffProgress progress{};
 };
 
 /**
  * Compute line-level diff between two texts using Myers algorithm.
  *
+ * The texts are not copied: the line tables of the result view them, so both
+ * texts must outlive the result.
+ *
  * @param old_text The original text.
  * @param new_text The new text.
  * @param context_lines Number of context lines around changes (default: 3).
@@ -50,9 +185,43 @@ struct DiffResult {
  */
 DiffResult diff_lines(std::string_view old_text, std::string_view new_text, size_t context_lines = 3);
 
+/**
+ * Compute line-level diff between two line tables.
+ *
+ * @param old_lines Lines of the old text.
+ * @param new_lines Lines of the new text.
+ * @param context_lines Number of context lines around changes (default: 3).
+ * @return DiffResult containing hunks; its line tables are the given ones.
+ */
+DiffResult diff_lines(LineTable old_lines, LineTable new_lines, size_t context_lines = 3);
+
+/**
+ * Compute line-level diff between two texts with the given options.
+ *
+ * The texts are not copied; both must outlive the result.
+ *
+ * @param old_text The original text.
+ * @param new_text The new text.
+ * @param options Algorithm, number of context lines and search budget.
+ * @return DiffResult containing hunks and line data.
+ */
+DiffResult diff_lines(std::string_view old_text, std::string_view new_text, const DiffOptions& options);
+
+/**
+ * Compute line-level diff between two line tables with the given options.
+ *
+ * @param old_lines Lines of the old text.
+ * @param new_lines Lines of the new text.
+ * @param options Algorithm, number of context lines and search budget.
+ * @return DiffResult containing hunks; its line tables are the given ones.
+ */
+DiffResult diff_lines(LineTable old_lines, LineTable new_lines, const DiffOptions& options);
+
 /**
  * Compute line-level diff between two pre-split line vectors.
  *
+ * The lines are copied into owning line tables.
+ *
  * @param old_lines Lines from old text.
  * @param new_lines Lines from new text.
  * @param context_lines Number of context lines around changes (default: 3).
@@ -71,7 +240,28 @@ struct CharDiffResult {
 };
 
 /**
- * Compute character-level diff between two strings using Myers algorithm.
+ * Byte range [begin, end) of one side of a character diff.
+ */
+struct CharDiffRange {
+    DiffOp op;
+    uint32_t begin;
+    uint32_t end;
+};
+
+/**
+ * Character diff as byte ranges into the compared strings. Ranges cover each
+ * string in order, end on grapheme cluster boundaries, and adjacent ranges
+ * have different ops.
+ */
+struct CharDiffRanges {
+    std::vector<CharDiffRange> old_ranges;
+    std::vector<CharDiffRange> new_ranges;
+};
+
+/**
+ * Compute character-level diff between two strings using Myers algorithm
+ * over grapheme clusters. Strings of at most BitLcs::MAX_LENGTH bytes whose
+ * clusters are all single bytes (ASCII) use the bit-parallel LCS instead.
  *
  * @param old_str The original string.
  * @param new_str The new string.
@@ -79,6 +269,142 @@ struct CharDiffResult {
  */
 CharDiffResult diff_chars(std::string_view old_str, std::string_view new_str);
 
+/**
+ * Compute character-level diff between two strings as byte ranges.
+ * Same diff as diff_chars, without copying the segment texts.
+ *
+ * @param old_str The original string.
+ * @param new_str The new string.
+ * @return CharDiffRanges with ranges for both old and new strings.
+ */
+CharDiffRanges diff_char_ranges(std::string_view old_str, std::string_view new_str);
+
+/**
+ * Similarity of the two strings of a character diff: equal bytes divided by
+ * the length of the longer string, 1.0 when both are empty.
+ *
+ * @param ranges Result of diff_char_ranges.
+ * @return A value between 0.0 (completely different) and 1.0 (identical).
+ */
+double char_similarity(const CharDiffRanges& ranges);
+
+/**
+ * How the pairs given to similar_char_ranges() were decided.
+ */
+struct SimilarityStats {
+    size_t compared = 0;
+    size_t length_rejected = 0;    // The shorter string is too short
+    size_t bytes_rejected = 0;     // Too few bytes in common, whatever their order
+    size_t distance_rejected = 0;  // The character diff stopped at the edit distance bound
+    size_t lcs_rejected = 0;       // The bit-parallel LCS is too short, no alignment was built
+
+    /** Number of pairs rejected without a full character diff. */
+    [[nodiscard]] size_t avoided() const {
+        return length_rejected + bytes_rejected + distance_rejected + lcs_rejected;
+    }
+
+    SimilarityStats& operator+=(const SimilarityStats& other) {
+        compared += other.compared;
+        length_rejected += other.length_rejected;
+        bytes_rejected += other.bytes_rejected;
+        distance_rejected += other.distance_rejected;
+        lcs_rejected += other.lcs_rejected;
+        return *this;
+    }
+};
+
+/**
+ * The character diff of two strings if their char_similarity() reaches the
+ * threshold. Same decision and ranges as diff_char_ranges(), but cheap upper
+ * bounds on the equal bytes reject most dissimilar pairs before the strings
+ * are segmented, and the diff itself stops once the edit distance rules the
+ * threshold out.
+ *
+ * @param old_str The original string.
+ * @param new_str The new string.
+ * @param threshold Minimum similarity.
+ * @param stats If not null, updated with how the pair was decided.
+ * @return The character diff, or nullopt if the strings are not similar enough.
+ */
+std::optional<CharDiffRanges> similar_char_ranges(std::string_view old_str, std::string_view new_str,
+                                                  double threshold, SimilarityStats* stats = nullptr);
+
+/**
+ * Runs diffs with scratch memory kept across calls.
+ *
+ * The interning table, class IDs, Myers frontiers and traces, edit scripts,
+ * grapheme clusters and LCS columns grow to the largest problem seen and are
+ * reused afterwards, so a stream of small diffs does not allocate for them.
+ * The free functions above run on a thread-local engine (see local()).
+ *
+ * An engine must not be used by several threads at once.
+ */
+class DiffEngine {
+public:
+    /**
+     * @param resource Memory for the results of edit_runs().
+     */
+    explicit DiffEngine(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    ~DiffEngine();
+    DiffEngine(const DiffEngine&) = delete;
+    DiffEngine& operator=(const DiffEngine&) = delete;
+
+    /**
+     * The engine of the calling thread, used by the free functions. While it
+     * runs diff_lines(), e.g. when a progress callback diffs again, another
+     * engine of the thread is returned.
+     */
+    static DiffEngine& local();
+
+    /** Same as the free diff_lines() on line tables. */
+    DiffResult diff_lines(LineTable old_lines, LineTable new_lines, const DiffOptions& options = {});
+
+    /**
+     * Line-level edit script of two texts, without building hunks. The texts
+     * are indexed into tables kept by the engine.
+     *
+     * @param old_text The original text.
+     * @param new_text The new text.
+     * @param options Algorithm and search budget; context_lines and progress
+     *                are unused. After a cancellation the runs may not cover
+     *                the texts; check the token.
+     * @param approximate If not null, set to whether a budget was hit.
+     * @return Runs of steps over all lines, allocated from the engine's resource.
+     */
+    std::pmr::vector<EditRun> edit_runs(std::string_view old_text, std::string_view new_text,
+                                        const DiffOptions& options = {}, bool* approximate = nullptr);
+
+    /** Same as above, on lines that are already indexed. */
+    std::pmr::vector<EditRun> edit_runs(const LineTable& old_lines, const LineTable& new_lines,
+                                        const DiffOptions& options = {}, bool* approximate = nullptr);
+
+    /** Same as the free diff_char_ranges(). */
+    CharDiffRanges diff_char_ranges(std::string_view old_str, std::string_view new_str);
+
+    /** Same as the free similar_char_ranges(). */
+    std::optional<CharDiffRanges> similar_char_ranges(std::string_view old_str, std::string_view new_str,
+                                                      double threshold, SimilarityStats* stats = nullptr);
+
+    /** Free the scratch memory kept so far. */
+    void release();
+
+    [[nodiscard]] std::pmr::memory_resource* resource() const { return resource_; }
+
+private:
+    struct Scratch;
+
+    /**
+     * Edit script of two line tables into the scratch script, advancing
+     * `progress` by the lines placed (if not null).
+     */
+    void line_script(const LineTable& old_lines, const LineTable& new_lines, const DiffOptions& options,
+                     bool& approximate, PhaseProgress* progress = nullptr);
+
+    std::pmr::memory_resource* resource_;
+    std::unique_ptr<Scratch> scratch_;
+    bool busy_ = false;  // In diff_lines(), which calls back into user code
+};
+
 } // namespace diff_view
 
 #endif //DIFF_VIEW_DIFF_H
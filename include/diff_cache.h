@@ -0,0 +1,103 @@
+#ifndef DIFF_VIEW_DIFF_CACHE_H
+#define DIFF_VIEW_DIFF_CACHE_H
+
+#include "diff.h"
+#include "sha256.h"
+#include "view_model.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace diff_view {
+
+struct DiffCacheOptions {
+    // Size of the entries kept in memory, in encoded bytes; the least
+    // recently used ones are dropped beyond it
+    size_t byte_budget = size_t{64} << 20;
+    // Also store every entry as a file in this directory, so that entries
+    // survive restarts and can be shared between processes (empty = memory
+    // only). The directory must exist and is never pruned.
+    std::string directory;
+};
+
+struct DiffCacheStats {
+    uint64_t hits = 0;       // Found in memory
+    uint64_t disk_hits = 0;  // Found in the directory and loaded into memory
+    uint64_t misses = 0;     // Computed
+    uint64_t evictions = 0;  // Dropped from memory to stay within the budget
+    size_t entries = 0;      // In memory now
+    size_t bytes = 0;
+};
+
+/**
+ * Line diffs and view models of text pairs, cached by content.
+ *
+ * An entry is keyed by the SHA-256 of both texts and of the options that
+ * change the result, so the same pair viewed again with the same options
+ * costs a hash and a decode instead of a diff. Whether the line diff may run
+ * its parallel search (DiffOptions::pool and parallel_threshold) is part of
+ * the key, as that search may give another, equally minimal, alignment.
+ * Entries store only the hunks or rows in the serialization format (see
+ * serialize()), not the texts, which the caller passes again on every lookup.
+ *
+ * Results that hit a search budget (approximate) or were cancelled are not
+ * cached, and a cached result reports no progress. All methods may be called
+ * from several threads at once; a pair missed by two threads at the same
+ * time is computed by both.
+ */
+class DiffCache {
+public:
+    explicit DiffCache(DiffCacheOptions options = {});
+    ~DiffCache();
+    DiffCache(const DiffCache&) = delete;
+    DiffCache& operator=(const DiffCache&) = delete;
+
+    /**
+     * The line diff of two texts, as diff_lines() computes it. The line tables
+     * of the result view the texts.
+     */
+    DiffResult diff_lines(std::string_view old_text, std::string_view new_text, const DiffOptions& options = {});
+
+    /**
+     * The view model of two texts, as create_view_model() builds it.
+     */
+    ViewModel view_model(std::string_view old_text, std::string_view new_text, const ViewOptions& options = {});
+
+    [[nodiscard]] DiffCacheStats stats() const;
+
+    /** Drop every entry kept in memory; the directory is left as it is. */
+    void clear();
+
+private:
+    struct Entry;
+    struct DigestHash {
+        size_t operator()(const Sha256Digest& digest) const;
+    };
+    using EntryList = std::list<Entry>;
+
+    /**
+     * The entry of `key` decoded by `decode`, which returns an optional
+     * result; nullopt if there is none or it does not decode.
+     */
+    template <typename Result, typename Decode>
+    std::optional<Result> find(const Sha256Digest& key, Decode decode);
+    void insert(const Sha256Digest& key, std::string value);
+    void insert_locked(const Sha256Digest& key, std::shared_ptr<const std::string> value);
+
+    DiffCacheOptions options_;
+    mutable std::mutex mutex_;
+    EntryList entries_;  // Most recently used first
+    std::unordered_map<Sha256Digest, EntryList::iterator, DigestHash> index_;
+    DiffCacheStats stats_;
+};
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_DIFF_CACHE_H
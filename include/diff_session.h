@@ -0,0 +1,106 @@
+#ifndef DIFF_VIEW_DIFF_SESSION_H
+#define DIFF_VIEW_DIFF_SESSION_H
+
+#include "diff.h"
+#include "line_table.h"
+#include "view_model.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace diff_view {
+
+enum class DiffSide : uint8_t {
+    Old,
+    New,
+};
+
+/**
+ * Replace bytes [begin, end) of one side's text by `text`.
+ * The range is clamped to the text.
+ */
+struct TextEdit {
+    DiffSide side = DiffSide::New;
+    size_t begin = 0;
+    size_t end = 0;
+    std::string_view text;
+};
+
+/**
+ * How the rows of the view model changed with an edit: rows
+ * [begin, begin + removed) of the previous view model became rows
+ * [begin, begin + inserted) of the new one. The rows after them are the
+ * same, moved by inserted - removed rows and with the line numbers of each
+ * side moved by old_line_shift and new_line_shift. Rows showing lines whose
+ * text or highlights may have changed are always among the inserted rows.
+ */
+struct RowPatch {
+    uint32_t begin = 0;
+    uint32_t removed = 0;
+    uint32_t inserted = 0;
+    int32_t old_line_shift = 0;
+    int32_t new_line_shift = 0;
+};
+
+/**
+ * A diff kept up to date while the texts are edited, as in an editor.
+ *
+ * The session owns both texts. An edit re-splits and re-hashes only the lines
+ * it touches, then runs the line diff again only between the nearest
+ * unchanged lines (Equal steps of the previous edit script) around them; the
+ * rest of the script is kept. The view model is then rebuilt from the script,
+ * its line tables viewing the session's texts.
+ *
+ * A session must not be used by several threads at once.
+ */
+class DiffSession {
+public:
+    DiffSession(std::string old_text, std::string new_text, const ViewOptions& options = {});
+    DiffSession(const DiffSession&) = delete;
+    DiffSession& operator=(const DiffSession&) = delete;
+
+    /**
+     * Apply an edit and update the view model.
+     *
+     * @param edit The side, byte range and replacement text.
+     * @return The rows that changed.
+     */
+    RowPatch apply(const TextEdit& edit);
+
+    [[nodiscard]] std::string_view old_text() const { return old_text_; }
+    [[nodiscard]] std::string_view new_text() const { return new_text_; }
+
+    /** The view model of the current texts, valid until the next edit. */
+    [[nodiscard]] const ViewModel& view_model() const { return view_model_; }
+
+    /** The line edit script of the current texts. */
+    [[nodiscard]] const std::vector<EditRun>& edit_runs() const { return script_; }
+
+private:
+    /**
+     * Diff again the lines around a line edit of one side.
+     *
+     * @return The lines diffed again on the old and the new side, as lines
+     *         [first, first + removed) before the edit that became lines
+     *         [first, first + added).
+     */
+    std::pair<LineEdit, LineEdit> rediff(DiffSide side, const LineEdit& edit);
+    void build_view_model();
+
+    ViewOptions options_;
+    DiffEngine engine_;
+    std::string old_text_;
+    std::string new_text_;
+    LineTable old_lines_;
+    LineTable new_lines_;
+    std::vector<EditRun> script_;
+    bool approximate_ = false;
+    ViewModel view_model_;
+};
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_DIFF_SESSION_H
@@ -0,0 +1,70 @@
+#ifndef DIFF_VIEW_LINE_INTERN_H
+#define DIFF_VIEW_LINE_INTERN_H
+
+#include "line_table.h"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace diff_view {
+
+/**
+ * Lines of two texts mapped to dense equivalence-class IDs.
+ *
+ * Two lines share an ID if and only if their contents are equal. IDs are
+ * assigned in order of first appearance, old lines first, so they lie in
+ * [0, class_count()).
+ */
+struct InternedLines {
+    std::vector<uint32_t> old_ids;
+    std::vector<uint32_t> new_ids;
+    std::vector<uint32_t> old_counts;  // Occurrences of each class in the old lines
+    std::vector<uint32_t> new_counts;  // Occurrences of each class in the new lines
+
+    [[nodiscard]] size_t class_count() const { return old_counts.size(); }
+};
+
+/**
+ * Interns the lines of pairs of texts, keeping its table and the memory of
+ * the results across calls.
+ */
+class LineInterner {
+public:
+    /**
+     * Intern the lines of both sides into one equivalence-class table.
+     *
+     * @param old_lines Lines from old text.
+     * @param new_lines Lines from new text.
+     * @param result Receives the class IDs and counts; its memory is reused.
+     */
+    void intern(const LineTable& old_lines, const LineTable& new_lines, InternedLines& result);
+
+private:
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    struct Slot {
+        uint64_t hash = 0;
+        uint32_t id = EMPTY;
+    };
+
+    uint32_t intern_line(std::string_view line, uint64_t hash);
+
+    // Open addressing, keyed by the line hash and verified against the class representative
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    std::vector<std::string_view> representatives_;
+};
+
+/**
+ * Intern the lines of both sides into one equivalence-class table.
+ *
+ * @param old_lines Lines from old text.
+ * @param new_lines Lines from new text.
+ * @return Class IDs for every line and per-class occurrence counts.
+ */
+InternedLines intern_lines(const LineTable& old_lines, const LineTable& new_lines);
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_LINE_INTERN_H
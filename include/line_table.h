@@ -0,0 +1,131 @@
+#ifndef DIFF_VIEW_LINE_TABLE_H
+#define DIFF_VIEW_LINE_TABLE_H
+
+#include "string_utils.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace diff_view {
+
+/**
+ * Lines changed by LineTable::edit_view: lines [first, first + removed) of the
+ * table before the edit became lines [first, first + added).
+ */
+struct LineEdit {
+    size_t first;
+    size_t removed;
+    size_t added;
+};
+
+/**
+ * Lines of a text stored as byte ranges into one contiguous buffer, together
+ * with the hash_line value of every line.
+ *
+ * A table either views caller-owned memory (view) or owns a single copy of
+ * the text (copy, from_lines). A viewing table, and every table copied from
+ * it, must not outlive the viewed buffer. Copies of an owning table share
+ * its buffer, so they stay valid on their own.
+ */
+class LineTable {
+public:
+    LineTable() = default;
+
+    /**
+     * Index the lines of a caller-owned text without copying it.
+     *
+     * @param text The text to index; must outlive the table.
+     */
+    static LineTable view(std::string_view text);
+
+    /**
+     * Index the lines of a caller-owned text the way diff and git split files:
+     * every line ends after its '\n' and keeps it, and a final '\n' does not
+     * start an empty last line. "a" and "a\n" thus differ in their only line.
+     *
+     * @param text The text to index; must outlive the table.
+     */
+    static LineTable view_with_endings(std::string_view text);
+
+    /**
+     * Index lines of a caller-owned text that were split elsewhere; only
+     * their hashes are computed.
+     *
+     * @param text The text of the lines; must outlive the table.
+     * @param spans Byte ranges of the lines inside the text, each within it.
+     */
+    static LineTable view_spans(std::string_view text, std::vector<LineSpan> spans);
+
+    /**
+     * Copy a text into one owned buffer and index its lines.
+     *
+     * @param text The text to copy.
+     */
+    static LineTable copy(std::string_view text);
+
+    /**
+     * Build an owning table from pre-split lines.
+     *
+     * @param lines Lines without line ending characters.
+     */
+    static LineTable from_lines(const std::vector<std::string>& lines);
+
+    /**
+     * Re-index the table as a view of another caller-owned text, reusing the
+     * memory of its spans and hashes.
+     *
+     * @param text The text to index; must outlive the table.
+     */
+    void assign_view(std::string_view text);
+
+    /**
+     * Re-index a table made by view() after bytes [begin, end) of its text
+     * were replaced by `inserted` bytes. Only the lines touching the edit, and
+     * the line before them, are split and hashed again; later spans are moved.
+     *
+     * @param text The edited text; must outlive the table.
+     * @param begin Start of the replaced bytes in the text before the edit.
+     * @param end End of the replaced bytes in the text before the edit.
+     * @param inserted Number of bytes that replaced them.
+     * @return The lines that changed.
+     */
+    LineEdit edit_view(std::string_view text, size_t begin, size_t end, size_t inserted);
+
+    /**
+     * Lines [first, first + count) as a table of the same text. Spans and
+     * hashes are copied, the text is shared.
+     */
+    [[nodiscard]] LineTable slice(size_t first, size_t count) const;
+
+    [[nodiscard]] size_t size() const { return spans_.size(); }
+    [[nodiscard]] bool empty() const { return spans_.empty(); }
+
+    [[nodiscard]] std::string_view operator[](const size_t index) const {
+        const auto& [begin, end] = spans_[index];
+        return text_.substr(begin, end - begin);
+    }
+
+    /** The whole underlying buffer, including line endings. */
+    [[nodiscard]] std::string_view text() const { return text_; }
+
+    /** Byte range of every line inside text(). */
+    [[nodiscard]] const std::vector<LineSpan>& spans() const { return spans_; }
+
+    /** hash_line of every line. */
+    [[nodiscard]] const std::vector<uint64_t>& hashes() const { return hashes_; }
+
+    /** Copy the lines out as individual strings. */
+    [[nodiscard]] std::vector<std::string> to_vector() const;
+
+private:
+    std::shared_ptr<const std::string> storage_;
+    std::string_view text_;
+    std::vector<LineSpan> spans_;
+    std::vector<uint64_t> hashes_;
+};
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_LINE_TABLE_H
@@ -0,0 +1,50 @@
+#ifndef DIFF_VIEW_MAPPED_FILE_H
+#define DIFF_VIEW_MAPPED_FILE_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace diff_view {
+
+/**
+ * Read-only contents of a file, memory-mapped when possible.
+ *
+ * Non-empty regular files are mapped, so diffing them copies nothing.
+ * Pipes, terminals and anything else that cannot be mapped are read into
+ * memory instead. Views of text() stay valid as long as the object lives.
+ */
+class MappedFile {
+public:
+    /**
+     * @param path Path of the file, "-" for the standard input.
+     * @param error If not null, set to a description of the failure.
+     * @return The file, or nullopt if it cannot be opened or read.
+     */
+    static std::optional<MappedFile> open(const std::string& path, std::string* error = nullptr);
+
+    ~MappedFile();
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] std::string_view text() const { return text_; }
+
+    /** Whether the contents are mapped rather than read into memory. */
+    [[nodiscard]] bool mapped() const { return map_ != nullptr; }
+
+private:
+    MappedFile() = default;
+    void unmap();
+
+    void* map_ = nullptr;
+    size_t map_size_ = 0;
+    std::string buffer_;  // Contents that were read instead of mapped
+    std::string_view text_;
+};
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_MAPPED_FILE_H
@@ -0,0 +1,858 @@
+#ifndef DIFF_VIEW_MYERS_H
+#define DIFF_VIEW_MYERS_H
+
+#include "diff.h"
+#include "phase_progress.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace diff_view {
+
+/**
+ * Buffers of a Myers search that can be kept across searches on one thread,
+ * so that a stream of small problems does not allocate for them.
+ */
+struct MyersScratch {
+    std::vector<int> frontier;
+    std::vector<int> trace;
+    std::vector<int> forward;
+    std::vector<int> backward;
+    std::vector<EditRun> backtrack;
+};
+
+/**
+ * Work limits for a Myers search.
+ */
+struct MyersOptions {
+    // Furthest edit distance explored by one middle snake search before it
+    // splits at the most advanced point reached instead (0 = unbounded)
+    int max_cost = 0;
+    // Give up, with an empty script, once the edit distance is known to be
+    // larger than this (0 = unbounded). Past a split over max_cost, the bound
+    // applies to the approximate script.
+    int max_distance = 0;
+    // Once passed, remaining regions are reported as whole deletions and insertions
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    // Once cancelled, same as a passed deadline (nullptr = never)
+    const CancelToken* cancel = nullptr;
+    // Solve the search concurrently on this pool (nullptr = on the calling thread)
+    ThreadPool* pool = nullptr;
+    // Regions with fewer elements (old + new) than this are solved serially
+    size_t parallel_threshold = size_t{1} << 14;
+    // Buffers to reuse; not shared with other threads (nullptr = the search's own)
+    MyersScratch* scratch = nullptr;
+    // Advanced by the elements (old + new) placed in the script as it is
+    // found, from the threads running the search (nullptr = not reported)
+    PhaseProgress* progress = nullptr;
+};
+
+/**
+ * Myers diff with bounded memory.
+ *
+ * `equal(i, j)` compares old element i with new element j. Problems are first
+ * solved with the greedy forward search and backtracking, which keeps only the
+ * live part [-d-1, d+1] of the frontier per step, O(D^2) in total. When that
+ * trace would exceed MAX_TRACE_SIZE the problem is split at its middle snake
+ * (Myers' linear-space refinement) and both halves are solved recursively, so
+ * memory stays O(N + M + MAX_TRACE_SIZE) regardless of the number of changes.
+ *
+ * Scripts are identical to the plain greedy search whenever the trace fits the
+ * budget. Larger problems still get a minimal script, but when several minimal
+ * scripts exist the alignment chosen around the split points may differ.
+ *
+ * With a cost or time budget (see MyersOptions) the script stays valid but may
+ * no longer be minimal once the budget is hit; approximate() reports that.
+ *
+ * run(pool, threshold) solves large problems on several threads.
+ */
+template <typename Equal>
+class MyersDiff {
+public:
+    static constexpr size_t MAX_TRACE_SIZE = size_t{1} << 22;
+    // Last step a greedy search can take: the trace holds (d + 2)^2 - 1
+    // entries once step d is recorded
+    static constexpr int MAX_GREEDY_STEP = [] {
+        int d = 0;
+        while (static_cast<size_t>(d + 3) * static_cast<size_t>(d + 3) <= MAX_TRACE_SIZE + 1) {
+            ++d;
+        }
+        return d;
+    }();
+    // Steps of a two-thread middle snake search run serially before this one
+    static constexpr int PAIRED_FROM_STEP = 64;
+
+    MyersDiff(const int n, const int m, Equal equal, const MyersOptions& options = {})
+        : n_(n), m_(m), equal_(std::move(equal)), options_(options),
+          has_deadline_(options.deadline != std::chrono::steady_clock::time_point::max()),
+          scratch_(options.scratch != nullptr ? *options.scratch : own_scratch_) {
+        options_.scratch = nullptr;  // Engines made for a pool use their own
+    }
+
+    std::vector<EditRun> run() {
+        diff(0, n_, 0, m_);
+        if (exceeded_) {
+            script_.clear();
+        }
+        return std::move(script_);
+    }
+
+    /**
+     * Same as run(), appending the script to `script` so that its memory is
+     * reused. `script` is left unchanged when the distance bound is exceeded.
+     */
+    void run(std::vector<EditRun>& script) {
+        const size_t size = script.size();
+        const size_t last_length = script.empty() ? 0 : script.back().length;
+        out_ = &script;
+        diff(0, n_, 0, m_);
+        out_ = &script_;
+        if (exceeded_) {
+            script.resize(size);
+            if (size > 0) {
+                script.back().length = last_length;
+            }
+        }
+    }
+
+    /**
+     * Same as run(), solved on a pool. Regions of at least `threshold`
+     * elements are split at their middle snakes, a level of regions at a time,
+     * and the pieces left are then solved concurrently. While there are few
+     * regions, the forward and backward passes of each search run on two
+     * threads. Pieces are handed to threads as they free up, so uneven pieces
+     * balance themselves.
+     *
+     * The script is minimal (within the budgets) and does not depend on the
+     * number of threads, but when several minimal scripts exist it may differ
+     * from run() around the split points.
+     */
+    std::vector<EditRun> run(ThreadPool& pool, const size_t threshold) {
+        if (options_.max_distance > 0) {
+            return run();  // The distance bound is tracked along one script
+        }
+        enum class Kind : uint8_t { Region, Same, Replaced };
+        struct Piece {
+            Kind kind;
+            int x0, x1, y0, y1;
+        };
+        const auto large = [threshold](const Piece& piece) {
+            return piece.kind == Kind::Region && piece.x0 < piece.x1 && piece.y0 < piece.y1 &&
+                   static_cast<size_t>(piece.x1 - piece.x0) + static_cast<size_t>(piece.y1 - piece.y0) >= threshold;
+        };
+        std::vector<Piece> pieces = {{Kind::Region, 0, n_, 0, m_}};
+        while (true) {
+            // Trim the common ends of the large regions; those still large get split
+            std::vector<Piece> trimmed;
+            std::vector<size_t> splits;
+            for (auto piece : pieces) {
+                if (!large(piece)) {
+                    trimmed.push_back(piece);
+                    continue;
+                }
+                auto& [kind, x0, x1, y0, y1] = piece;
+                const int start_x = x0, start_y = y0, end_x = x1, end_y = y1;
+                while (x0 < x1 && y0 < y1 && equal_(x0, y0)) {
+                    ++x0;
+                    ++y0;
+                }
+                while (x0 < x1 && y0 < y1 && equal_(x1 - 1, y1 - 1)) {
+                    --x1;
+                    --y1;
+                }
+                if (x0 > start_x) {
+                    trimmed.push_back({Kind::Same, start_x, x0, start_y, y0});
+                }
+                if (large(piece)) {
+                    splits.push_back(trimmed.size());
+                }
+                trimmed.push_back(piece);
+                if (x1 < end_x) {
+                    trimmed.push_back({Kind::Same, x1, end_x, y1, end_y});
+                }
+            }
+            pieces = std::move(trimmed);
+            if (splits.empty()) {
+                break;
+            }
+
+            std::vector<std::unique_ptr<MyersDiff>> splitters(splits.size());
+            for (auto& splitter : splitters) {
+                splitter = std::make_unique<MyersDiff>(n_, m_, equal_, options_);
+            }
+            std::vector<std::optional<Snake>> snakes(splits.size());
+            // Paired halves wait for each other, so each needs a thread of its own
+            if (expired_) {
+                // Out of time: no more searches
+            } else if (pool.parallel() && 2 * splits.size() <= pool.size()) {
+                for (size_t i = 0; i < splits.size(); ++i) {
+                    const auto& [kind, x0, x1, y0, y1] = pieces[splits[i]];
+                    splitters[i]->start_parallel_search(x0, x1, y0, y1);
+                }
+                pool.run(2 * splits.size(), [&](const size_t task) {
+                    splitters[task / 2]->search_half(task % 2 == 0);
+                });
+                for (size_t i = 0; i < splits.size(); ++i) {
+                    snakes[i] = splitters[i]->search_->snake;
+                }
+            } else {
+                pool.run(splits.size(), [&](const size_t i) {
+                    const auto& [kind, x0, x1, y0, y1] = pieces[splits[i]];
+                    snakes[i] = splitters[i]->middle_snake(x0, x1, y0, y1);
+                });
+            }
+            for (const auto& splitter : splitters) {
+                merge_flags(*splitter);
+            }
+
+            std::vector<Piece> split;
+            for (size_t i = 0, next = 0; i < pieces.size(); ++i) {
+                if (next == splits.size() || splits[next] != i) {
+                    split.push_back(pieces[i]);
+                    continue;
+                }
+                const auto& [kind, x0, x1, y0, y1] = pieces[i];
+                const auto& snake = snakes[next++];
+                if (!snake) {
+                    // Out of time: the region is replaced
+                    approximate_ = true;
+                    split.push_back({Kind::Replaced, x0, x1, y0, y1});
+                    continue;
+                }
+                const auto [x_start, y_start, x_end, y_end] = *snake;
+                split.push_back({Kind::Region, x0, x_start, y0, y_start});
+                if (x_end > x_start) {
+                    split.push_back({Kind::Same, x_start, x_end, y_start, y_end});
+                }
+                split.push_back({Kind::Region, x_end, x1, y_end, y1});
+            }
+            pieces = std::move(split);
+        }
+
+        // Solve the remaining regions and join the scripts in order
+        std::vector<std::unique_ptr<MyersDiff>> solvers(pieces.size());
+        pool.run(pieces.size(), [&](const size_t i) {
+            const auto& [kind, x0, x1, y0, y1] = pieces[i];
+            if (kind == Kind::Region) {
+                solvers[i] = std::make_unique<MyersDiff>(n_, m_, equal_, options_);
+                solvers[i]->expired_ = expired_;
+                solvers[i]->diff(x0, x1, y0, y1);
+            }
+        });
+        for (size_t i = 0; i < pieces.size(); ++i) {
+            const auto& [kind, x0, x1, y0, y1] = pieces[i];
+            if (kind == Kind::Same) {
+                emit(DiffOp::Equal, x1 - x0);
+            } else if (kind == Kind::Replaced) {
+                emit(DiffOp::Delete, x1 - x0);
+                emit(DiffOp::Insert, y1 - y0);
+            } else {
+                merge_flags(*solvers[i]);
+                for (const auto& [op, length] : solvers[i]->script_) {
+                    emit(op, static_cast<int>(length), false);
+                }
+            }
+        }
+        return std::move(script_);
+    }
+
+    /** Whether a budget was hit, so the script may not be minimal. */
+    [[nodiscard]] bool approximate() const { return approximate_; }
+
+    /** Whether the search gave up because the edit distance exceeds max_distance. */
+    [[nodiscard]] bool exceeded() const { return exceeded_; }
+
+private:
+    struct Snake {
+        int x_start;
+        int y_start;
+        int x_end;
+        int y_end;
+    };
+
+    void merge_flags(const MyersDiff& other) {
+        expired_ = expired_ || other.expired_;
+        approximate_ = approximate_ || other.approximate_;
+    }
+
+    /**
+     * Append `count` steps to the script; `report` advances the progress,
+     * unless another engine already did for these steps.
+     */
+    void emit(const DiffOp op, const int count, const bool report = true) {
+        append_run(*out_, op, static_cast<size_t>(count));
+        if (op != DiffOp::Equal) {
+            distance_ += count;
+            exceeded_ = exceeded_ || over_distance(0);
+        }
+        if (report && options_.progress != nullptr) {
+            options_.progress->advance(static_cast<size_t>(count) * (op == DiffOp::Equal ? 2 : 1));
+        }
+    }
+
+    /**
+     * Whether the edits emitted so far plus `d` more exceed max_distance.
+     */
+    [[nodiscard]] bool over_distance(const int d) const {
+        return options_.max_distance > 0 && distance_ + d > static_cast<int64_t>(options_.max_distance);
+    }
+
+    void diff(int x0, int x1, int y0, int y1) {
+        // The region after a split is handled by the loop rather than by
+        // recursion, so budgeted searches that peel off small pieces from the
+        // front stay shallow. Trimmed suffixes are all Equal and emitted at the end.
+        int suffix = 0;
+        while (!exceeded_) {
+            if (x0 == x1) {
+                emit(DiffOp::Insert, y1 - y0);
+                break;
+            }
+            if (y0 == y1) {
+                emit(DiffOp::Delete, x1 - x0);
+                break;
+            }
+            if (!expired_ && greedy(x0, x1, y0, y1)) {
+                break;
+            }
+            int prefix = 0;
+            while (x0 < x1 && y0 < y1 && equal_(x0, y0)) {
+                ++x0;
+                ++y0;
+                ++prefix;
+            }
+            while (x0 < x1 && y0 < y1 && equal_(x1 - 1, y1 - 1)) {
+                --x1;
+                --y1;
+                ++suffix;
+            }
+            emit(DiffOp::Equal, prefix);
+            if (x0 == x1 || y0 == y1) {
+                continue;
+            }
+            // Both sides are non-empty and differ at both ends, so D >= 2 and
+            // the middle snake splits the problem into two strictly smaller ones.
+            const auto snake = expired_ ? std::nullopt : middle_snake(x0, x1, y0, y1);
+            if (exceeded_) {
+                return;
+            }
+            if (!snake) {
+                // Out of time: report the rest of the region as replaced
+                approximate_ = true;
+                emit(DiffOp::Delete, x1 - x0);
+                emit(DiffOp::Insert, y1 - y0);
+                break;
+            }
+            const auto [x_start, y_start, x_end, y_end] = *snake;
+            diff(x0, x_start, y0, y_start);
+            emit(DiffOp::Equal, x_end - x_start);
+            x0 = x_end;
+            y0 = y_end;
+        }
+        emit(DiffOp::Equal, suffix);
+    }
+
+    /**
+     * Greedy forward search with backtracking.
+     * Returns false without emitting anything if the trace exceeds the budget.
+     */
+    bool greedy(const int x0, const int x1, const int y0, const int y1) {
+        const int n = x1 - x0;
+        const int m = y1 - y0;
+        const int max_d = n + m;
+
+        // V[k] = x: coordinate of the furthest reaching path in diagonal k.
+        // The frontier only covers the steps the budgets allow, and is
+        // cleared as it widens, so that a budgeted search peeling small
+        // pieces off a large region costs its steps, not the region size.
+        int last_step = std::min(max_d, MAX_GREEDY_STEP);
+        if (options_.max_cost > 0) {
+            last_step = std::min(last_step, options_.max_cost);
+        }
+        const int offset = last_step + 1;
+        const size_t size = 2 * static_cast<size_t>(last_step) + 3;
+        scratch_.frontier.resize(std::max(scratch_.frontier.size(), size));
+        int* v = scratch_.frontier.data() + offset;
+        // scratch_.trace holds V[-d-1..d+1] as it was before step d, starting at d^2 + 2d
+        scratch_.trace.clear();
+        int last_d = 0;
+        bool found = false;
+        for (int d = 0; d <= max_d && !found; ++d) {
+            if (over_distance(d)) {
+                exceeded_ = true;
+                return true;
+            }
+            if (scratch_.trace.size() + 2 * static_cast<size_t>(d) + 3 > MAX_TRACE_SIZE || over_budget(d)) {
+                return false;
+            }
+            v[-d - 1] = 0;
+            v[d + 1] = 0;
+            if (d == 0) {
+                v[0] = 0;
+            }
+            scratch_.trace.insert(scratch_.trace.end(), v - d - 1, v + d + 2);
+            last_d = d;
+            for (int k = -d; k <= d; k += 2) {
+                int x;
+                if (k == -d || (k != d && v[k - 1] < v[k + 1])) {
+                    x = v[k + 1]; // Move down (insert)
+                } else {
+                    x = v[k - 1] + 1; // Move right (delete)
+                }
+                int y = x - k;
+                while (x < n && y < m && equal_(x0 + x, y0 + y)) {
+                    ++x;
+                    ++y;
+                }
+                v[k] = x;
+                if (x >= n && y >= m) {
+                    found = true;
+                    break;
+                }
+            }
+        }
+
+        // Backtracking yields the path from the end, so collect it first
+        scratch_.backtrack.clear();
+        int x = n, y = m;
+        for (int d = last_d; d >= 0 && (x > 0 || y > 0); --d) {
+            const int* v_prev = scratch_.trace.data() + static_cast<size_t>(d) * d + 3 * d + 1;
+            const int k = x - y;
+            int prev_k;
+            if (k == -d || (k != d && v_prev[k - 1] < v_prev[k + 1])) {
+                prev_k = k + 1; // Came from above (insert)
+            } else {
+                prev_k = k - 1; // Came from left (delete)
+            }
+            const int prev_x = v_prev[prev_k];
+            const int prev_y = prev_x - prev_k;
+            // Add diagonal moves (equal)
+            const int snake = std::min(x - prev_x, y - prev_y);
+            if (snake > 0) {
+                append_run(scratch_.backtrack, DiffOp::Equal, static_cast<size_t>(snake));
+                x -= snake;
+                y -= snake;
+            }
+            if (d > 0) {
+                if (x == prev_x) {
+                    append_run(scratch_.backtrack, DiffOp::Insert, 1);
+                    --y;
+                } else {
+                    append_run(scratch_.backtrack, DiffOp::Delete, 1);
+                    --x;
+                }
+            }
+        }
+        for (auto it = scratch_.backtrack.rbegin(); it != scratch_.backtrack.rend(); ++it) {
+            emit(it->op, static_cast<int>(it->length));
+        }
+        return true;
+    }
+
+    /**
+     * Whether step d of a search exceeds the cost budget or the deadline, or
+     * the search was cancelled. The clock and the token are only read every 16 steps.
+     */
+    bool over_budget(const int d) {
+        if (options_.max_cost > 0 && d > options_.max_cost) {
+            return true;
+        }
+        if (!expired_ && d % 16 == 0 && d > 0 &&
+            ((has_deadline_ && std::chrono::steady_clock::now() >= options_.deadline) ||
+             (options_.cancel != nullptr && options_.cancel->cancelled()))) {
+            expired_ = true;
+        }
+        return expired_;
+    }
+
+    /**
+     * Split point used once a middle snake search is over budget: the furthest
+     * on-grid point the forward frontier reached after d - 1 steps ("split at
+     * the best diagonal seen so far"). The part before it costs at most d - 1
+     * edits, so only the part after it needs another bounded search.
+     */
+    static Snake heuristic_split(const int n, const int m, const int d, const int* vf) {
+        int best_x = 0, best_y = 0;
+        for (int k = -(d - 1); k <= d - 1; k += 2) {
+            const int x = vf[k], y = x - k;
+            if (x <= n && y >= 0 && y <= m && x + y > best_x + best_y && x + y < n + m) {
+                best_x = x;
+                best_y = y;
+            }
+        }
+        return {best_x, best_y, best_x, best_y};
+    }
+
+    /**
+     * State of one middle snake search. Coordinates are relative to (x0, y0).
+     */
+    struct Search {
+        int x0 = 0;
+        int y0 = 0;
+        int n = 0;
+        int m = 0;
+        int delta = 0;
+        bool odd = false;
+        int* vf = nullptr;
+        int* vb = nullptr;
+        int* pre = nullptr;  // Backward x before its snake, for the deferred overlap check
+        int d = 0;           // Current step
+        bool paired = false; // Whether the steps are split over two threads
+        bool done = false;
+        std::optional<Snake> snake;
+    };
+
+    Search start_search(const int x0, const int x1, const int y0, const int y1) {
+        Search s;
+        s.x0 = x0;
+        s.y0 = y0;
+        s.n = x1 - x0;
+        s.m = y1 - y0;
+        s.delta = s.n - s.m;
+        s.odd = (s.delta & 1) != 0;
+        const int max_d = (s.n + s.m + 1) / 2;
+        const int offset = s.m + max_d + 1;
+        const size_t size = static_cast<size_t>(s.n) + s.m + 2 * max_d + 4;
+        scratch_.forward.resize(std::max(scratch_.forward.size(), size));
+        scratch_.backward.resize(std::max(scratch_.backward.size(), size));
+        s.vf = scratch_.forward.data() + offset;
+        s.vb = scratch_.backward.data() + offset;
+        s.vf[1] = 0;
+        s.vb[s.delta + 1] = s.n + 1;
+        return s;
+    }
+
+    /**
+     * Limits checked before step s.d. Returns true, with the result in
+     * s.snake, when the search ends there.
+     */
+    bool stop_before_step(Search& s) {
+        const int d = s.d;
+        // No overlap within d - 1 steps from both ends means D >= 2d - 1
+        if (d > 0 && over_distance(2 * d - 1)) {
+            exceeded_ = true;
+            return true;
+        }
+        if (d > 1 && over_budget(d)) {
+            if (!expired_) {
+                approximate_ = true;
+                const auto [x_start, y_start, x_end, y_end] = heuristic_split(s.n, s.m, d, s.vf);
+                s.snake = Snake{s.x0 + x_start, s.y0 + y_start, s.x0 + x_end, s.y0 + y_end};
+            }
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Forward pass of step s.d: furthest reaching x on each diagonal k = x - y.
+     * Returns true once it overlaps the backward paths (odd delta only).
+     */
+    bool forward_step(Search& s) {
+        const int d = s.d, n = s.n, m = s.m, delta = s.delta;
+        int* vf = s.vf;
+        const int* vb = s.vb;
+        for (int k = -d; k <= d; k += 2) {
+            int x;
+            if (k == -d || (k != d && vf[k - 1] < vf[k + 1])) {
+                x = vf[k + 1]; // Move down (insert)
+            } else {
+                x = vf[k - 1] + 1; // Move right (delete)
+            }
+            int y = x - k;
+            const int x_start = x, y_start = y;
+            while (x < n && y < m && equal_(s.x0 + x, s.y0 + y)) {
+                ++x;
+                ++y;
+            }
+            vf[k] = x;
+            if (s.odd && k >= delta - (d - 1) && k <= delta + (d - 1) && vb[k] <= x) {
+                s.snake = Snake{s.x0 + x_start, s.y0 + y_start, s.x0 + x, s.y0 + y};
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * Backward pass of step s.d: furthest reaching (smallest) x on each
+     * diagonal c = k + delta. With `check`, returns true once it overlaps the
+     * forward paths (even delta only); otherwise records s.pre for
+     * deferred_check().
+     */
+    bool backward_step(Search& s, const bool check) {
+        const int d = s.d, delta = s.delta;
+        const int* vf = s.vf;
+        int* vb = s.vb;
+        for (int k = -d; k <= d; k += 2) {
+            const int c = k + delta;
+            int x;
+            if (k == -d || (k != d && vb[c + 1] - 1 < vb[c - 1])) {
+                x = vb[c + 1] - 1; // Move left (delete)
+            } else {
+                x = vb[c - 1]; // Move up (insert)
+            }
+            int y = x - c;
+            const int x_end = x, y_end = y;
+            while (x > 0 && y > 0 && equal_(s.x0 + x - 1, s.y0 + y - 1)) {
+                --x;
+                --y;
+            }
+            vb[c] = x;
+            if (!check) {
+                s.pre[c] = x_end;
+            } else if (!s.odd && c >= -d && c <= d && x <= vf[c]) {
+                s.snake = Snake{s.x0 + x, s.y0 + y, s.x0 + x_end, s.y0 + y_end};
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * The even-delta overlap check of backward_step(), once both passes of
+     * step s.d are done. Diagonals are visited in the same order, so the
+     * snake found is the same.
+     */
+    void deferred_check(Search& s) const {
+        const int d = s.d;
+        for (int k = -d; k <= d; k += 2) {
+            const int c = k + s.delta;
+            if (c >= -d && c <= d && s.vb[c] <= s.vf[c]) {
+                const int x = s.vb[c], x_end = s.pre[c];
+                s.snake = Snake{s.x0 + x, s.y0 + x - c, s.x0 + x_end, s.y0 + x_end - c};
+                return;
+            }
+        }
+    }
+
+    /**
+     * Find the middle snake of the optimal path between (x0, y0) and (x1, y1).
+     * Returns nullopt if the deadline passed during the search, or if the
+     * region alone is known to cost more than max_distance.
+     */
+    std::optional<Snake> middle_snake(const int x0, const int x1, const int y0, const int y1) {
+        auto s = start_search(x0, x1, y0, y1);
+        const int max_d = (s.n + s.m + 1) / 2;
+        for (; s.d <= max_d; ++s.d) {
+            if (stop_before_step(s) || forward_step(s) || backward_step(s, true)) {
+                return s.snake;
+            }
+        }
+        return Snake{x0, y0, x0, y0}; // Unreachable: the paths always overlap by max_d
+    }
+
+    /** Ends a step of the two-thread search, once both passes are done. */
+    struct StepDone {
+        MyersDiff* engine;
+
+        void operator()() const noexcept {
+            Search& s = *engine->search_;
+            if (!s.paired) {
+                // End of the serial steps
+                s.paired = true;
+                s.done = s.done || engine->stop_before_step(s);
+                return;
+            }
+            if (!s.snake && !s.odd) {
+                engine->deferred_check(s);
+            }
+            if (s.snake) {
+                s.done = true;
+                return;
+            }
+            ++s.d;
+            s.done = engine->stop_before_step(s);
+        }
+    };
+
+    /**
+     * Prepare middle_snake() of a region for two threads: one calls
+     * search_half(true) and runs the forward passes, the other calls
+     * search_half(false) and runs the backward passes. They meet after every
+     * step, so the snake found is the one middle_snake() finds. The first
+     * PAIRED_FROM_STEP steps run on the forward thread alone.
+     */
+    void start_parallel_search(const int x0, const int x1, const int y0, const int y1) {
+        search_ = start_search(x0, x1, y0, y1);
+        const size_t size = scratch_.backward.size();
+        pre_.resize(std::max(pre_.size(), size));
+        search_->pre = pre_.data() + (search_->vb - scratch_.backward.data());
+        step_done_ = std::make_unique<std::barrier<StepDone>>(2, StepDone{this});
+    }
+
+    void search_half(const bool forward) {
+        Search& s = *search_;
+        if (forward) {
+            // The first steps are too short to be worth meeting after each
+            for (; s.d < PAIRED_FROM_STEP; ++s.d) {
+                if (stop_before_step(s) || forward_step(s) || backward_step(s, true)) {
+                    s.done = true;
+                    break;
+                }
+            }
+        }
+        step_done_->arrive_and_wait();
+        while (!s.done) {
+            if (forward) {
+                forward_step(s);
+            } else {
+                backward_step(s, false);
+            }
+            step_done_->arrive_and_wait();
+        }
+    }
+
+    int n_;
+    int m_;
+    Equal equal_;
+    MyersOptions options_;
+    bool has_deadline_;
+    bool expired_ = false;
+    bool approximate_ = false;
+    bool exceeded_ = false;
+    int64_t distance_ = 0;  // Deletions and insertions emitted
+    MyersScratch own_scratch_;
+    MyersScratch& scratch_;
+    std::vector<int> pre_;
+    std::optional<Search> search_;
+    std::unique_ptr<std::barrier<StepDone>> step_done_;
+    std::vector<EditRun> script_;
+    std::vector<EditRun>* out_ = &script_;  // Where emit() appends
+};
+
+/**
+ * A random-access sequence of tokens: std::vector, std::span, std::string_view, LineTable, ...
+ */
+template <typename Seq>
+concept TokenSequence = requires(const Seq& seq, size_t i) {
+    { seq.size() } -> std::convertible_to<size_t>;
+    seq[i];
+};
+
+/**
+ * Append the edit script turning one token sequence into another to `runs`,
+ * whose memory is reused across calls.
+ *
+ * The common prefix and suffix are matched first and Myers runs on the rest.
+ * `equal` is the equality policy for a pair of tokens. It is a template
+ * parameter, so for integer IDs or bytes the snake loop inlines to a plain
+ * compare. Any tokenization (lines, graphemes, bytes, words) works as long as
+ * the tokens can be compared by the policy.
+ *
+ * @param runs Receives the runs; a run continuing its last one is merged.
+ * @param old_tokens The original sequence.
+ * @param new_tokens The new sequence.
+ * @param equal Equality policy (default: operator==).
+ * @param options Cost and time budget, the pool to run on and the buffers to
+ *                reuse (default: unbounded, on the calling thread).
+ * @param approximate If not null, set to whether a budget was hit.
+ * @return False, with `runs` unchanged, when the edit distance exceeds
+ *         options.max_distance.
+ */
+template <TokenSequence OldSeq, TokenSequence NewSeq, typename Equal = std::equal_to<>>
+bool append_myers_edit_runs(std::vector<EditRun>& runs, const OldSeq& old_tokens, const NewSeq& new_tokens,
+                            Equal equal = {}, const MyersOptions& options = {}, bool* approximate = nullptr) {
+    const size_t old_size = old_tokens.size();
+    const size_t new_size = new_tokens.size();
+    size_t prefix_len = 0;
+    while (prefix_len < old_size && prefix_len < new_size &&
+           equal(old_tokens[prefix_len], new_tokens[prefix_len])) {
+        ++prefix_len;
+    }
+    size_t suffix_len = 0;
+    while (suffix_len < old_size - prefix_len && suffix_len < new_size - prefix_len &&
+           equal(old_tokens[old_size - 1 - suffix_len], new_tokens[new_size - 1 - suffix_len])) {
+        ++suffix_len;
+    }
+
+    const size_t old_mid = old_size - prefix_len - suffix_len;
+    const size_t new_mid = new_size - prefix_len - suffix_len;
+    if (approximate != nullptr) {
+        *approximate = false;
+    }
+    const size_t size = runs.size();
+    const size_t last_length = runs.empty() ? 0 : runs.back().length;
+    append_run(runs, DiffOp::Equal, prefix_len);
+    if (options.progress != nullptr) {
+        options.progress->advance(2 * prefix_len);
+    }
+    if (old_mid > 0 || new_mid > 0) {
+        MyersDiff engine(static_cast<int>(old_mid), static_cast<int>(new_mid),
+            [&old_tokens, &new_tokens, &equal, prefix_len](const int i, const int j) {
+                return equal(old_tokens[prefix_len + i], new_tokens[prefix_len + j]);
+            }, options);
+        if (options.pool != nullptr && old_mid + new_mid >= options.parallel_threshold) {
+            for (const auto& [op, length] : engine.run(*options.pool, options.parallel_threshold)) {
+                append_run(runs, op, length);
+            }
+        } else {
+            engine.run(runs);
+        }
+        if (engine.exceeded()) {
+            runs.resize(size);
+            if (size > 0) {
+                runs.back().length = last_length;
+            }
+            return false;
+        }
+        if (approximate != nullptr) {
+            *approximate = engine.approximate();
+        }
+    }
+    append_run(runs, DiffOp::Equal, suffix_len);
+    if (options.progress != nullptr) {
+        options.progress->advance(2 * suffix_len);
+    }
+    return true;
+}
+
+/**
+ * Compute the edit script turning one token sequence into another, as runs.
+ * Same as append_myers_edit_runs, into a new vector.
+ *
+ * @param old_tokens The original sequence.
+ * @param new_tokens The new sequence.
+ * @param equal Equality policy (default: operator==).
+ * @param options Cost and time budget, and the pool to run on (default:
+ *                unbounded, on the calling thread).
+ * @param approximate If not null, set to whether a budget was hit.
+ * @return Runs of steps; adjacent runs have different ops. Empty when the
+ *         edit distance exceeds options.max_distance.
+ */
+template <TokenSequence OldSeq, TokenSequence NewSeq, typename Equal = std::equal_to<>>
+std::vector<EditRun> myers_edit_runs(const OldSeq& old_tokens, const NewSeq& new_tokens, Equal equal = {},
+                                     const MyersOptions& options = {}, bool* approximate = nullptr) {
+    std::vector<EditRun> runs;
+    append_myers_edit_runs(runs, old_tokens, new_tokens, std::move(equal), options, approximate);
+    return runs;
+}
+
+/**
+ * Compute the edit script turning one token sequence into another.
+ * Same as myers_edit_runs, with one DiffOp per step.
+ *
+ * @param old_tokens The original sequence.
+ * @param new_tokens The new sequence.
+ * @param equal Equality policy (default: operator==).
+ * @param options Cost and time budget (default: unbounded).
+ * @param approximate If not null, set to whether a budget was hit.
+ * @return One DiffOp per step: Equal consumes a token from both sides.
+ */
+template <TokenSequence OldSeq, TokenSequence NewSeq, typename Equal = std::equal_to<>>
+std::vector<DiffOp> myers_diff(const OldSeq& old_tokens, const NewSeq& new_tokens, Equal equal = {},
+                               const MyersOptions& options = {}, bool* approximate = nullptr) {
+    return expand_runs(myers_edit_runs(old_tokens, new_tokens, std::move(equal), options, approximate));
+}
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_MYERS_H
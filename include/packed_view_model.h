@@ -0,0 +1,61 @@
+#ifndef DIFF_VIEW_PACKED_VIEW_MODEL_H
+#define DIFF_VIEW_PACKED_VIEW_MODEL_H
+
+#include "view_model.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace diff_view {
+
+// Numbers per element of the PackedViewModel arrays
+constexpr size_t PACKED_ROW_STRIDE = 4;        // left kind, left line_no, right kind, right line_no
+constexpr size_t PACKED_HIGHLIGHT_STRIDE = 4;  // row, start, end, is_left
+constexpr size_t PACKED_CONNECTOR_STRIDE = 6;  // top, bottom, left_start, left_end, right_start, right_end
+constexpr size_t PACKED_FOLD_STRIDE = 2;       // row, count
+
+/**
+ * A view model as flat arrays of uint32_t, so that a consumer across a
+ * language boundary (the WASM binding) can read it through a few typed-array
+ * views instead of one call per field.
+ *
+ * The lines of both sides are stored back to back, old lines first, in one
+ * UTF-8 blob without their line endings: line i of the blob is
+ * text[line_offsets[i], line_offsets[i + 1]), and new line j is blob line
+ * old_line_count + j.
+ */
+struct PackedViewModel {
+    std::vector<uint32_t> rows;
+    std::vector<uint32_t> highlights;
+    std::vector<uint32_t> connectors;
+    std::vector<uint32_t> folds;
+    std::string text;
+    std::vector<uint32_t> line_offsets;  // old_line_count + new_line_count + 1 entries
+    uint32_t old_line_count = 0;
+    uint32_t new_line_count = 0;
+    bool approximate = false;
+    bool cancelled = false;
+
+    [[nodiscard]] size_t row_count() const { return rows.size() / PACKED_ROW_STRIDE; }
+
+    /** Line `index` of the old side (is_old) or the new side. */
+    [[nodiscard]] std::string_view line(const bool is_old, const size_t index) const {
+        const size_t i = is_old ? index : old_line_count + index;
+        return std::string_view(text).substr(line_offsets[i], line_offsets[i + 1] - line_offsets[i]);
+    }
+};
+
+/**
+ * Encode a view model into flat arrays.
+ *
+ * @param vm The view model
+ * @return The same rows, highlights, connectors, folds and lines
+ */
+PackedViewModel pack_view_model(const ViewModel& vm);
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_PACKED_VIEW_MODEL_H
@@ -0,0 +1,59 @@
+#ifndef DIFF_VIEW_PHASE_PROGRESS_H
+#define DIFF_VIEW_PHASE_PROGRESS_H
+
+#include "diff.h"
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+
+namespace diff_view {
+
+/**
+ * Reports a phase of `total` steps, which may be done on several threads, to
+ * a progress callback: 0 first, then at most once per percent, and 1 when
+ * finish() is called.
+ */
+class PhaseProgress {
+public:
+    PhaseProgress(const DiffProgress& progress, const DiffPhase phase, const size_t total)
+        : progress_(progress), phase_(phase), total_(total) {
+        if (progress_) {
+            progress_(phase_, 0.0);
+        }
+    }
+
+    void advance(const size_t steps = 1) {
+        if (!progress_ || steps == 0) {
+            return;
+        }
+        const size_t done = done_.fetch_add(steps, std::memory_order_relaxed) + steps;
+        const size_t percent = done * 100 / total_;
+        if (percent >= 100 || percent <= reported_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        const std::lock_guard lock(mutex_);
+        if (percent > reported_.load(std::memory_order_relaxed)) {
+            reported_.store(percent, std::memory_order_relaxed);
+            progress_(phase_, static_cast<double>(done) / static_cast<double>(total_));
+        }
+    }
+
+    void finish() const {
+        if (progress_) {
+            progress_(phase_, 1.0);
+        }
+    }
+
+private:
+    const DiffProgress& progress_;
+    DiffPhase phase_;
+    size_t total_;
+    std::atomic<size_t> done_{0};
+    std::atomic<size_t> reported_{0};
+    std::mutex mutex_;
+};
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_PHASE_PROGRESS_H
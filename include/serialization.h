@@ -0,0 +1,97 @@
+#ifndef DIFF_VIEW_SERIALIZATION_H
+#define DIFF_VIEW_SERIALIZATION_H
+
+#include "diff.h"
+#include "line_table.h"
+#include "view_model.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace diff_view {
+
+/**
+ * Version of the binary format written by serialize(). Readers reject any
+ * other version.
+ *
+ * Layout, with every number an unsigned LEB128 varint and every signed
+ * difference zigzag-encoded:
+ *
+ *   "DVSF", version (1 byte), kind (1 byte: 1 = DiffResult, 2 = ViewModel),
+ *   flags (1 byte: approximate, cancelled, has text)
+ *   per side, old then new: line count; with text, a split byte (0 = the
+ *     lines of LineTable::view(text), 1 = listed), the text size and bytes,
+ *     and if listed, per line the gap after the previous line and its length
+ *   DiffResult: hunk count; per hunk the unchanged lines since the previous
+ *     hunk (the same on both sides), the run count and per run length << 2 | op
+ *   ViewModel: row runs, each the two kinds (left | right << 4), a length and
+ *     per side the first line number (0 or 1 + its difference from the line
+ *     after the previous one), later rows of a run counting up; then the
+ *     highlights, connectors and folds, as differences from their previous ones
+ *
+ * The texts are stored once and lines are referenced by offset into them, so
+ * a reader can view them in place, e.g. in a MappedFile.
+ */
+constexpr uint8_t SERIALIZATION_VERSION = 2;
+
+/**
+ * Encode a line diff.
+ *
+ * @param result The diff
+ * @param include_text Store the texts of the line tables; without them a
+ *                     reader must be given the tables again
+ * @return The encoded bytes
+ */
+std::string serialize(const DiffResult& result, bool include_text = true);
+
+/**
+ * Encode a view model.
+ *
+ * @param vm The view model
+ * @param include_text Store the texts of the line tables; without them a
+ *                     reader must be given the tables again
+ * @return The encoded bytes
+ */
+std::string serialize(const ViewModel& vm, bool include_text = true);
+
+/**
+ * Decode a line diff serialized with its texts. The line tables view the
+ * texts inside `data`, which must outlive the result; nothing is copied.
+ *
+ * @return The diff, or nullopt if `data` is not a valid encoding of one
+ */
+std::optional<DiffResult> deserialize_diff(std::string_view data);
+
+/**
+ * Decode a line diff serialized without its texts.
+ *
+ * @param old_lines, new_lines The tables the diff was computed on; checked
+ *                             against the stored line counts
+ * @return The diff, or nullopt if `data` is not a valid encoding of one for
+ *         these tables
+ */
+std::optional<DiffResult> deserialize_diff(std::string_view data, LineTable old_lines, LineTable new_lines);
+
+/**
+ * Decode a view model serialized with its texts. The line tables view the
+ * texts inside `data`, which must outlive the result; nothing is copied.
+ *
+ * @return The view model, or nullopt if `data` is not a valid encoding of one
+ */
+std::optional<ViewModel> deserialize_view_model(std::string_view data);
+
+/**
+ * Decode a view model serialized without its texts.
+ *
+ * @param old_lines, new_lines The tables the view model was built on; checked
+ *                             against the stored line counts
+ * @return The view model, or nullopt if `data` is not a valid encoding of one
+ *         for these tables
+ */
+std::optional<ViewModel> deserialize_view_model(std::string_view data, LineTable old_lines, LineTable new_lines);
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_SERIALIZATION_H
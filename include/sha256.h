@@ -0,0 +1,44 @@
+#ifndef DIFF_VIEW_SHA256_H
+#define DIFF_VIEW_SHA256_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace diff_view {
+
+using Sha256Digest = std::array<uint8_t, 32>;
+
+/**
+ * Incremental SHA-256 (FIPS 180-4), for keys that must not collide even on
+ * adversarial inputs.
+ */
+class Sha256 {
+public:
+    Sha256();
+
+    void update(std::string_view data);
+
+    /** The digest of everything given to update(); the object must not be used afterwards. */
+    Sha256Digest finish();
+
+private:
+    void compress(const uint8_t* block);
+
+    std::array<uint32_t, 8> state_;
+    std::array<uint8_t, 64> block_{};
+    size_t block_size_ = 0;
+    uint64_t total_size_ = 0;
+};
+
+/** SHA-256 of a string. */
+Sha256Digest sha256(std::string_view data);
+
+/** Lowercase hexadecimal form of a digest. */
+std::string to_hex(const Sha256Digest& digest);
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_SHA256_H
@@ -8,6 +8,48 @@
 
 namespace diff_view {
 
+/**
+ * Byte range [begin, end) of one line, excluding its line ending.
+ */
+struct LineSpan {
+    size_t begin;
+    size_t end;
+};
+
+/**
+ * Instruction sets available to the line scanner.
+ */
+enum class SimdLevel : uint8_t {
+    Scalar,
+    SSE2,
+    AVX2,
+    Best, // Widest level supported by the running CPU
+};
+
+/**
+ * Locate the lines of a string without copying them.
+ *
+ * Lines are split the same way as split_lines.
+ *
+ * @param str The UTF-8 string to scan.
+ * @return Byte ranges of the lines inside str.
+ */
+std::vector<LineSpan> find_lines(std::string_view str);
+
+/**
+ * Locate the lines of a string and hash each of them with hash_line, in one pass.
+ *
+ * Line endings are searched 16 or 32 bytes at a time when the CPU supports it.
+ * A level the CPU does not support falls back to the widest supported one.
+ *
+ * @param str The UTF-8 string to scan.
+ * @param spans Receives the byte range of every line (appended).
+ * @param hashes Receives the hash of every line (appended).
+ * @param level Instruction set to use (default: the best available).
+ */
+void index_lines(std::string_view str, std::vector<LineSpan>& spans, std::vector<uint64_t>& hashes,
+                 SimdLevel level = SimdLevel::Best);
+
 /**
  * Split a string by line endings.
  *
@@ -25,6 +67,14 @@ std::vector<std::string> split_lines(std::string_view str);
  */
 uint64_t hash_string(std::string_view str, uint64_t seed = 14695981039346656037ULL);
 
+/**
+ * Compute a fast 64-bit hash of a line, consuming 8 bytes per step.
+ *
+ * @param str The line to hash.
+ * @return 64-bit hash value.
+ */
+uint64_t hash_line(std::string_view str);
+
 } // namespace diff_view
 
 #endif //DIFF_VIEW_STRING_UTILS_H
@@ -0,0 +1,88 @@
+#ifndef DIFF_VIEW_THREAD_POOL_H
+#define DIFF_VIEW_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace diff_view {
+
+/**
+ * A fixed set of worker threads that run the indices of one task at a time.
+ *
+ * run() hands out indices one by one to the workers and the calling thread,
+ * so uneven tasks balance themselves, and returns once all are done. Calls
+ * from different threads are serialized; a call from inside a task runs
+ * inline on the calling thread.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param threads Number of threads running tasks, the caller of run()
+     *                included (0 = one per hardware thread).
+     */
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /** Number of threads running tasks, the caller of run() included. */
+    [[nodiscard]] size_t size() const { return workers_.size() + 1; }
+
+    /**
+     * Whether run() called from this thread would spread the indices over
+     * size() threads: false without workers and from inside a task.
+     */
+    [[nodiscard]] bool parallel() const;
+
+    /**
+     * Run task(i) for every i in [0, count) and wait for all of them.
+     * The first exception thrown by a task is rethrown once the others are
+     * done; indices not started by then are skipped.
+     *
+     * @param count Number of indices.
+     * @param task Called once per index, concurrently.
+     */
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    void work();
+    void drain();
+
+    std::vector<std::thread> workers_;
+    std::mutex run_mutex_;  // One task at a time
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(size_t)>* task_ = nullptr;
+    size_t count_ = 0;
+    std::atomic<size_t> next_{0};
+    size_t generation_ = 0;
+    size_t active_ = 0;  // Workers still on the current task
+    std::exception_ptr error_;
+    bool stop_ = false;
+};
+
+/**
+ * Run task(i) for every i in [0, count): on the pool if there is one,
+ * in order on the calling thread otherwise.
+ */
+template <typename Task>
+void parallel_for(ThreadPool* pool, const size_t count, const Task& task) {
+    if (pool == nullptr) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+    pool->run(count, task);
+}
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_THREAD_POOL_H
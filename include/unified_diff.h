@@ -0,0 +1,56 @@
+#ifndef DIFF_VIEW_UNIFIED_DIFF_H
+#define DIFF_VIEW_UNIFIED_DIFF_H
+
+#include "diff.h"
+
+#include <functional>
+#include <span>
+#include <string_view>
+
+namespace diff_view {
+
+struct UnifiedDiffOptions {
+    // "--- old_label" and "+++ new_label" precede the hunks unless both are empty
+    std::string_view old_label;
+    std::string_view new_label;
+    // Append the nearest line above each hunk that starts with a letter, '_'
+    // or '$' to its header, as git does without a diff driver
+    bool function_names = true;
+};
+
+/**
+ * Receives the output as a batch of slices to write in order; returns false
+ * to stop the writer. The slices are only valid during the call.
+ */
+using UnifiedDiffSink = std::function<bool(std::span<const std::string_view> slices)>;
+
+/**
+ * Stream a diff in the unified format, the way `git diff --no-index` prints
+ * the same hunks.
+ *
+ * Line texts are passed on as slices of the result's line tables, short ones
+ * copied together with the markers into a small buffer, so the whole patch
+ * never exists in memory. The tables must come from LineTable::view_with_endings,
+ * whose lines keep their endings: a line without '\n' is the last of its
+ * file and is marked with "\ No newline at end of file".
+ *
+ * @param result The diff to write.
+ * @param options Header labels and hunk header format.
+ * @param sink Receives the output in batches.
+ * @return false if the sink stopped the writer.
+ */
+bool write_unified_diff(const DiffResult& result, const UnifiedDiffOptions& options, const UnifiedDiffSink& sink);
+
+/**
+ * Same as above, writing to a file descriptor with vectored writes.
+ *
+ * @param result The diff to write.
+ * @param options Header labels and hunk header format.
+ * @param fd An open file descriptor, left open.
+ * @return false if a write failed; errno tells why.
+ */
+bool write_unified_diff(const DiffResult& result, const UnifiedDiffOptions& options, int fd);
+
+} // namespace diff_view
+
+#endif //DIFF_VIEW_UNIFIED_DIFF_H
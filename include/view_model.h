@@ -1,8 +1,15 @@
 #ifndef DIFF_VIEW_VIEW_MODEL_H
 #define DIFF_VIEW_VIEW_MODEL_H
 
+#include "diff.h"
+#include "line_table.h"
+#include "thread_pool.h"
+
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace diff_view {
@@ -12,16 +19,21 @@ enum class LineKind : uint8_t {
     Context = 1,
     Removed = 2,
     Added = 3,
+    Folded = 4,  // Hidden unchanged lines, see Fold
 };
 
 struct SideInfo {
     LineKind kind = LineKind::Blank;
     uint32_t line_no = 0;
+
+    bool operator==(const SideInfo&) const = default;
 };
 
 struct ViewLine {
     SideInfo left;
     SideInfo right;
+
+    bool operator==(const ViewLine&) const = default;
 };
 
 struct InlineHighlight {
@@ -29,6 +41,8 @@ struct InlineHighlight {
     uint32_t start;
     uint32_t end;
     bool is_left;
+
+    bool operator==(const InlineHighlight&) const = default;
 };
 
 struct Connector {
@@ -38,14 +52,44 @@ struct Connector {
     uint32_t left_end;
     uint32_t right_start;
     uint32_t right_end;
+
+    bool operator==(const Connector&) const = default;
 };
 
+/**
+ * A Folded row: `count` unchanged lines on both sides, starting at the line
+ * numbers of the row's sides.
+ */
+struct Fold {
+    uint32_t row;
+    uint32_t count;
+
+    bool operator==(const Fold&) const = default;
+};
+
+/**
+ * Rows ready for rendering. The line tables own one copy of each input text.
+ */
 struct ViewModel {
-    std::vector<std::string> old_lines;
-    std::vector<std::string> new_lines;
+    LineTable old_lines;
+    LineTable new_lines;
     std::vector<ViewLine> lines;
     std::vector<InlineHighlight> highlights;
     std::vector<Connector> connectors;
+    std::vector<Fold> folds;  // Ordered by row
+    // The line diff hit its budget (see DiffOptions) and may not be minimal
+    bool approximate = false;
+    // Building was cancelled (see DiffOptions::cancel); there are no rows
+    bool cancelled = false;
+};
+
+struct ViewOptions {
+    DiffOptions diff;
+    // Collapse unchanged lines outside the context of the hunks into Folded rows
+    bool fold_unchanged = false;
+    // Pair lines and build the rows of the hunks concurrently on this pool
+    // (nullptr = on the calling thread). The view model is the same either way.
+    ThreadPool* pool = nullptr;
 };
 
 /**
@@ -58,6 +102,153 @@ struct ViewModel {
  */
 ViewModel create_view_model(const std::string& old_text, const std::string& new_text, uint32_t context = 3);
 
+/**
+ * Build a view model from two texts with the given diff options.
+ *
+ * @param old_text Original text
+ * @param new_text New text
+ * @param options Line diff algorithm and number of context lines
+ * @return ViewModel ready for UI rendering
+ */
+ViewModel create_view_model(const std::string& old_text, const std::string& new_text, const DiffOptions& options);
+
+/**
+ * Build a view model from two texts with the given view options.
+ *
+ * @param old_text Original text
+ * @param new_text New text
+ * @param options Diff options and whether unchanged regions are folded
+ * @return ViewModel ready for UI rendering
+ */
+ViewModel create_view_model(const std::string& old_text, const std::string& new_text, const ViewOptions& options);
+
+/**
+ * Rows [begin, begin + lines.size()) of a view model. Highlights, connectors
+ * and folds use absolute row indices. The connector of a hunk that overlaps
+ * the window is included whole.
+ */
+struct ViewWindow {
+    uint32_t begin = 0;
+    std::vector<ViewLine> lines;
+    std::vector<InlineHighlight> highlights;
+    std::vector<Connector> connectors;
+    std::vector<Fold> folds;
+};
+
+/**
+ * Rows taken by one hunk of the line diff.
+ */
+struct HunkRows {
+    uint32_t first_row;
+    uint32_t row_count;
+};
+
+/**
+ * A view model whose rows are built on demand.
+ *
+ * Construction runs the line diff and decides which deleted and inserted lines
+ * are shown side by side as modifications. That fixes the row count and the
+ * rows of every hunk. rows() builds rows, inline highlights and connectors
+ * only for the hunks a window overlaps, and caches them per hunk.
+ *
+ * The cancel token and progress callback of options.diff are used by the
+ * constructor and to_view_model(), and must outlive them.
+ */
+class LazyViewModel {
+public:
+    LazyViewModel(std::string_view old_text, std::string_view new_text, const ViewOptions& options = {});
+
+    /**
+     * Build on a line diff that is already done; its line tables are kept
+     * as they are, so a viewing table must outlive the rows built from it.
+     * Of options.diff only the cancel token and progress callback are used:
+     * the hunks already carry their context.
+     */
+    explicit LazyViewModel(DiffResult diff, const ViewOptions& options = {});
+    ~LazyViewModel();
+    LazyViewModel(LazyViewModel&&) noexcept;
+    LazyViewModel& operator=(LazyViewModel&&) noexcept;
+
+    [[nodiscard]] size_t row_count() const;
+    [[nodiscard]] const std::vector<HunkRows>& hunks() const { return hunk_rows_; }
+    [[nodiscard]] const LineTable& old_lines() const { return old_lines_; }
+    [[nodiscard]] const LineTable& new_lines() const { return new_lines_; }
+    [[nodiscard]] bool approximate() const { return approximate_; }
+    // Construction was cancelled; the model has no rows
+    [[nodiscard]] bool cancelled() const { return cancelled_; }
+    // How the deleted and inserted lines of the hunks were checked for pairing
+    [[nodiscard]] const SimilarityStats& similarity_stats() const { return similarity_stats_; }
+
+    /**
+     * Build rows [begin, end), clamped to the row count.
+     *
+     * @param begin First row
+     * @param end One past the last row
+     * @return The rows with their highlights, connectors and folds
+     */
+    ViewWindow rows(size_t begin, size_t end);
+
+    /**
+     * Replace a Folded row by the unchanged lines it hides.
+     *
+     * @param row Index of the Folded row
+     * @return Number of rows added (the fold size minus one), 0 if the row is not a Folded row
+     */
+    size_t expand_fold(size_t row);
+
+    /**
+     * Build every row. The line tables are moved into the result.
+     */
+    ViewModel to_view_model() &&;
+
+private:
+    struct Fragment;
+
+    /**
+     * Unchanged lines (hunk == SIZE_MAX), shown as one Folded row when folded,
+     * or the rows of a hunk.
+     */
+    struct Segment {
+        size_t hunk;
+        size_t old_start;
+        size_t new_start;
+        size_t count;
+        bool folded;
+        size_t first_row;
+        size_t row_count;
+    };
+
+    void layout();
+    const Fragment& fragment(size_t hunk);
+    void append_rows(const Segment& segment, const Fragment* fragment, size_t begin, size_t end, ViewWindow& window) const;
+
+    LineTable old_lines_;
+    LineTable new_lines_;
+    bool approximate_ = false;
+    bool cancelled_ = false;
+    ThreadPool* pool_ = nullptr;
+    const CancelToken* cancel_ = nullptr;
+    DiffProgress progress_;
+    SimilarityStats similarity_stats_;
+    std::vector<DiffHunk> hunks_;
+    // Per hunk, the character diff of the i-th deletion and the i-th insertion
+    // when they share a row (kept for the inline highlights)
+    std::vector<std::vector<std::optional<CharDiffRanges>>> pairs_;
+    std::vector<std::unique_ptr<Fragment>> fragments_;
+    std::vector<Segment> segments_;
+    std::vector<HunkRows> hunk_rows_;
+};
+
+/**
+ * Replace a Folded row by the unchanged lines it hides.
+ * Rows of highlights, connectors and folds below it are shifted accordingly.
+ *
+ * @param vm View model to update
+ * @param row Index of the Folded row
+ * @return Number of rows added (the fold size minus one), 0 if the row is not a Folded row
+ */
+size_t expand_fold(ViewModel& vm, size_t row);
+
 } // namespace diff_view
 
 #endif //DIFF_VIEW_VIEW_MODEL_H
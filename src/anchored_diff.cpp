@@ -0,0 +1,337 @@
+#include "anchored_diff.h"
+#include "myers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <span>
+
+namespace diff_view {
+
+namespace {
+
+/**
+ * Region [old_begin, old_end) x [new_begin, new_end) still to diff, or a run
+ * of `old_end - old_begin` equal lines when `equal_run` is set.
+ */
+struct Region {
+    size_t old_begin;
+    size_t old_end;
+    size_t new_begin;
+    size_t new_end;
+    bool equal_run = false;
+};
+
+/**
+ * Shared driver: regions are processed from an explicit stack so that deep
+ * anchor chains do not recurse, and the script is still emitted in order.
+ */
+class AnchoredDiff {
+public:
+    AnchoredDiff(const InternedLines& interned, const MyersOptions& options)
+        : old_ids_(interned.old_ids), new_ids_(interned.new_ids), options_(options) {
+    }
+
+    template <typename SplitRegion>
+    std::vector<EditRun> run(SplitRegion split_region) {
+        stack_.push_back({0, old_ids_.size(), 0, new_ids_.size()});
+        size_t searched = 0;
+        while (!stack_.empty()) {
+            auto region = stack_.back();
+            stack_.pop_back();
+            if (region.equal_run) {
+                place(DiffOp::Equal, region.old_end - region.old_begin);
+                continue;
+            }
+            if (expired_ || (++searched % CHECK_INTERVAL == 0 && expired())) {
+                // Out of time: the regions left are reported as replaced
+                approximate_ = true;
+                place(DiffOp::Delete, region.old_end - region.old_begin);
+                place(DiffOp::Insert, region.new_end - region.new_begin);
+                continue;
+            }
+            trim(region);
+            if (region.old_begin == region.old_end || region.new_begin == region.new_end) {
+                place(DiffOp::Delete, region.old_end - region.old_begin);
+                place(DiffOp::Insert, region.new_end - region.new_begin);
+            } else if (!split_region(region)) {
+                run_myers(region);
+            }
+            if (trimmed_suffix_ > 0) {
+                place(DiffOp::Equal, trimmed_suffix_);
+            }
+        }
+        return std::move(script_);
+    }
+
+    /**
+     * Queue the regions produced by a split; they are processed in the given order.
+     */
+    void push_in_order(std::vector<Region>& regions) {
+        // The suffix trimmed from the parent must come after all children
+        if (trimmed_suffix_ > 0) {
+            stack_.push_back({0, trimmed_suffix_, 0, trimmed_suffix_, true});
+            trimmed_suffix_ = 0;
+        }
+        stack_.insert(stack_.end(), regions.rbegin(), regions.rend());
+        regions.clear();
+    }
+
+    [[nodiscard]] const std::vector<uint32_t>& old_ids() const { return old_ids_; }
+    [[nodiscard]] const std::vector<uint32_t>& new_ids() const { return new_ids_; }
+    [[nodiscard]] bool approximate() const { return approximate_; }
+
+private:
+    // Regions between reads of the clock and the cancel token
+    static constexpr size_t CHECK_INTERVAL = 16;
+
+    /**
+     * Whether the deadline passed or the search was cancelled; stays true
+     * once it is.
+     */
+    bool expired() {
+        expired_ = expired_ || std::chrono::steady_clock::now() >= options_.deadline ||
+                   (options_.cancel != nullptr && options_.cancel->cancelled());
+        return expired_;
+    }
+
+    void place(const DiffOp op, const size_t length) {
+        append_run(script_, op, length);
+        // Once expired, the rest of the script is filled in at once
+        if (options_.progress != nullptr && !expired_) {
+            options_.progress->advance(op == DiffOp::Equal ? 2 * length : length);
+        }
+    }
+
+    void trim(Region& region) {
+        size_t prefix = 0;
+        while (region.old_begin < region.old_end && region.new_begin < region.new_end &&
+               old_ids_[region.old_begin] == new_ids_[region.new_begin]) {
+            ++region.old_begin;
+            ++region.new_begin;
+            ++prefix;
+        }
+        place(DiffOp::Equal, prefix);
+        trimmed_suffix_ = 0;
+        while (region.old_begin < region.old_end && region.new_begin < region.new_end &&
+               old_ids_[region.old_end - 1] == new_ids_[region.new_end - 1]) {
+            --region.old_end;
+            --region.new_end;
+            ++trimmed_suffix_;
+        }
+    }
+
+    void run_myers(const Region& region) {
+        const std::span old_span(old_ids_.data() + region.old_begin, region.old_end - region.old_begin);
+        const std::span new_span(new_ids_.data() + region.new_begin, region.new_end - region.new_begin);
+        bool approximate = false;
+        // The search advances the progress itself
+        for (const auto& [op, length] : myers_edit_runs(old_span, new_span, std::equal_to<>{}, options_, &approximate)) {
+            append_run(script_, op, length);
+        }
+        approximate_ = approximate_ || approximate;
+    }
+
+    const std::vector<uint32_t>& old_ids_;
+    const std::vector<uint32_t>& new_ids_;
+    MyersOptions options_;
+    std::vector<Region> stack_;
+    std::vector<EditRun> script_;
+    size_t trimmed_suffix_ = 0;
+    bool approximate_ = false;
+    bool expired_ = false;
+};
+
+constexpr uint32_t NONE = UINT32_MAX;
+
+/**
+ * Split a region at the longest increasing run of lines unique on both sides.
+ */
+class PatienceSplitter {
+public:
+    PatienceSplitter(AnchoredDiff& driver, const size_t class_count)
+        : driver_(driver),
+          old_count_(class_count, 0), new_count_(class_count, 0),
+          old_pos_(class_count, NONE), new_pos_(class_count, NONE) {}
+
+    bool operator()(const Region& region) {
+        const auto& old_ids = driver_.old_ids();
+        const auto& new_ids = driver_.new_ids();
+        for (size_t i = region.old_begin; i < region.old_end; ++i) {
+            ++old_count_[old_ids[i]];
+            old_pos_[old_ids[i]] = static_cast<uint32_t>(i);
+        }
+        for (size_t j = region.new_begin; j < region.new_end; ++j) {
+            ++new_count_[new_ids[j]];
+            new_pos_[new_ids[j]] = static_cast<uint32_t>(j);
+        }
+        // Unique common lines in new order; their old positions form the sequence
+        matches_.clear();
+        for (size_t j = region.new_begin; j < region.new_end; ++j) {
+            const uint32_t id = new_ids[j];
+            if (old_count_[id] == 1 && new_count_[id] == 1) {
+                matches_.push_back({old_pos_[id], static_cast<uint32_t>(j)});
+            }
+        }
+        for (size_t i = region.old_begin; i < region.old_end; ++i) {
+            old_count_[old_ids[i]] = 0;
+        }
+        for (size_t j = region.new_begin; j < region.new_end; ++j) {
+            new_count_[new_ids[j]] = 0;
+        }
+        if (matches_.empty()) {
+            return false;
+        }
+
+        // Longest increasing subsequence of old positions (patience sorting)
+        tails_.clear();
+        previous_.assign(matches_.size(), NONE);
+        for (size_t k = 0; k < matches_.size(); ++k) {
+            const auto it = std::lower_bound(tails_.begin(), tails_.end(), matches_[k].old_pos,
+                [this](const uint32_t index, const uint32_t old_pos) {
+                    return matches_[index].old_pos < old_pos;
+                });
+            if (it != tails_.begin()) {
+                previous_[k] = *(it - 1);
+            }
+            if (it == tails_.end()) {
+                tails_.push_back(static_cast<uint32_t>(k));
+            } else {
+                *it = static_cast<uint32_t>(k);
+            }
+        }
+        anchors_.clear();
+        for (uint32_t k = tails_.back(); k != NONE; k = previous_[k]) {
+            anchors_.push_back(matches_[k]);
+        }
+        std::ranges::reverse(anchors_);
+
+        size_t old_begin = region.old_begin, new_begin = region.new_begin;
+        for (const auto& [old_pos, new_pos] : anchors_) {
+            regions_.push_back({old_begin, old_pos, new_begin, new_pos});
+            regions_.push_back({old_pos, old_pos + size_t{1}, new_pos, new_pos + size_t{1}, true});
+            old_begin = old_pos + size_t{1};
+            new_begin = new_pos + size_t{1};
+        }
+        regions_.push_back({old_begin, region.old_end, new_begin, region.new_end});
+        driver_.push_in_order(regions_);
+        return true;
+    }
+
+private:
+    struct Match {
+        uint32_t old_pos;
+        uint32_t new_pos;
+    };
+
+    AnchoredDiff& driver_;
+    std::vector<uint32_t> old_count_;
+    std::vector<uint32_t> new_count_;
+    std::vector<uint32_t> old_pos_;
+    std::vector<uint32_t> new_pos_;
+    std::vector<Match> matches_;
+    std::vector<uint32_t> tails_;
+    std::vector<uint32_t> previous_;
+    std::vector<Match> anchors_;
+    std::vector<Region> regions_;
+};
+
+/**
+ * Split a region at the longest common run anchored on its rarest old line.
+ */
+class HistogramSplitter {
+public:
+    // Lines occurring more often than this in the old region are never anchors
+    static constexpr uint32_t MAX_CHAIN_LENGTH = 64;
+
+    HistogramSplitter(AnchoredDiff& driver, const size_t class_count)
+        : driver_(driver), count_(class_count, 0), head_(class_count, NONE),
+          next_(driver.old_ids().size(), NONE) {}
+
+    bool operator()(const Region& region) {
+        const auto& old_ids = driver_.old_ids();
+        const auto& new_ids = driver_.new_ids();
+        // Occurrence chains of the old region in ascending order
+        for (size_t i = region.old_end; i-- > region.old_begin;) {
+            const uint32_t id = old_ids[i];
+            ++count_[id];
+            next_[i] = head_[id];
+            head_[id] = static_cast<uint32_t>(i);
+        }
+
+        uint32_t best_count = MAX_CHAIN_LENGTH;
+        size_t best_old = 0, best_new = 0, best_len = 0;
+        for (size_t b = region.new_begin; b < region.new_end;) {
+            size_t b_next = b + 1;
+            for (uint32_t a = head_[new_ids[b]]; a != NONE; a = next_[a]) {
+                if (count_[old_ids[a]] > best_count) {
+                    continue;
+                }
+                size_t as = a, bs = b, ae = a + 1, be = b + 1;
+                uint32_t run_count = count_[old_ids[a]];
+                while (as > region.old_begin && bs > region.new_begin && old_ids[as - 1] == new_ids[bs - 1]) {
+                    --as;
+                    --bs;
+                    run_count = std::min(run_count, count_[old_ids[as]]);
+                }
+                while (ae < region.old_end && be < region.new_end && old_ids[ae] == new_ids[be]) {
+                    run_count = std::min(run_count, count_[old_ids[ae]]);
+                    ++ae;
+                    ++be;
+                }
+                b_next = std::max(b_next, be);
+                if (ae - as > best_len || run_count < best_count) {
+                    best_old = as;
+                    best_new = bs;
+                    best_len = ae - as;
+                    best_count = run_count;
+                }
+            }
+            b = b_next;
+        }
+
+        for (size_t i = region.old_begin; i < region.old_end; ++i) {
+            count_[old_ids[i]] = 0;
+            head_[old_ids[i]] = NONE;
+        }
+        if (best_len == 0) {
+            return false;
+        }
+        regions_.push_back({region.old_begin, best_old, region.new_begin, best_new});
+        regions_.push_back({best_old, best_old + best_len, best_new, best_new + best_len, true});
+        regions_.push_back({best_old + best_len, region.old_end, best_new + best_len, region.new_end});
+        driver_.push_in_order(regions_);
+        return true;
+    }
+
+private:
+    AnchoredDiff& driver_;
+    std::vector<uint32_t> count_;
+    std::vector<uint32_t> head_;
+    std::vector<uint32_t> next_;
+    std::vector<Region> regions_;
+};
+
+} // namespace
+
+std::vector<EditRun> patience_diff(const InternedLines& interned, const MyersOptions& options, bool* approximate) {
+    AnchoredDiff driver(interned, options);
+    PatienceSplitter splitter(driver, interned.class_count());
+    auto script = driver.run([&splitter](const Region& region) { return splitter(region); });
+    if (approximate != nullptr) {
+        *approximate = driver.approximate();
+    }
+    return script;
+}
+
+std::vector<EditRun> histogram_diff(const InternedLines& interned, const MyersOptions& options, bool* approximate) {
+    AnchoredDiff driver(interned, options);
+    HistogramSplitter splitter(driver, interned.class_count());
+    auto script = driver.run([&splitter](const Region& region) { return splitter(region); });
+    if (approximate != nullptr) {
+        *approximate = driver.approximate();
+    }
+    return script;
+}
+
+} // namespace diff_view
@@ -0,0 +1,72 @@
+#include "batch.h"
+
+#include <algorithm>
+
+namespace diff_view {
+
+namespace {
+
+size_t pair_bytes(const FilePair& pair) {
+    return pair.old_text.size() + pair.new_text.size();
+}
+
+BatchItem build_item(const FilePair& pair, const ViewOptions& options) {
+    const auto start = std::chrono::steady_clock::now();
+    BatchItem item;
+    item.view_model = LazyViewModel(pair.old_text, pair.new_text, options).to_view_model();
+    item.elapsed = std::chrono::steady_clock::now() - start;
+    return item;
+}
+
+} // namespace
+
+void create_view_models(const std::span<const FilePair> pairs, const BatchOptions& options,
+                        const std::function<void(size_t, BatchItem&&)>& on_done) {
+    std::vector<size_t> large, small;
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        (pair_bytes(pairs[i]) >= options.split_bytes ? large : small).push_back(i);
+    }
+
+    // Large pairs one at a time, the pool working inside each
+    ViewOptions large_options = options.view;
+    large_options.pool = options.pool;
+    large_options.diff.pool = options.pool;
+    for (const size_t i : large) {
+        on_done(i, build_item(pairs[i], large_options));
+    }
+
+    // Small pairs largest first, so that the tasks taken last are the shortest,
+    // grouped so that tiny pairs do not cost a task each
+    std::stable_sort(small.begin(), small.end(), [&pairs](const size_t a, const size_t b) {
+        return pair_bytes(pairs[a]) > pair_bytes(pairs[b]);
+    });
+    std::vector<size_t> group_starts;
+    size_t group_size = 0;
+    for (size_t k = 0; k < small.size(); ++k) {
+        const size_t bytes = pair_bytes(pairs[small[k]]);
+        if (group_starts.empty() || group_size + bytes > options.group_bytes) {
+            group_starts.push_back(k);
+            group_size = 0;
+        }
+        group_size += bytes;
+    }
+    ViewOptions small_options = options.view;
+    small_options.pool = nullptr;
+    small_options.diff.pool = nullptr;
+    parallel_for(options.pool, group_starts.size(), [&](const size_t group) {
+        const size_t end = group + 1 < group_starts.size() ? group_starts[group + 1] : small.size();
+        for (size_t k = group_starts[group]; k < end; ++k) {
+            on_done(small[k], build_item(pairs[small[k]], small_options));
+        }
+    });
+}
+
+std::vector<BatchItem> create_view_models(const std::span<const FilePair> pairs, const BatchOptions& options) {
+    std::vector<BatchItem> items(pairs.size());
+    create_view_models(pairs, options, [&items](const size_t i, BatchItem&& item) {
+        items[i] = std::move(item);
+    });
+    return items;
+}
+
+} // namespace diff_view
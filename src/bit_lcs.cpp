@@ -0,0 +1,97 @@
+#include "bit_lcs.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace diff_view {
+
+BitLcs::BitLcs(const std::string_view old_str, const std::string_view new_str) {
+    assign(old_str, new_str);
+}
+
+void BitLcs::assign(const std::string_view old_str, const std::string_view new_str) {
+    old_str_ = old_str;
+    new_str_ = new_str;
+    words_ = (old_str.size() + 63) / 64;
+    length_ = 0;
+    const size_t n = old_str_.size(), m = new_str_.size();
+
+    // Match mask of each byte value over the reversed old string: bit p is set
+    // when old[n - 1 - p] is that byte. Only bytes that occur get a mask.
+    std::array<uint16_t, 256> slots{};
+    masks_.clear();
+    for (size_t p = 0; p < n; ++p) {
+        auto& slot = slots[static_cast<unsigned char>(old_str_[n - 1 - p])];
+        if (slot == 0) {
+            masks_.resize(masks_.size() + words_, 0);
+            slot = static_cast<uint16_t>(masks_.size() / words_);
+        }
+        masks_[(slot - 1) * words_ + p / 64] |= uint64_t{1} << (p % 64);
+    }
+
+    // V' = (V + U) | (V - U) with U = V & match. U is a subset of V, so the
+    // subtraction is V & ~U and only the addition carries across words.
+    columns_.assign((m + 1) * words_, ~uint64_t{0});
+    for (size_t q = 1; q <= m; ++q) {
+        const uint64_t* prev = columns_.data() + (q - 1) * words_;
+        uint64_t* next = columns_.data() + q * words_;
+        const auto slot = slots[static_cast<unsigned char>(new_str_[m - q])];
+        if (slot == 0) {
+            std::copy(prev, prev + words_, next);
+            continue;
+        }
+        const uint64_t* match = masks_.data() + (slot - 1) * words_;
+        uint64_t carry = 0;
+        for (size_t w = 0; w < words_; ++w) {
+            const uint64_t v = prev[w], u = v & match[w];
+            const uint64_t partial = v + u;
+            const uint64_t sum = partial + carry;
+            carry = static_cast<uint64_t>(partial < v) | static_cast<uint64_t>(sum < partial);
+            next[w] = sum | (v & ~u);
+        }
+    }
+
+    // Cleared bits of the last column are the bytes of old in the LCS
+    const uint64_t* last = columns_.data() + m * words_;
+    for (size_t w = 0; w < words_; ++w) {
+        uint64_t kept = ~last[w];
+        if (w == words_ - 1 && n % 64 != 0) {
+            kept &= (uint64_t{1} << (n % 64)) - 1;
+        }
+        length_ += static_cast<size_t>(std::popcount(kept));
+    }
+}
+
+std::vector<EditRun> BitLcs::edit_runs() const {
+    std::vector<EditRun> runs;
+    edit_runs(runs);
+    return runs;
+}
+
+void BitLcs::edit_runs(std::vector<EditRun>& runs) const {
+    const size_t n = old_str_.size(), m = new_str_.size();
+    size_t i = 0, j = 0;
+    while (i < n && j < m) {
+        if (old_str_[i] == new_str_[j]) {
+            append_run(runs, DiffOp::Equal, 1);
+            ++i;
+            ++j;
+            continue;
+        }
+        // Delete old[i] if the rest of the old string keeps the same LCS with new[j..]
+        const size_t p = n - 1 - i;
+        const uint64_t column_word = columns_[(m - j) * words_ + p / 64];
+        if ((column_word >> (p % 64)) & 1) {
+            append_run(runs, DiffOp::Delete, 1);
+            ++i;
+        } else {
+            append_run(runs, DiffOp::Insert, 1);
+            ++j;
+        }
+    }
+    append_run(runs, DiffOp::Delete, n - i);
+    append_run(runs, DiffOp::Insert, m - j);
+}
+
+} // namespace diff_view
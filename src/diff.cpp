@@ -1,425 +1,584 @@
 #include "diff.h"
-#include "string_utils.h"
+#include "anchored_diff.h"
+#include "bit_lcs.h"
+#include "line_intern.h"
+#include "myers.h"
 
 #include <algorithm>
-#include <ranges>
+#include <array>
+#include <climits>
+#include <cstring>
+#include <functional>
 #include <grapheme_break.h>
+#include <utility>
 
 namespace diff_view {
 
 namespace {
 
-bool lines_equal(const std::string& a, const uint64_t hash_a,
-                 const std::string& b, const uint64_t hash_b) {
-    return hash_a == hash_b && a == b;
-}
-
-std::vector<DiffOp> myers_diff(const std::vector<std::string>& old_lines,
-                               const std::vector<std::string>& new_lines,
-                               const std::vector<uint64_t>& old_hashes,
-                               const std::vector<uint64_t>& new_hashes) {
-    const int n = static_cast<int>(old_lines.size());
-    const int m = static_cast<int>(new_lines.size());
-    const int max_d = n + m;
-
-    if (max_d == 0) {
-        return {};
-    }
-
-    // V[k] = x: coordinate of the furthest reaching path in diagonal k
-    const int offset = max_d;
-    std::vector v(2 * max_d + 1, 0);
-    std::vector<std::vector<int>> trace;
-    bool found = false;
-    for (int d = 0; d <= max_d && !found; ++d) {
-        trace.push_back(v);
-        for (int k = -d; k <= d; k += 2) {
-            int x;
-            if (k == -d || (k != d && v[k - 1 + offset] < v[k + 1 + offset])) {
-                x = v[k + 1 + offset]; // Move down (insert)
-            } else {
-                x = v[k - 1 + offset] + 1; // Move right (delete)
-            }
-            int y = x - k;
-            while (x < n && y < m && lines_equal(old_lines[x], old_hashes[x], new_lines[y], new_hashes[y])) {
-                ++x;
-                ++y;
-            }
-            v[k + offset] = x;
-            if (x >= n && y >= m) {
-                found = true;
-                break;
-            }
-        }
-    }
-
-    std::vector<DiffOp> result;
-    int x = n, y = m;
-    for (int d = static_cast<int>(trace.size()) - 1; d >= 0 && (x > 0 || y > 0); --d) {
-        const auto& v_prev = trace[d];
-        const int k = x - y;
-        int prev_k;
-        if (k == -d || (k != d && v_prev[k - 1 + offset] < v_prev[k + 1 + offset])) {
-            prev_k = k + 1; // Came from above (insert)
-        } else {
-            prev_k = k - 1; // Came from left (delete)
-        }
-        const int prev_x = v_prev[prev_k + offset];
-        const int prev_y = prev_x - prev_k;
-        // Add diagonal moves (equal)
-        while (x > prev_x && y > prev_y) {
-            result.push_back(DiffOp::Equal);
-            --x;
-            --y;
-        }
-        if (d > 0) {
-            if (x == prev_x) {
-                result.push_back(DiffOp::Insert);
-                --y;
-            } else {
-                result.push_back(DiffOp::Delete);
-                --x;
-            }
-        }
-    }
-    std::ranges::reverse(result);
-    return result;
-}
-
-std::vector<DiffLine> build_diff_lines(const std::vector<DiffOp>& script) {
-    std::vector<DiffLine> lines;
-    size_t old_idx = 0;
-    size_t new_idx = 0;
-    for (const auto op : script) {
-        DiffLine line{};
-        line.op = op;
-        switch (op) {
-            case DiffOp::Equal:
-                line.old_index = old_idx++;
-                line.new_index = new_idx++;
-                break;
-            case DiffOp::Delete:
-                line.old_index = old_idx++;
-                line.new_index = SIZE_MAX;
-                break;
-            case DiffOp::Insert:
-                line.old_index = SIZE_MAX;
-                line.new_index = new_idx++;
-                break;
-        }
-        lines.push_back(line);
-    }
-
-    return lines;
-}
+/**
+ * A maximal block of consecutive non-Equal runs, [first_run, last_run) in the
+ * script, starting at (old_begin, new_begin) and ending at (old_end, new_end).
+ */
+struct ChangeRange {
+    size_t first_run;
+    size_t last_run;
+    size_t old_begin;
+    size_t new_begin;
+    size_t old_end;
+    size_t new_end;
+};
 
 /**
- * Find ranges of changes (non-Equal lines).
- * Returns pairs of (start_index, end_index) in the diff_lines array.
+ * Find the ranges of changes (non-Equal runs) in the script.
  */
-std::vector<std::pair<size_t, size_t>> find_change_ranges(const std::vector<DiffLine>& lines) {
-    std::vector<std::pair<size_t, size_t>> ranges;
+void find_change_ranges(const std::vector<EditRun>& script, std::vector<ChangeRange>& ranges) {
+    ranges.clear();
+    size_t old_idx = 0, new_idx = 0;
     size_t i = 0;
-    while (i < lines.size()) {
-        while (i < lines.size() && lines[i].op == DiffOp::Equal) {
+    while (i < script.size()) {
+        if (script[i].op == DiffOp::Equal) {
+            old_idx += script[i].length;
+            new_idx += script[i].length;
             ++i;
+            continue;
         }
-        if (i >= lines.size()) {
-            break;
-        }
-        const size_t start = i;
-        while (i < lines.size() && lines[i].op != DiffOp::Equal) {
+        ChangeRange range{i, i, old_idx, new_idx, old_idx, new_idx};
+        while (i < script.size() && script[i].op != DiffOp::Equal) {
+            if (script[i].op == DiffOp::Delete) {
+                old_idx += script[i].length;
+            } else {
+                new_idx += script[i].length;
+            }
             ++i;
         }
-        ranges.emplace_back(start, i);
+        range.last_run = i;
+        range.old_end = old_idx;
+        range.new_end = new_idx;
+        ranges.push_back(range);
     }
-    return ranges;
 }
 
 /**
- * Merge change ranges that are close together (within 2 * context_lines).
+ * Merge change ranges that are close together (within 2 * context_lines), in place.
+ * Ranges are separated by exactly one Equal run, whose length is the gap.
  */
-std::vector<std::pair<size_t, size_t>> merge_ranges(
-    const std::vector<std::pair<size_t, size_t>>& ranges,
-    const size_t context_lines) {
+void merge_ranges(std::vector<ChangeRange>& ranges, const size_t context_lines) {
     if (ranges.empty()) {
-        return {};
+        return;
     }
-    std::vector<std::pair<size_t, size_t>> merged;
     const size_t gap_threshold = 2 * context_lines;
-    auto current = ranges[0];
+    size_t merged = 0;
     for (size_t i = 1; i < ranges.size(); ++i) {
-        if (const auto& next = ranges[i]; next.first <= current.second + gap_threshold) {
-            current.second = next.second;
+        auto& current = ranges[merged];
+        if (const auto& next = ranges[i]; next.old_begin - current.old_end <= gap_threshold) {
+            current.last_run = next.last_run;
+            current.old_end = next.old_end;
+            current.new_end = next.new_end;
         } else {
-            merged.push_back(current);
-            current = next;
+            ranges[++merged] = next;
         }
     }
-    merged.push_back(current);
-    return merged;
+    ranges.resize(merged + 1);
 }
 
 /**
  * Build hunks from merged ranges with context.
  */
 std::vector<DiffHunk> build_hunks(
-    const std::vector<DiffLine>& all_lines,
-    const std::vector<std::pair<size_t, size_t>>& merged_ranges,
+    const std::vector<EditRun>& script,
+    const std::vector<ChangeRange>& merged_ranges,
     const size_t context_lines) {
     std::vector<DiffHunk> hunks;
-    for (const auto& [change_start, change_end] : merged_ranges) {
+    for (const auto& range : merged_ranges) {
+        // The runs around a change range are Equal runs (or the script ends)
+        const size_t leading = range.first_run > 0
+            ? std::min(context_lines, script[range.first_run - 1].length) : 0;
+        const size_t trailing = range.last_run < script.size()
+            ? std::min(context_lines, script[range.last_run].length) : 0;
         DiffHunk hunk{};
-        const size_t hunk_start = (change_start > context_lines) ? (change_start - context_lines) : 0;
-        const size_t hunk_end = std::min(change_end + context_lines, all_lines.size());
-        bool first_old = true, first_new = true;
-        size_t old_end = 0, new_end = 0;
-        for (size_t i = hunk_start; i < hunk_end; ++i) {
-            const auto& line = all_lines[i];
-            hunk.lines.push_back(line);
-            if (line.op != DiffOp::Insert && line.old_index != SIZE_MAX) {
-                if (first_old) {
-                    hunk.old_start = line.old_index;
-                    first_old = false;
-                }
-                old_end = line.old_index + 1;
-            }
-            if (line.op != DiffOp::Delete && line.new_index != SIZE_MAX) {
-                if (first_new) {
-                    hunk.new_start = line.new_index;
-                    first_new = false;
-                }
-                new_end = line.new_index + 1;
-            }
+        hunk.old_start = range.old_begin - leading;
+        hunk.new_start = range.new_begin - leading;
+        hunk.old_count = range.old_end + trailing - hunk.old_start;
+        hunk.new_count = range.new_end + trailing - hunk.new_start;
+        hunk.runs.reserve(range.last_run - range.first_run + 2);
+        append_run(hunk.runs, DiffOp::Equal, leading);
+        for (size_t i = range.first_run; i < range.last_run; ++i) {
+            hunk.runs.push_back(script[i]);
         }
-        hunk.old_count = first_old ? 0 : (old_end - hunk.old_start);
-        hunk.new_count = first_new ? 0 : (new_end - hunk.new_start);
+        append_run(hunk.runs, DiffOp::Equal, trailing);
         hunks.push_back(std::move(hunk));
     }
 
     return hunks;
 }
 
+MyersOptions to_myers_options(const DiffOptions& options) {
+    MyersOptions myers_options;
+    myers_options.max_cost = static_cast<int>(std::min<size_t>(options.max_cost, INT_MAX));
+    if (options.time_budget.count() > 0) {
+        myers_options.deadline = std::chrono::steady_clock::now() + options.time_budget;
+    }
+    myers_options.cancel = options.cancel;
+    myers_options.pool = options.pool;
+    myers_options.parallel_threshold = options.parallel_threshold;
+    return myers_options;
+}
+
 } // anonymous namespace
 
+std::vector<DiffHunk> hunks_from_runs(const std::vector<EditRun>& runs, const size_t context_lines) {
+    std::vector<ChangeRange> ranges;
+    find_change_ranges(runs, ranges);
+    merge_ranges(ranges, context_lines);
+    return build_hunks(runs, ranges, context_lines);
+}
+
 DiffResult diff_lines(const std::string_view old_text, const std::string_view new_text, const size_t context_lines) {
-    return diff_lines(split_lines(old_text), split_lines(new_text), context_lines);
+    return diff_lines(LineTable::view(old_text), LineTable::view(new_text), context_lines);
 }
 
 DiffResult diff_lines(std::vector<std::string> old_lines, std::vector<std::string> new_lines, const size_t context_lines) {
-    DiffResult result;
-    result.old_lines = std::move(old_lines);
-    result.new_lines = std::move(new_lines);
+    return diff_lines(LineTable::from_lines(old_lines), LineTable::from_lines(new_lines), context_lines);
+}
 
-    // Compute hashes for all lines
-    std::vector<uint64_t> old_hashes;
-    std::vector<uint64_t> new_hashes;
-    old_hashes.reserve(result.old_lines.size());
-    new_hashes.reserve(result.new_lines.size());
-    for (const auto& line : result.old_lines) {
-        old_hashes.push_back(hash_string(line));
-    }
-    for (const auto& line : result.new_lines) {
-        new_hashes.push_back(hash_string(line));
-    }
+DiffResult diff_lines(LineTable old_lines, LineTable new_lines, const size_t context_lines) {
+    DiffOptions options;
+    options.context_lines = context_lines;
+    return diff_lines(std::move(old_lines), std::move(new_lines), options);
+}
 
-    // Find common prefix
-    size_t prefix_len = 0;
-    while (prefix_len < result.old_lines.size() && prefix_len < result.new_lines.size() &&
-           lines_equal(result.old_lines[prefix_len], old_hashes[prefix_len],
-                       result.new_lines[prefix_len], new_hashes[prefix_len])) {
-        ++prefix_len;
-    }
+DiffResult diff_lines(const std::string_view old_text, const std::string_view new_text, const DiffOptions& options) {
+    return diff_lines(LineTable::view(old_text), LineTable::view(new_text), options);
+}
 
-    // Find common suffix (but don't overlap with prefix)
-    size_t suffix_len = 0;
-    while (suffix_len < result.old_lines.size() - prefix_len &&
-           suffix_len < result.new_lines.size() - prefix_len &&
-           lines_equal(result.old_lines[result.old_lines.size() - 1 - suffix_len],
-                       old_hashes[result.old_lines.size() - 1 - suffix_len],
-                       result.new_lines[result.new_lines.size() - 1 - suffix_len],
-                       new_hashes[result.new_lines.size() - 1 - suffix_len])) {
-        ++suffix_len;
+DiffResult diff_lines(LineTable old_lines, LineTable new_lines, const DiffOptions& options) {
+    return DiffEngine::local().diff_lines(std::move(old_lines), std::move(new_lines), options);
+}
+
+std::vector<DiffLine> expand_hunk(const DiffHunk& hunk) {
+    std::vector<DiffLine> lines;
+    size_t old_idx = hunk.old_start;
+    size_t new_idx = hunk.new_start;
+    for (const auto& [op, length] : hunk.runs) {
+        for (size_t i = 0; i < length; ++i) {
+            switch (op) {
+                case DiffOp::Equal:
+                    lines.push_back({op, old_idx++, new_idx++});
+                    break;
+                case DiffOp::Delete:
+                    lines.push_back({op, old_idx++, SIZE_MAX});
+                    break;
+                case DiffOp::Insert:
+                    lines.push_back({op, SIZE_MAX, new_idx++});
+                    break;
+            }
+        }
     }
+    return lines;
+}
 
-    // Build edit script with prefix/suffix optimization
-    std::vector<DiffOp> script;
+namespace {
 
-    // Add prefix as Equal
-    for (size_t i = 0; i < prefix_len; ++i) {
-        script.push_back(DiffOp::Equal);
+void append_range(std::vector<CharDiffRange>& ranges, const DiffOp op, const size_t begin, const size_t end) {
+    if (!ranges.empty() && ranges.back().op == op) {
+        ranges.back().end = static_cast<uint32_t>(end);
+    } else {
+        ranges.push_back({op, static_cast<uint32_t>(begin), static_cast<uint32_t>(end)});
     }
+}
 
-    // Run Myers on the middle portion
-    const size_t old_mid_start = prefix_len;
-    const size_t old_mid_end = result.old_lines.size() - suffix_len;
-    const size_t new_mid_start = prefix_len;
-    const size_t new_mid_end = result.new_lines.size() - suffix_len;
-
-    if (old_mid_start < old_mid_end || new_mid_start < new_mid_end) {
-        std::vector<std::string> old_mid(result.old_lines.begin() + old_mid_start,
-                                          result.old_lines.begin() + old_mid_end);
-        std::vector<std::string> new_mid(result.new_lines.begin() + new_mid_start,
-                                          result.new_lines.begin() + new_mid_end);
-        std::vector<uint64_t> old_mid_hashes(old_hashes.begin() + old_mid_start,
-                                              old_hashes.begin() + old_mid_end);
-        std::vector<uint64_t> new_mid_hashes(new_hashes.begin() + new_mid_start,
-                                              new_hashes.begin() + new_mid_end);
-
-        const auto mid_script = myers_diff(old_mid, new_mid, old_mid_hashes, new_mid_hashes);
-        script.insert(script.end(), mid_script.begin(), mid_script.end());
-    }
+/**
+ * Bytes taken by `count` tokens from `begin`: a string is its own byte tokens,
+ * grapheme clusters are views.
+ */
+size_t token_bytes(std::string_view, size_t, const size_t count) {
+    return count;
+}
 
-    // Add suffix as Equal
-    for (size_t i = 0; i < suffix_len; ++i) {
-        script.push_back(DiffOp::Equal);
+size_t token_bytes(const std::vector<std::string_view>& clusters, const size_t begin, const size_t count) {
+    size_t bytes = 0;
+    for (size_t i = begin; i < begin + count; ++i) {
+        bytes += clusters[i].size();
     }
+    return bytes;
+}
 
-    const auto all_lines = build_diff_lines(script);
-    const auto change_ranges = find_change_ranges(all_lines);
-    const auto merged_ranges = merge_ranges(change_ranges, context_lines);
-    result.hunks = build_hunks(all_lines, merged_ranges, context_lines);
+/**
+ * Byte ranges of an edit script over the tokens of both strings.
+ */
+template <typename OldTokens, typename NewTokens>
+CharDiffRanges to_ranges(const OldTokens& old_tokens, const NewTokens& new_tokens, const std::vector<EditRun>& script) {
+    CharDiffRanges result;
+    size_t old_idx = 0, new_idx = 0;
+    size_t old_pos = 0, new_pos = 0;
+    for (const auto& [op, length] : script) {
+        if (op != DiffOp::Insert) {
+            const size_t bytes = token_bytes(old_tokens, old_idx, length);
+            append_range(result.old_ranges, op, old_pos, old_pos + bytes);
+            old_idx += length;
+            old_pos += bytes;
+        }
+        if (op != DiffOp::Delete) {
+            const size_t bytes = token_bytes(new_tokens, new_idx, length);
+            append_range(result.new_ranges, op, new_pos, new_pos + bytes);
+            new_idx += length;
+            new_pos += bytes;
+        }
+    }
     return result;
 }
 
-namespace {
+constexpr uint64_t HIGH_BITS = 0x8080808080808080ULL;
 
 /**
- * Myers diff for grapheme clusters.
+ * Position of the first byte >= 0x80 at or after `pos`, or the string size.
+ * Eight bytes are checked at a time.
  */
-std::vector<DiffOp> myers_diff_graphemes(const std::vector<std::string>& old_graphemes,
-                                          const std::vector<std::string>& new_graphemes) {
-    const int n = static_cast<int>(old_graphemes.size());
-    const int m = static_cast<int>(new_graphemes.size());
-    const int max_d = n + m;
-    if (max_d == 0) {
-        return {};
+size_t find_non_ascii(const std::string_view str, size_t pos) {
+    for (; pos + 8 <= str.size(); pos += 8) {
+        uint64_t word;
+        std::memcpy(&word, str.data() + pos, sizeof(word));
+        if ((word & HIGH_BITS) != 0) {
+            break;
+        }
     }
-    const int offset = max_d;
-    std::vector v(2 * max_d + 1, 0);
-    std::vector<std::vector<int>> trace;
-    bool found = false;
-    for (int d = 0; d <= max_d && !found; ++d) {
-        trace.push_back(v);
-        for (int k = -d; k <= d; k += 2) {
-            int x;
-            if (k == -d || (k != d && v[k - 1 + offset] < v[k + 1 + offset])) {
-                x = v[k + 1 + offset];
-            } else {
-                x = v[k - 1 + offset] + 1;
-            }
-            int y = x - k;
-            while (x < n && y < m && old_graphemes[x] == new_graphemes[y]) {
-                ++x;
-                ++y;
-            }
-            v[k + offset] = x;
-            if (x >= n && y >= m) {
-                found = true;
-                break;
+    while (pos < str.size() && static_cast<unsigned char>(str[pos]) < 0x80) {
+        ++pos;
+    }
+    return pos;
+}
+
+/**
+ * Whether every grapheme cluster of the string is a single byte: ASCII
+ * without CR LF, the only cluster ASCII characters form together.
+ */
+bool single_byte_clusters(const std::string_view str) {
+    return find_non_ascii(str, 0) == str.size() && str.find("\r\n") == std::string_view::npos;
+}
+
+/**
+ * Grapheme clusters of a string, as views into it, into `clusters`.
+ *
+ * There is a cluster boundary between any two ASCII bytes but CR LF, so runs
+ * of ASCII are split byte by byte. Only the non-ASCII parts go through the
+ * full segmentation, together with the ASCII clusters around them that
+ * they may join: a base for combining marks before, a prepended character's
+ * target (or bytes taken by an invalid sequence) after.
+ */
+void grapheme_clusters(const std::string_view str, std::vector<std::string_view>& clusters) {
+    const auto ascii_cluster_size = [str](const size_t pos) -> size_t {
+        return str[pos] == '\r' && pos + 1 < str.size() && str[pos + 1] == '\n' ? 2 : 1;
+    };
+    clusters.clear();
+    clusters.reserve(str.size());
+    size_t pos = 0;
+    while (pos < str.size()) {
+        const size_t non_ascii = find_non_ascii(str, pos);
+        // Keep the last ASCII cluster before the non-ASCII part for the segmentation
+        size_t ascii_end = non_ascii;
+        if (non_ascii < str.size() && non_ascii > pos) {
+            ascii_end = non_ascii - 1;
+            if (ascii_end > pos && str[ascii_end - 1] == '\r' && str[ascii_end] == '\n') {
+                --ascii_end;
             }
         }
-    }
-    std::vector<DiffOp> result;
-    int x = n, y = m;
-    for (int d = static_cast<int>(trace.size()) - 1; d >= 0 && (x > 0 || y > 0); --d) {
-        const auto& v_prev = trace[d];
-        const int k = x - y;
-        int prev_k;
-        if (k == -d || (k != d && v_prev[k - 1 + offset] < v_prev[k + 1 + offset])) {
-            prev_k = k + 1;
-        } else {
-            prev_k = k - 1;
+        while (pos < ascii_end) {
+            const size_t size = ascii_cluster_size(pos);
+            clusters.push_back(str.substr(pos, size));
+            pos += size;
         }
-        const int prev_x = v_prev[prev_k + offset];
-        const int prev_y = prev_x - prev_k;
-        while (x > prev_x && y > prev_y) {
-            result.push_back(DiffOp::Equal);
-            --x;
-            --y;
+        if (non_ascii == str.size()) {
+            break;
         }
-        if (d > 0) {
-            if (x == prev_x) {
-                result.push_back(DiffOp::Insert);
-                --y;
-            } else {
-                result.push_back(DiffOp::Delete);
-                --x;
+        // Extend over the non-ASCII bytes and the ASCII clusters after them that
+        // the last one may join: up to three taken by a truncated UTF-8
+        // sequence, then one that a prepended character joins
+        size_t end = non_ascii;
+        while (end < str.size() && static_cast<unsigned char>(str[end]) >= 0x80) {
+            while (end < str.size() && static_cast<unsigned char>(str[end]) >= 0x80) {
+                ++end;
+            }
+            for (int i = 0; i < 4 && end < str.size() && static_cast<unsigned char>(str[end]) < 0x80; ++i) {
+                end += ascii_cluster_size(end);
             }
         }
+        for (const auto& cluster : grapheme_break::segmentGraphemeClusters(std::string(str.substr(pos, end - pos)))) {
+            clusters.push_back(str.substr(pos, cluster.size()));
+            pos += cluster.size();
+        }
     }
-    std::ranges::reverse(result);
-    return result;
 }
 
-void append_to_segments(std::vector<CharDiffSegment>& segments,
-                        const DiffOp op, const std::string& text) {
-    if (!segments.empty() && segments.back().op == op) {
-        segments.back().text += text;
-    } else {
-        segments.push_back({op, text});
+/**
+ * Call `fn` with the grapheme clusters of both strings as token sequences:
+ * the strings themselves when every cluster is a single byte, the given
+ * buffers filled with the clusters otherwise.
+ */
+template <typename Fn>
+auto with_clusters(const std::string_view old_str, const std::string_view new_str,
+                   std::vector<std::string_view>& old_clusters, std::vector<std::string_view>& new_clusters, Fn fn) {
+    if (single_byte_clusters(old_str) && single_byte_clusters(new_str)) {
+        return fn(old_str, new_str);
     }
+    grapheme_clusters(old_str, old_clusters);
+    grapheme_clusters(new_str, new_clusters);
+    return fn(std::as_const(old_clusters), std::as_const(new_clusters));
+}
+
+/**
+ * Short strings of single-byte clusters are diffed by the bit-parallel LCS.
+ */
+bool use_bit_lcs(const std::string_view old_str, const std::string_view new_str) {
+    return old_str.size() <= BitLcs::MAX_LENGTH && new_str.size() <= BitLcs::MAX_LENGTH &&
+           single_byte_clusters(old_str) && single_byte_clusters(new_str);
+}
+
+std::vector<CharDiffSegment> to_segments(const std::string_view str, const std::vector<CharDiffRange>& ranges) {
+    std::vector<CharDiffSegment> segments;
+    segments.reserve(ranges.size());
+    for (const auto& [op, begin, end] : ranges) {
+        segments.push_back({op, std::string(str.substr(begin, end - begin))});
+    }
+    return segments;
 }
 
 } // anonymous namespace
 
 CharDiffResult diff_chars(const std::string_view old_str, const std::string_view new_str) {
-    CharDiffResult result;
-    const auto old_graphemes = grapheme_break::segmentGraphemeClusters(std::string(old_str));
-    const auto new_graphemes = grapheme_break::segmentGraphemeClusters(std::string(new_str));
-    size_t prefix_len = 0;
-    while (prefix_len < old_graphemes.size()
-        && prefix_len < new_graphemes.size()
-        && old_graphemes[prefix_len] == new_graphemes[prefix_len]) {
-        ++prefix_len;
+    const auto ranges = diff_char_ranges(old_str, new_str);
+    return {to_segments(old_str, ranges.old_ranges), to_segments(new_str, ranges.new_ranges)};
+}
+
+CharDiffRanges diff_char_ranges(const std::string_view old_str, const std::string_view new_str) {
+    return DiffEngine::local().diff_char_ranges(old_str, new_str);
+}
+
+double char_similarity(const CharDiffRanges& ranges) {
+    size_t equal_chars = 0;
+    size_t total_old_chars = 0;
+    size_t total_new_chars = 0;
+    for (const auto& [op, begin, end] : ranges.old_ranges) {
+        total_old_chars += end - begin;
+        if (op == DiffOp::Equal) {
+            equal_chars += end - begin;
+        }
     }
-    size_t suffix_len = 0;
-    while (suffix_len < old_graphemes.size() - prefix_len
-        && suffix_len < new_graphemes.size() - prefix_len
-        && old_graphemes[old_graphemes.size() - 1 - suffix_len] == new_graphemes[new_graphemes.size() - 1 - suffix_len]) {
-        ++suffix_len;
+    for (const auto& [op, begin, end] : ranges.new_ranges) {
+        total_new_chars += end - begin;
     }
-    for (size_t i = 0; i < prefix_len; ++i) {
-        append_to_segments(result.old_segments, DiffOp::Equal, old_graphemes[i]);
-        append_to_segments(result.new_segments, DiffOp::Equal, new_graphemes[i]);
+    const size_t total_chars = std::max(total_old_chars, total_new_chars);
+    if (total_chars == 0) {
+        return 1.0;
     }
-    const size_t old_mid_start = prefix_len;
-    const size_t old_mid_end = old_graphemes.size() - suffix_len;
-    const size_t new_mid_start = prefix_len;
-    const size_t new_mid_end = new_graphemes.size() - suffix_len;
-    if (old_mid_start < old_mid_end || new_mid_start < new_mid_end) {
-        const std::vector old_mid(old_graphemes.begin() + old_mid_start, old_graphemes.begin() + old_mid_end);
-        const std::vector new_mid(new_graphemes.begin() + new_mid_start, new_graphemes.begin() + new_mid_end);
-        const auto script = myers_diff_graphemes(old_mid, new_mid);
-        size_t old_idx = 0;
-        size_t new_idx = 0;
-        for (const auto op : script) {
-            switch (op) {
-                case DiffOp::Equal:
-                    append_to_segments(result.old_segments, DiffOp::Equal, old_mid[old_idx]);
-                    append_to_segments(result.new_segments, DiffOp::Equal, new_mid[new_idx]);
-                    ++old_idx;
-                    ++new_idx;
-                    break;
-                case DiffOp::Delete:
-                    append_to_segments(result.old_segments, DiffOp::Delete, old_mid[old_idx]);
-                    ++old_idx;
-                    break;
-                case DiffOp::Insert:
-                    append_to_segments(result.new_segments, DiffOp::Insert, new_mid[new_idx]);
-                    ++new_idx;
-                    break;
-            }
+    return static_cast<double>(equal_chars) / static_cast<double>(total_chars);
+}
+
+std::optional<CharDiffRanges> similar_char_ranges(const std::string_view old_str, const std::string_view new_str,
+                                                  const double threshold, SimilarityStats* stats) {
+    return DiffEngine::local().similar_char_ranges(old_str, new_str, threshold, stats);
+}
+
+struct DiffEngine::Scratch {
+    LineTable old_lines;  // Texts of edit_runs()
+    LineTable new_lines;
+    LineInterner interner;
+    InternedLines interned;
+    MyersScratch myers;
+    std::vector<EditRun> script;
+    std::vector<ChangeRange> change_ranges;
+    std::vector<std::string_view> old_clusters;
+    std::vector<std::string_view> new_clusters;
+    BitLcs lcs;
+};
+
+DiffEngine::DiffEngine(std::pmr::memory_resource* resource)
+    : resource_(resource), scratch_(std::make_unique<Scratch>()) {}
+
+DiffEngine::~DiffEngine() = default;
+
+DiffEngine& DiffEngine::local() {
+    // More than one only when a progress callback diffs again on the thread
+    thread_local std::vector<std::unique_ptr<DiffEngine>> engines;
+    for (const auto& engine : engines) {
+        if (!engine->busy_) {
+            return *engine;
         }
     }
-    for (size_t i = old_graphemes.size() - suffix_len; i < old_graphemes.size(); ++i) {
-        append_to_segments(result.old_segments, DiffOp::Equal, old_graphemes[i]);
+    engines.push_back(std::make_unique<DiffEngine>());
+    return *engines.back();
+}
+
+void DiffEngine::release() {
+    scratch_ = std::make_unique<Scratch>();
+}
+
+void DiffEngine::line_script(const LineTable& old_lines, const LineTable& new_lines, const DiffOptions& options,
+                             bool& approximate, PhaseProgress* progress) {
+    auto& scratch = *scratch_;
+    auto myers_options = to_myers_options(options);
+    myers_options.scratch = &scratch.myers;
+    myers_options.progress = progress;
+    // Map every line to a dense class ID so that comparisons are integer compares
+    scratch.interner.intern(old_lines, new_lines, scratch.interned);
+    scratch.script.clear();
+    if (options.cancel != nullptr && options.cancel->cancelled()) {
+        return;
+    }
+    switch (options.algorithm) {
+        case DiffAlgorithm::Myers:
+            append_myers_edit_runs(scratch.script, scratch.interned.old_ids, scratch.interned.new_ids,
+                                   std::equal_to<>{}, myers_options, &approximate);
+            break;
+        case DiffAlgorithm::Patience:
+            scratch.script = patience_diff(scratch.interned, myers_options, &approximate);
+            break;
+        case DiffAlgorithm::Histogram:
+            scratch.script = histogram_diff(scratch.interned, myers_options, &approximate);
+            break;
     }
-    for (size_t i = new_graphemes.size() - suffix_len; i < new_graphemes.size(); ++i) {
-        append_to_segments(result.new_segments, DiffOp::Equal, new_graphemes[i]);
+}
+
+DiffResult DiffEngine::diff_lines(LineTable old_lines, LineTable new_lines, const DiffOptions& options) {
+    struct Busy {
+        bool& busy;
+        explicit Busy(bool& flag) : busy(flag) { busy = true; }
+        ~Busy() { busy = false; }
+    } busy(busy_);
+    DiffResult result;
+    result.old_lines = std::move(old_lines);
+    result.new_lines = std::move(new_lines);
+    PhaseProgress progress(options.progress, DiffPhase::Lines, result.old_lines.size() + result.new_lines.size());
+    line_script(result.old_lines, result.new_lines, options, result.approximate, &progress);
+    if (options.cancel != nullptr && options.cancel->cancelled()) {
+        result.approximate = false;
+        result.cancelled = true;
+        return result;
     }
+    progress.finish();
 
+    auto& scratch = *scratch_;
+    find_change_ranges(scratch.script, scratch.change_ranges);
+    merge_ranges(scratch.change_ranges, options.context_lines);
+    result.hunks = build_hunks(scratch.script, scratch.change_ranges, options.context_lines);
     return result;
 }
 
+std::pmr::vector<EditRun> DiffEngine::edit_runs(const std::string_view old_text, const std::string_view new_text,
+                                                const DiffOptions& options, bool* approximate) {
+    auto& scratch = *scratch_;
+    scratch.old_lines.assign_view(old_text);
+    scratch.new_lines.assign_view(new_text);
+    return edit_runs(scratch.old_lines, scratch.new_lines, options, approximate);
+}
+
+std::pmr::vector<EditRun> DiffEngine::edit_runs(const LineTable& old_lines, const LineTable& new_lines,
+                                                const DiffOptions& options, bool* approximate) {
+    bool hit_budget = false;
+    line_script(old_lines, new_lines, options, hit_budget);
+    if (approximate != nullptr) {
+        *approximate = hit_budget;
+    }
+    const auto& script = scratch_->script;
+    return {script.begin(), script.end(), resource_};
+}
+
+CharDiffRanges DiffEngine::diff_char_ranges(const std::string_view old_str, const std::string_view new_str) {
+    auto& scratch = *scratch_;
+    scratch.script.clear();
+    if (use_bit_lcs(old_str, new_str)) {
+        scratch.lcs.assign(old_str, new_str);
+        scratch.lcs.edit_runs(scratch.script);
+        return to_ranges(old_str, new_str, scratch.script);
+    }
+    return with_clusters(old_str, new_str, scratch.old_clusters, scratch.new_clusters,
+                         [&scratch](const auto& old_tokens, const auto& new_tokens) {
+        MyersOptions options;
+        options.scratch = &scratch.myers;
+        append_myers_edit_runs(scratch.script, old_tokens, new_tokens, std::equal_to<>{}, options);
+        return to_ranges(old_tokens, new_tokens, scratch.script);
+    });
+}
+
+std::optional<CharDiffRanges> DiffEngine::similar_char_ranges(const std::string_view old_str,
+                                                              const std::string_view new_str, const double threshold,
+                                                              SimilarityStats* stats) {
+    auto& scratch = *scratch_;
+    SimilarityStats ignored;
+    auto& counts = stats != nullptr ? *stats : ignored;
+    ++counts.compared;
+    // Same arithmetic as char_similarity(), so every bound decides exactly as the full diff would
+    const size_t longest = std::max(old_str.size(), new_str.size());
+    const auto reaches = [longest, threshold](const size_t equal_bytes) {
+        return longest == 0 || static_cast<double>(equal_bytes) / static_cast<double>(longest) >= threshold;
+    };
+    if (!reaches(std::min(old_str.size(), new_str.size()))) {
+        ++counts.length_rejected;
+        return std::nullopt;
+    }
+    // Equal grapheme clusters are equal bytes, so the common bytes bound the equal ones
+    std::array<uint32_t, 256> byte_counts{};
+    for (const char c : old_str) {
+        ++byte_counts[static_cast<unsigned char>(c)];
+    }
+    size_t common = 0;
+    for (const char c : new_str) {
+        auto& count = byte_counts[static_cast<unsigned char>(c)];
+        if (count > 0) {
+            --count;
+            ++common;
+        }
+    }
+    if (!reaches(common)) {
+        ++counts.bytes_rejected;
+        return std::nullopt;
+    }
+    if (use_bit_lcs(old_str, new_str)) {
+        // The LCS length is the similarity, the alignment is only read back for similar pairs
+        scratch.lcs.assign(old_str, new_str);
+        if (!reaches(scratch.lcs.length())) {
+            ++counts.lcs_rejected;
+            return std::nullopt;
+        }
+        scratch.script.clear();
+        scratch.lcs.edit_runs(scratch.script);
+        return to_ranges(old_str, new_str, scratch.script);
+    }
+
+    // Each deleted or inserted cluster takes at least one byte away from the
+    // equal ones, which bounds the edit distance of a similar enough pair
+    size_t needed = static_cast<size_t>(std::max(0.0, threshold * static_cast<double>(longest)));
+    needed = std::min(needed, common);
+    while (needed > 0 && reaches(needed - 1)) {
+        --needed;
+    }
+    while (!reaches(needed)) {
+        ++needed;
+    }
+    return with_clusters(old_str, new_str, scratch.old_clusters, scratch.new_clusters,
+                         [&](const auto& old_tokens, const auto& new_tokens) -> std::optional<CharDiffRanges> {
+        // D = deleted + inserted and deleted - inserted = size difference
+        const auto size_delta = static_cast<int64_t>(old_tokens.size()) - static_cast<int64_t>(new_tokens.size());
+        const int64_t max_distance = std::min(2 * static_cast<int64_t>(old_str.size() - needed) - size_delta,
+                                              2 * static_cast<int64_t>(new_str.size() - needed) + size_delta);
+        if (max_distance <= 0 && old_str != new_str) {
+            ++counts.distance_rejected;
+            return std::nullopt;
+        }
+        MyersOptions options;
+        options.max_distance = static_cast<int>(std::clamp<int64_t>(max_distance, 0, INT_MAX));
+        options.scratch = &scratch.myers;
+        scratch.script.clear();
+        if (!append_myers_edit_runs(scratch.script, old_tokens, new_tokens, std::equal_to<>{}, options)) {
+            ++counts.distance_rejected;
+            return std::nullopt;
+        }
+        auto ranges = to_ranges(old_tokens, new_tokens, scratch.script);
+        if (char_similarity(ranges) < threshold) {
+            return std::nullopt;
+        }
+        return ranges;
+    });
+}
+
 } // namespace diff_view
@@ -0,0 +1,205 @@
+#include "diff_cache.h"
+#include "mapped_file.h"
+#include "serialization.h"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <utility>
+
+namespace diff_view {
+
+namespace {
+
+// Kinds of entries, part of the key
+constexpr char DIFF_ENTRY = 'D';
+constexpr char VIEW_ENTRY = 'V';
+// Bumped whenever the results change, so that the entries of older versions
+// in a directory are not found again; the format carries its own version
+constexpr std::string_view KEY_PREFIX = "diff-view cache 2\n";
+
+void hash_u64(Sha256& hash, const uint64_t value) {
+    char bytes[8];
+    for (int i = 0; i < 8; ++i) {
+        bytes[i] = static_cast<char>(value >> (i * 8));
+    }
+    hash.update({bytes, sizeof(bytes)});
+}
+
+Sha256Digest make_key(const char kind, const std::string_view old_text, const std::string_view new_text,
+                      const DiffOptions& options, const bool fold_unchanged) {
+    Sha256 hash;
+    hash.update(KEY_PREFIX);
+    hash.update({&kind, 1});
+    hash_u64(hash, options.context_lines);
+    hash_u64(hash, static_cast<uint64_t>(options.algorithm));
+    hash_u64(hash, options.max_cost);
+    hash_u64(hash, fold_unchanged ? 1 : 0);
+    // A parallel search may pick another, equally minimal, alignment
+    hash_u64(hash, options.pool != nullptr ? options.parallel_threshold : 0);
+    // Sizes first, so that no two pairs give the same byte stream
+    hash_u64(hash, old_text.size());
+    hash_u64(hash, new_text.size());
+    hash.update(old_text);
+    hash.update(new_text);
+    return hash.finish();
+}
+
+std::filesystem::path entry_path(const std::string& directory, const Sha256Digest& key) {
+    return std::filesystem::path(directory) / to_hex(key);
+}
+
+/**
+ * Write an entry file under a temporary name first, so that other readers
+ * of the directory never see it half written.
+ */
+void write_entry_file(const std::filesystem::path& path, const std::string_view value) {
+    static std::atomic<uint64_t> next_id{0};
+    auto temporary = path;
+    temporary += ".tmp" + std::to_string(next_id.fetch_add(1, std::memory_order_relaxed)) + "-" +
+                 std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(value.data(), static_cast<std::streamsize>(value.size()))) {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(temporary, error);
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+    }
+}
+
+} // namespace
+
+struct DiffCache::Entry {
+    Sha256Digest key;
+    std::shared_ptr<const std::string> value;
+};
+
+size_t DiffCache::DigestHash::operator()(const Sha256Digest& digest) const {
+    size_t value;
+    std::memcpy(&value, digest.data(), sizeof(value));
+    return value;
+}
+
+DiffCache::DiffCache(DiffCacheOptions options) : options_(std::move(options)) {}
+
+DiffCache::~DiffCache() = default;
+
+DiffResult DiffCache::diff_lines(const std::string_view old_text, const std::string_view new_text,
+                                 const DiffOptions& options) {
+    const auto key = make_key(DIFF_ENTRY, old_text, new_text, options, false);
+    if (auto result = find<DiffResult>(key, [&](const std::string_view value) {
+            return deserialize_diff(value, LineTable::view(old_text), LineTable::view(new_text));
+        })) {
+        return std::move(*result);
+    }
+    auto result = diff_view::diff_lines(old_text, new_text, options);
+    if (!result.approximate && !result.cancelled) {
+        insert(key, serialize(result, false));
+    }
+    return result;
+}
+
+ViewModel DiffCache::view_model(const std::string_view old_text, const std::string_view new_text,
+                                const ViewOptions& options) {
+    const auto key = make_key(VIEW_ENTRY, old_text, new_text, options.diff, options.fold_unchanged);
+    if (auto vm = find<ViewModel>(key, [&](const std::string_view value) {
+            return deserialize_view_model(value, LineTable::copy(old_text), LineTable::copy(new_text));
+        })) {
+        return std::move(*vm);
+    }
+    auto vm = LazyViewModel(old_text, new_text, options).to_view_model();
+    if (!vm.approximate && !vm.cancelled) {
+        insert(key, serialize(vm, false));
+    }
+    return vm;
+}
+
+template <typename Result, typename Decode>
+std::optional<Result> DiffCache::find(const Sha256Digest& key, Decode decode) {
+    // Only entries that decode count as hits; the others are recomputed and
+    // replaced
+    std::shared_ptr<const std::string> value;
+    {
+        const std::lock_guard lock(mutex_);
+        if (const auto it = index_.find(key); it != index_.end()) {
+            entries_.splice(entries_.begin(), entries_, it->second);
+            value = it->second->value;
+        }
+    }
+    if (value) {
+        if (auto result = decode(*value)) {
+            const std::lock_guard lock(mutex_);
+            ++stats_.hits;
+            return result;
+        }
+    } else if (!options_.directory.empty()) {
+        if (const auto file = MappedFile::open(entry_path(options_.directory, key).string())) {
+            if (auto result = decode(file->text())) {
+                const std::lock_guard lock(mutex_);
+                ++stats_.disk_hits;
+                insert_locked(key, std::make_shared<const std::string>(file->text()));
+                return result;
+            }
+        }
+    }
+    const std::lock_guard lock(mutex_);
+    ++stats_.misses;
+    return std::nullopt;
+}
+
+void DiffCache::insert(const Sha256Digest& key, std::string value) {
+    if (!options_.directory.empty()) {
+        write_entry_file(entry_path(options_.directory, key), value);
+    }
+    const std::lock_guard lock(mutex_);
+    insert_locked(key, std::make_shared<const std::string>(std::move(value)));
+}
+
+void DiffCache::insert_locked(const Sha256Digest& key, std::shared_ptr<const std::string> value) {
+    // A value that did not decode is replaced by the one computed instead
+    if (const auto it = index_.find(key); it != index_.end()) {
+        stats_.bytes -= it->second->value->size() + sizeof(Entry);
+        entries_.erase(it->second);
+        index_.erase(it);
+    }
+    const size_t size = value->size() + sizeof(Entry);
+    if (size > options_.byte_budget) {
+        return;
+    }
+    while (stats_.bytes + size > options_.byte_budget) {
+        const auto& oldest = entries_.back();
+        stats_.bytes -= oldest.value->size() + sizeof(Entry);
+        index_.erase(oldest.key);
+        entries_.pop_back();
+        ++stats_.evictions;
+    }
+    entries_.push_front({key, std::move(value)});
+    index_.emplace(key, entries_.begin());
+    stats_.bytes += size;
+}
+
+DiffCacheStats DiffCache::stats() const {
+    const std::lock_guard lock(mutex_);
+    auto stats = stats_;
+    stats.entries = entries_.size();
+    return stats;
+}
+
+void DiffCache::clear() {
+    const std::lock_guard lock(mutex_);
+    entries_.clear();
+    index_.clear();
+    stats_.bytes = 0;
+}
+
+} // namespace diff_view
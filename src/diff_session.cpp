@@ -0,0 +1,216 @@
+#include "diff_session.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace diff_view {
+
+namespace {
+
+/**
+ * Append steps [from, to) of a script, counting the steps of all its runs.
+ */
+void append_steps(std::vector<EditRun>& out, const std::vector<EditRun>& script, const size_t from, const size_t to) {
+    size_t step = 0;
+    for (const auto& [op, length] : script) {
+        if (step >= to) {
+            break;
+        }
+        const size_t begin = std::max(from, step);
+        const size_t end = std::min(to, step + length);
+        if (begin < end) {
+            append_run(out, op, end - begin);
+        }
+        step += length;
+    }
+}
+
+/**
+ * Lines hidden by each row of a view model: the fold size for Folded rows, 1 otherwise.
+ */
+std::vector<uint32_t> row_line_counts(const ViewModel& vm) {
+    std::vector<uint32_t> counts(vm.lines.size(), 1);
+    for (const auto& [row, count] : vm.folds) {
+        counts[row] = count;
+    }
+    return counts;
+}
+
+bool same_side(const SideInfo& before, const SideInfo& after, const int64_t shift) {
+    if (before.kind != after.kind) {
+        return false;
+    }
+    return before.line_no == 0 ? after.line_no == 0 : before.line_no + shift == after.line_no;
+}
+
+/**
+ * Whether a side shows any of lines [first, first + count) (0-based).
+ */
+bool shows_lines(const SideInfo& side, const uint32_t line_count, const size_t first, const size_t count) {
+    if (side.kind == LineKind::Blank || count == 0) {
+        return false;
+    }
+    const size_t begin = side.line_no - 1;
+    return begin < first + count && first < begin + line_count;
+}
+
+/**
+ * Whether a row is kept by an edit: it has the same kinds, line numbers
+ * (moved by the shifts) and fold size, and shows none of the lines diffed again.
+ */
+bool same_row(const ViewLine& before, const uint32_t before_count, const ViewLine& after, const uint32_t after_count,
+              const std::pair<LineEdit, LineEdit>& region, const int32_t old_line_shift, const int32_t new_line_shift) {
+    const auto& [old_region, new_region] = region;
+    return same_side(before.left, after.left, old_line_shift) &&
+           same_side(before.right, after.right, new_line_shift) &&
+           before_count == after_count &&
+           !shows_lines(before.left, before_count, old_region.first, old_region.removed) &&
+           !shows_lines(before.right, before_count, new_region.first, new_region.removed) &&
+           !shows_lines(after.left, after_count, old_region.first, old_region.added) &&
+           !shows_lines(after.right, after_count, new_region.first, new_region.added);
+}
+
+/**
+ * The rows between the common head of two view models and their common tail,
+ * the tail's line numbers being moved by the given shifts. Rows showing the
+ * lines diffed again are never part of the head or tail, as their text and
+ * highlights may have changed.
+ */
+RowPatch diff_rows(const ViewModel& before, const ViewModel& after, const std::pair<LineEdit, LineEdit>& region,
+                   const int32_t old_line_shift, const int32_t new_line_shift) {
+    const auto before_counts = row_line_counts(before);
+    const auto after_counts = row_line_counts(after);
+    const size_t before_size = before.lines.size();
+    const size_t after_size = after.lines.size();
+    const size_t limit = std::min(before_size, after_size);
+    size_t head = 0;
+    while (head < limit && same_row(before.lines[head], before_counts[head], after.lines[head], after_counts[head],
+                                    region, 0, 0)) {
+        ++head;
+    }
+    size_t tail = 0;
+    while (tail < limit - head) {
+        const size_t before_row = before_size - 1 - tail;
+        const size_t after_row = after_size - 1 - tail;
+        if (!same_row(before.lines[before_row], before_counts[before_row], after.lines[after_row],
+                      after_counts[after_row], region, old_line_shift, new_line_shift)) {
+            break;
+        }
+        ++tail;
+    }
+    return {
+        static_cast<uint32_t>(head),
+        static_cast<uint32_t>(before_size - head - tail),
+        static_cast<uint32_t>(after_size - head - tail),
+        old_line_shift,
+        new_line_shift,
+    };
+}
+
+} // namespace
+
+DiffSession::DiffSession(std::string old_text, std::string new_text, const ViewOptions& options)
+    : options_(options),
+      old_text_(std::move(old_text)),
+      new_text_(std::move(new_text)),
+      old_lines_(LineTable::view(old_text_)),
+      new_lines_(LineTable::view(new_text_)) {
+    const auto runs = engine_.edit_runs(old_lines_, new_lines_, options_.diff, &approximate_);
+    script_.assign(runs.begin(), runs.end());
+    build_view_model();
+}
+
+RowPatch DiffSession::apply(const TextEdit& edit) {
+    auto& text = edit.side == DiffSide::Old ? old_text_ : new_text_;
+    auto& lines = edit.side == DiffSide::Old ? old_lines_ : new_lines_;
+    const size_t end = std::min(edit.end, text.size());
+    const size_t begin = std::min(edit.begin, end);
+    const auto old_line_count = static_cast<int64_t>(old_lines_.size());
+    const auto new_line_count = static_cast<int64_t>(new_lines_.size());
+
+    text.replace(begin, end - begin, edit.text);
+    const auto region = rediff(edit.side, lines.edit_view(text, begin, end, edit.text.size()));
+
+    const auto previous = std::move(view_model_);
+    build_view_model();
+    return diff_rows(previous, view_model_, region,
+                     static_cast<int32_t>(static_cast<int64_t>(old_lines_.size()) - old_line_count),
+                     static_cast<int32_t>(static_cast<int64_t>(new_lines_.size()) - new_line_count));
+}
+
+std::pair<LineEdit, LineEdit> DiffSession::rediff(const DiffSide side, const LineEdit& edit) {
+    // The region to diff again runs from the last Equal step before the edited
+    // lines to the first one after them, on the edited side; positions are
+    // (step of the script, old line, new line) before the edit
+    const bool old_side = side == DiffSide::Old;
+    const size_t edit_end = edit.first + edit.removed;
+    size_t step = 0, old_pos = 0, new_pos = 0;
+    size_t start_step = 0, start_old = 0, start_new = 0;
+    size_t end_step = SIZE_MAX, end_old = 0, end_new = 0;
+    for (const auto& [op, length] : script_) {
+        if (op == DiffOp::Equal) {
+            const size_t side_pos = old_side ? old_pos : new_pos;
+            if (side_pos < edit.first) {
+                const size_t count = std::min(side_pos + length, edit.first) - side_pos;
+                start_step = step + count;
+                start_old = old_pos + count;
+                start_new = new_pos + count;
+            }
+            if (side_pos + length > edit_end) {
+                const size_t count = edit_end > side_pos ? edit_end - side_pos : 0;
+                end_step = step + count;
+                end_old = old_pos + count;
+                end_new = new_pos + count;
+                break;
+            }
+            old_pos += length;
+            new_pos += length;
+        } else if (op == DiffOp::Delete) {
+            old_pos += length;
+        } else {
+            new_pos += length;
+        }
+        step += length;
+    }
+    if (end_step == SIZE_MAX) {
+        end_step = step;
+        end_old = old_pos;
+        end_new = new_pos;
+    }
+    // The edited lines end where they did, moved by the change in their count
+    (old_side ? end_old : end_new) += edit.added - edit.removed;
+
+    bool approximate = false;
+    const auto runs = engine_.edit_runs(old_lines_.slice(start_old, end_old - start_old),
+                                        new_lines_.slice(start_new, end_new - start_new),
+                                        options_.diff, &approximate);
+    approximate_ = approximate_ || approximate;
+    std::vector<EditRun> script;
+    script.reserve(script_.size() + runs.size());
+    append_steps(script, script_, 0, start_step);
+    for (const auto& [op, length] : runs) {
+        append_run(script, op, length);
+    }
+    append_steps(script, script_, end_step, SIZE_MAX);
+    script_ = std::move(script);
+
+    // Lines [start, end) of each side were diffed again; the edited side had
+    // edit.removed - edit.added more of them before the edit
+    LineEdit old_region{start_old, end_old - start_old, end_old - start_old};
+    LineEdit new_region{start_new, end_new - start_new, end_new - start_new};
+    auto& edited = old_side ? old_region : new_region;
+    edited.removed = edited.removed + edit.removed - edit.added;
+    return {old_region, new_region};
+}
+
+void DiffSession::build_view_model() {
+    DiffResult diff;
+    diff.old_lines = old_lines_;
+    diff.new_lines = new_lines_;
+    diff.hunks = hunks_from_runs(script_, options_.diff.context_lines);
+    diff.approximate = approximate_;
+    view_model_ = LazyViewModel(std::move(diff), options_).to_view_model();
+}
+
+} // namespace diff_view
@@ -0,0 +1,54 @@
+#include "line_intern.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace diff_view {
+
+void LineInterner::intern(const LineTable& old_lines, const LineTable& new_lines, InternedLines& result) {
+    const size_t slot_count = std::bit_ceil(std::max<size_t>((old_lines.size() + new_lines.size()) * 2, 16));
+    slots_.assign(slot_count, Slot{});
+    mask_ = slot_count - 1;
+    representatives_.clear();
+    result.old_ids.clear();
+    result.new_ids.clear();
+    result.old_ids.reserve(old_lines.size());
+    result.new_ids.reserve(new_lines.size());
+    for (size_t i = 0; i < old_lines.size(); ++i) {
+        result.old_ids.push_back(intern_line(old_lines[i], old_lines.hashes()[i]));
+    }
+    for (size_t i = 0; i < new_lines.size(); ++i) {
+        result.new_ids.push_back(intern_line(new_lines[i], new_lines.hashes()[i]));
+    }
+    result.old_counts.assign(representatives_.size(), 0);
+    result.new_counts.assign(representatives_.size(), 0);
+    for (const auto id : result.old_ids) {
+        ++result.old_counts[id];
+    }
+    for (const auto id : result.new_ids) {
+        ++result.new_counts[id];
+    }
+}
+
+uint32_t LineInterner::intern_line(const std::string_view line, const uint64_t hash) {
+    for (size_t i = hash & mask_;; i = (i + 1) & mask_) {
+        auto& slot = slots_[i];
+        if (slot.id == EMPTY) {
+            slot.hash = hash;
+            slot.id = static_cast<uint32_t>(representatives_.size());
+            representatives_.emplace_back(line);
+            return slot.id;
+        }
+        if (slot.hash == hash && representatives_[slot.id] == line) {
+            return slot.id;
+        }
+    }
+}
+
+InternedLines intern_lines(const LineTable& old_lines, const LineTable& new_lines) {
+    InternedLines result;
+    LineInterner().intern(old_lines, new_lines, result);
+    return result;
+}
+
+} // namespace diff_view
@@ -0,0 +1,148 @@
+#include "line_table.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace diff_view {
+
+LineTable LineTable::view(const std::string_view text) {
+    LineTable table;
+    table.text_ = text;
+    index_lines(table.text_, table.spans_, table.hashes_);
+    return table;
+}
+
+LineTable LineTable::view_with_endings(const std::string_view text) {
+    LineTable table;
+    table.text_ = text;
+    for (size_t begin = 0; begin < text.size();) {
+        const size_t newline = text.find('\n', begin);
+        const size_t end = newline == std::string_view::npos ? text.size() : newline + 1;
+        table.spans_.push_back({begin, end});
+        table.hashes_.push_back(hash_line(text.substr(begin, end - begin)));
+        begin = end;
+    }
+    return table;
+}
+
+void LineTable::assign_view(const std::string_view text) {
+    storage_.reset();
+    text_ = text;
+    spans_.clear();
+    hashes_.clear();
+    index_lines(text_, spans_, hashes_);
+}
+
+LineEdit LineTable::edit_view(const std::string_view text, const size_t begin, const size_t end,
+                               const size_t inserted) {
+    // Index of the line holding byte `pos`, its line ending included
+    const auto line_of = [this](const size_t pos) {
+        const auto it = std::upper_bound(spans_.begin(), spans_.end(), pos,
+            [](const size_t p, const LineSpan& span) { return p < span.begin; });
+        return static_cast<size_t>(it - spans_.begin()) - 1;
+    };
+    const size_t old_size = text_.size();
+    LineEdit edit{0, 0, 0};
+    size_t region_begin = 0;
+    size_t region_end = old_size;
+    bool at_end = true;  // The region includes the last line
+    if (!spans_.empty()) {
+        // Start one line early: a '\r' ending it may now be followed by '\n'
+        edit.first = std::max<size_t>(line_of(begin), 1) - 1;
+        const size_t last = line_of(end);
+        edit.removed = last + 1 - edit.first;
+        region_begin = spans_[edit.first].begin;
+        at_end = last + 1 == spans_.size();
+        region_end = at_end ? old_size : spans_[last + 1].begin;
+    }
+    const size_t new_region_end = region_end - (end - begin) + inserted;
+
+    std::vector<LineSpan> spans;
+    std::vector<uint64_t> hashes;
+    index_lines(text.substr(region_begin, new_region_end - region_begin), spans, hashes);
+    if (!at_end && !spans.empty()) {
+        // The region ends with a line ending; the empty line after it is the next unchanged one
+        spans.pop_back();
+        hashes.pop_back();
+    }
+    for (auto& span : spans) {
+        span.begin += region_begin;
+        span.end += region_begin;
+    }
+    edit.added = spans.size();
+
+    const auto first = static_cast<std::ptrdiff_t>(edit.first);
+    const auto removed_end = static_cast<std::ptrdiff_t>(edit.first + edit.removed);
+    for (auto it = spans_.begin() + removed_end; it != spans_.end(); ++it) {
+        it->begin = it->begin - region_end + new_region_end;
+        it->end = it->end - region_end + new_region_end;
+    }
+    spans_.erase(spans_.begin() + first, spans_.begin() + removed_end);
+    spans_.insert(spans_.begin() + first, spans.begin(), spans.end());
+    hashes_.erase(hashes_.begin() + first, hashes_.begin() + removed_end);
+    hashes_.insert(hashes_.begin() + first, hashes.begin(), hashes.end());
+    storage_.reset();
+    text_ = text;
+    return edit;
+}
+
+LineTable LineTable::slice(const size_t first, const size_t count) const {
+    LineTable table;
+    table.storage_ = storage_;
+    table.text_ = text_;
+    const auto begin = static_cast<std::ptrdiff_t>(first);
+    const auto end = static_cast<std::ptrdiff_t>(first + count);
+    table.spans_.assign(spans_.begin() + begin, spans_.begin() + end);
+    table.hashes_.assign(hashes_.begin() + begin, hashes_.begin() + end);
+    return table;
+}
+
+LineTable LineTable::view_spans(const std::string_view text, std::vector<LineSpan> spans) {
+    LineTable table;
+    table.text_ = text;
+    table.spans_ = std::move(spans);
+    table.hashes_.reserve(table.spans_.size());
+    for (const auto& [begin, end] : table.spans_) {
+        table.hashes_.push_back(hash_line(text.substr(begin, end - begin)));
+    }
+    return table;
+}
+
+LineTable LineTable::copy(const std::string_view text) {
+    LineTable table;
+    table.storage_ = std::make_shared<const std::string>(text);
+    table.text_ = *table.storage_;
+    index_lines(table.text_, table.spans_, table.hashes_);
+    return table;
+}
+
+LineTable LineTable::from_lines(const std::vector<std::string>& lines) {
+    size_t total = 0;
+    for (const auto& line : lines) {
+        total += line.size();
+    }
+    std::string buffer;
+    buffer.reserve(total);
+    LineTable table;
+    table.spans_.reserve(lines.size());
+    table.hashes_.reserve(lines.size());
+    for (const auto& line : lines) {
+        table.spans_.push_back({buffer.size(), buffer.size() + line.size()});
+        table.hashes_.push_back(hash_line(line));
+        buffer += line;
+    }
+    table.storage_ = std::make_shared<const std::string>(std::move(buffer));
+    table.text_ = *table.storage_;
+    return table;
+}
+
+std::vector<std::string> LineTable::to_vector() const {
+    std::vector<std::string> lines;
+    lines.reserve(spans_.size());
+    for (size_t i = 0; i < spans_.size(); ++i) {
+        lines.emplace_back((*this)[i]);
+    }
+    return lines;
+}
+
+} // namespace diff_view
@@ -0,0 +1,144 @@
+#include "mapped_file.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DIFF_VIEW_HAS_MMAP 1
+#else
+#include <iostream>
+#endif
+
+namespace diff_view {
+
+namespace {
+
+void set_error(std::string* error, const std::string& path, const std::string& reason) {
+    if (error != nullptr) {
+        *error = path + ": " + reason;
+    }
+}
+
+} // namespace
+
+#ifdef DIFF_VIEW_HAS_MMAP
+
+std::optional<MappedFile> MappedFile::open(const std::string& path, std::string* error) {
+    const bool is_stdin = path == "-";
+    const int fd = is_stdin ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        set_error(error, path, std::strerror(errno));
+        return std::nullopt;
+    }
+    const auto close_fd = [&] {
+        if (!is_stdin) {
+            ::close(fd);
+        }
+    };
+    struct stat status{};
+    if (fstat(fd, &status) != 0) {
+        set_error(error, path, std::strerror(errno));
+        close_fd();
+        return std::nullopt;
+    }
+    if (S_ISDIR(status.st_mode)) {
+        set_error(error, path, std::strerror(EISDIR));
+        close_fd();
+        return std::nullopt;
+    }
+    MappedFile file;
+    if (S_ISREG(status.st_mode) && status.st_size > 0) {
+        const auto size = static_cast<size_t>(status.st_size);
+        void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            close_fd();  // The mapping keeps the file alive
+            file.map_ = map;
+            file.map_size_ = size;
+            file.text_ = std::string_view(static_cast<const char*>(map), size);
+            return file;
+        }
+    }
+    // Pipes, terminals, special files, or a failed mapping: read it all
+    char chunk[1 << 16];
+    while (true) {
+        const ssize_t count = read(fd, chunk, sizeof(chunk));
+        if (count == 0) {
+            break;
+        }
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            set_error(error, path, std::strerror(errno));
+            close_fd();
+            return std::nullopt;
+        }
+        file.buffer_.append(chunk, static_cast<size_t>(count));
+    }
+    close_fd();
+    file.text_ = file.buffer_;
+    return file;
+}
+
+void MappedFile::unmap() {
+    if (map_ != nullptr) {
+        munmap(map_, map_size_);
+        map_ = nullptr;
+        map_size_ = 0;
+    }
+}
+
+#else
+
+std::optional<MappedFile> MappedFile::open(const std::string& path, std::string* error) {
+    MappedFile file;
+    if (path == "-") {
+        file.buffer_.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+    } else {
+        std::ifstream stream(path, std::ios::binary);
+        if (!stream) {
+            set_error(error, path, "cannot open file");
+            return std::nullopt;
+        }
+        file.buffer_.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+    }
+    file.text_ = file.buffer_;
+    return file;
+}
+
+void MappedFile::unmap() {}
+
+#endif
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : map_(std::exchange(other.map_, nullptr)),
+      map_size_(std::exchange(other.map_size_, 0)),
+      buffer_(std::move(other.buffer_)),
+      text_(map_ != nullptr ? std::exchange(other.text_, {}) : std::string_view(buffer_)) {
+    other.text_ = {};
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        unmap();
+        map_ = std::exchange(other.map_, nullptr);
+        map_size_ = std::exchange(other.map_size_, 0);
+        buffer_ = std::move(other.buffer_);
+        text_ = map_ != nullptr ? other.text_ : std::string_view(buffer_);
+        other.text_ = {};
+    }
+    return *this;
+}
+
+} // namespace diff_view
@@ -0,0 +1,58 @@
+#include "packed_view_model.h"
+
+namespace diff_view {
+
+namespace {
+
+void append_lines(PackedViewModel& packed, const LineTable& lines) {
+    for (size_t i = 0; i < lines.size(); ++i) {
+        packed.text.append(lines[i]);
+        packed.line_offsets.push_back(static_cast<uint32_t>(packed.text.size()));
+    }
+}
+
+size_t text_size(const LineTable& lines) {
+    size_t size = 0;
+    for (const auto& span : lines.spans()) {
+        size += span.end - span.begin;
+    }
+    return size;
+}
+
+} // namespace
+
+PackedViewModel pack_view_model(const ViewModel& vm) {
+    PackedViewModel packed;
+    packed.rows.reserve(vm.lines.size() * PACKED_ROW_STRIDE);
+    for (const auto& [left, right] : vm.lines) {
+        packed.rows.insert(packed.rows.end(), {
+            static_cast<uint32_t>(left.kind), left.line_no,
+            static_cast<uint32_t>(right.kind), right.line_no
+        });
+    }
+    packed.highlights.reserve(vm.highlights.size() * PACKED_HIGHLIGHT_STRIDE);
+    for (const auto& [row, start, end, is_left] : vm.highlights) {
+        packed.highlights.insert(packed.highlights.end(), {row, start, end, is_left ? 1u : 0u});
+    }
+    packed.connectors.reserve(vm.connectors.size() * PACKED_CONNECTOR_STRIDE);
+    for (const auto& [top, bottom, left_start, left_end, right_start, right_end] : vm.connectors) {
+        packed.connectors.insert(packed.connectors.end(), {top, bottom, left_start, left_end, right_start, right_end});
+    }
+    packed.folds.reserve(vm.folds.size() * PACKED_FOLD_STRIDE);
+    for (const auto& [row, count] : vm.folds) {
+        packed.folds.insert(packed.folds.end(), {row, count});
+    }
+
+    packed.old_line_count = static_cast<uint32_t>(vm.old_lines.size());
+    packed.new_line_count = static_cast<uint32_t>(vm.new_lines.size());
+    packed.text.reserve(text_size(vm.old_lines) + text_size(vm.new_lines));
+    packed.line_offsets.reserve(vm.old_lines.size() + vm.new_lines.size() + 1);
+    packed.line_offsets.push_back(0);
+    append_lines(packed, vm.old_lines);
+    append_lines(packed, vm.new_lines);
+    packed.approximate = vm.approximate;
+    packed.cancelled = vm.cancelled;
+    return packed;
+}
+
+} // namespace diff_view
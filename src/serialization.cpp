@@ -0,0 +1,578 @@
+#include "serialization.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace diff_view {
+
+namespace {
+
+constexpr std::string_view MAGIC = "DVSF";
+
+enum class Kind : uint8_t {
+    Diff = 1,
+    View = 2,
+};
+
+constexpr uint8_t APPROXIMATE = 1;
+constexpr uint8_t CANCELLED = 2;
+constexpr uint8_t HAS_TEXT = 4;
+
+// How the lines of a stored text are split
+constexpr uint8_t SPLIT_BY_VIEW = 0;
+constexpr uint8_t SPLIT_LISTED = 1;
+
+uint64_t zigzag(const int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(const uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+int64_t difference(const uint64_t value, const uint64_t base) {
+    return static_cast<int64_t>(value - base);
+}
+
+class Writer {
+public:
+    void byte(const uint8_t value) { out_ += static_cast<char>(value); }
+
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            out_ += static_cast<char>((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        out_ += static_cast<char>(value);
+    }
+
+    void signed_varint(const int64_t value) { varint(zigzag(value)); }
+
+    void bytes(const std::string_view data) { out_.append(data); }
+
+    std::string take() { return std::move(out_); }
+
+private:
+    std::string out_;
+};
+
+/**
+ * Reads an encoding; every read past its end or of a malformed number
+ * clears ok() and returns 0.
+ */
+class Reader {
+public:
+    explicit Reader(const std::string_view data) : data_(data) {}
+
+    [[nodiscard]] bool ok() const { return ok_; }
+    [[nodiscard]] bool at_end() const { return ok_ && position_ == data_.size(); }
+    [[nodiscard]] size_t size() const { return data_.size(); }
+    [[nodiscard]] size_t remaining() const { return data_.size() - position_; }
+
+    uint8_t byte() {
+        if (position_ >= data_.size()) {
+            return fail();
+        }
+        return static_cast<uint8_t>(data_[position_++]);
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (position_ >= data_.size()) {
+                return fail();
+            }
+            const auto part = static_cast<uint8_t>(data_[position_++]);
+            if (shift == 63 && part > 1) {
+                return fail();
+            }
+            value |= static_cast<uint64_t>(part & 0x7f) << shift;
+            if ((part & 0x80) == 0) {
+                return value;
+            }
+        }
+        return fail();
+    }
+
+    int64_t signed_varint() { return unzigzag(varint()); }
+
+    /** A number that must fit in 32 bits. */
+    uint32_t u32() {
+        const uint64_t value = varint();
+        return value > UINT32_MAX ? fail() : static_cast<uint32_t>(value);
+    }
+
+    /** A count of items of at least one byte each, checked against what is left. */
+    size_t count() {
+        const uint64_t value = varint();
+        return value > data_.size() - position_ ? fail() : static_cast<size_t>(value);
+    }
+
+    std::string_view bytes(const size_t size) {
+        if (size > data_.size() - position_) {
+            fail();
+            return {};
+        }
+        const auto result = data_.substr(position_, size);
+        position_ += size;
+        return result;
+    }
+
+    uint8_t fail() {
+        ok_ = false;
+        position_ = data_.size();
+        return 0;
+    }
+
+private:
+    std::string_view data_;
+    size_t position_ = 0;
+    bool ok_ = true;
+};
+
+void write_header(Writer& writer, const Kind kind, const bool approximate, const bool cancelled, const bool include_text) {
+    writer.bytes(MAGIC);
+    writer.byte(SERIALIZATION_VERSION);
+    writer.byte(static_cast<uint8_t>(kind));
+    writer.byte(static_cast<uint8_t>((approximate ? APPROXIMATE : 0) | (cancelled ? CANCELLED : 0) |
+                                     (include_text ? HAS_TEXT : 0)));
+}
+
+/**
+ * The flags of a header of the given kind, or nullopt.
+ */
+std::optional<uint8_t> read_header(Reader& reader, const Kind kind) {
+    if (reader.bytes(MAGIC.size()) != MAGIC || reader.byte() != SERIALIZATION_VERSION ||
+        reader.byte() != static_cast<uint8_t>(kind)) {
+        return std::nullopt;
+    }
+    const uint8_t flags = reader.byte();
+    if (!reader.ok() || (flags & ~(APPROXIMATE | CANCELLED | HAS_TEXT)) != 0) {
+        return std::nullopt;
+    }
+    return flags;
+}
+
+void write_lines(Writer& writer, const LineTable& lines, const bool include_text) {
+    writer.varint(lines.size());
+    if (!include_text) {
+        return;
+    }
+    // Tables split the usual way are rebuilt from the text alone
+    const auto text = lines.text();
+    const auto& spans = lines.spans();
+    const auto resplit = LineTable::view(text);
+    const bool by_view = resplit.size() == spans.size() &&
+                         std::equal(spans.begin(), spans.end(), resplit.spans().begin(),
+                                    [](const LineSpan& a, const LineSpan& b) { return a.begin == b.begin && a.end == b.end; });
+    writer.byte(by_view ? SPLIT_BY_VIEW : SPLIT_LISTED);
+    writer.varint(text.size());
+    writer.bytes(text);
+    if (!by_view) {
+        size_t previous_end = 0;
+        for (const auto& [begin, end] : spans) {
+            writer.signed_varint(difference(begin, previous_end));
+            writer.varint(end - begin);
+            previous_end = end;
+        }
+    }
+}
+
+/**
+ * The line table of one side: read from `data` if the text is stored there,
+ * else the given one, which must have the stored line count.
+ */
+std::optional<LineTable> read_lines(Reader& reader, const bool has_text, LineTable given) {
+    const uint64_t line_count = reader.varint();
+    if (!has_text) {
+        if (!reader.ok() || line_count != given.size()) {
+            return std::nullopt;
+        }
+        return given;
+    }
+    const uint8_t split = reader.byte();
+    const auto text = reader.bytes(reader.count());
+    if (!reader.ok()) {
+        return std::nullopt;
+    }
+    if (split == SPLIT_BY_VIEW) {
+        auto table = LineTable::view(text);
+        return table.size() == line_count ? std::optional(std::move(table)) : std::nullopt;
+    }
+    if (split != SPLIT_LISTED || line_count > reader.remaining() / 2) {
+        return std::nullopt;
+    }
+    std::vector<LineSpan> spans(line_count);
+    size_t previous_end = 0;
+    for (auto& [begin, end] : spans) {
+        begin = previous_end + static_cast<size_t>(reader.signed_varint());
+        const uint64_t length = reader.varint();
+        if (begin > text.size() || length > text.size() - begin) {
+            return std::nullopt;
+        }
+        end = begin + length;
+        previous_end = end;
+    }
+    if (!reader.ok()) {
+        return std::nullopt;
+    }
+    return LineTable::view_spans(text, std::move(spans));
+}
+
+void write_hunks(Writer& writer, const std::vector<DiffHunk>& hunks) {
+    writer.varint(hunks.size());
+    size_t old_end = 0;
+    for (const auto& hunk : hunks) {
+        // The unchanged lines since the previous hunk are the same on both sides
+        writer.varint(hunk.old_start - old_end);
+        writer.varint(hunk.runs.size());
+        for (const auto& [op, length] : hunk.runs) {
+            writer.varint(static_cast<uint64_t>(length) << 2 | static_cast<uint64_t>(op));
+        }
+        old_end = hunk.old_start + hunk.old_count;
+    }
+}
+
+bool read_hunks(Reader& reader, DiffResult& result) {
+    // Hunks follow each other on both sides, with as many unchanged lines
+    // between them (and after the last one) on the old side as on the new one
+    result.hunks.resize(reader.count());
+    size_t old_end = 0, new_end = 0;
+    for (auto& hunk : result.hunks) {
+        const uint64_t gap = reader.varint();
+        if (gap > result.old_lines.size() - old_end || gap > result.new_lines.size() - new_end) {
+            return false;
+        }
+        hunk.old_start = old_end + static_cast<size_t>(gap);
+        hunk.new_start = new_end + static_cast<size_t>(gap);
+        hunk.runs.resize(reader.count());
+        hunk.old_count = 0;
+        hunk.new_count = 0;
+        for (auto& [op, length] : hunk.runs) {
+            const uint64_t value = reader.varint();
+            if ((value & 3) > static_cast<uint64_t>(DiffOp::Insert)) {
+                return false;
+            }
+            op = static_cast<DiffOp>(value & 3);
+            length = static_cast<size_t>(value >> 2);
+            if (length > result.old_lines.size() + result.new_lines.size()) {
+                return false;
+            }
+            hunk.old_count += op != DiffOp::Insert ? length : 0;
+            hunk.new_count += op != DiffOp::Delete ? length : 0;
+        }
+        if (!reader.ok() || hunk.old_count > result.old_lines.size() - hunk.old_start ||
+            hunk.new_count > result.new_lines.size() - hunk.new_start) {
+            return false;
+        }
+        old_end = hunk.old_start + hunk.old_count;
+        new_end = hunk.new_start + hunk.new_count;
+    }
+    // A cancelled diff has no hunks, whatever its texts
+    if (!result.cancelled && result.old_lines.size() - old_end != result.new_lines.size() - new_end) {
+        return false;
+    }
+    return reader.ok();
+}
+
+/**
+ * Whether `row` continues the run of `previous`: the same kinds, and on
+ * each side no line number in both or the next line number.
+ */
+bool continues_run(const ViewLine& previous, const ViewLine& row) {
+    const auto continues = [](const SideInfo& a, const SideInfo& b) {
+        return a.kind == b.kind && (a.line_no == 0 ? b.line_no == 0 : b.line_no == a.line_no + 1);
+    };
+    return continues(previous.left, row.left) && continues(previous.right, row.right);
+}
+
+/**
+ * A first line number of a run: 0 for none, else 1 + its difference from
+ * the line after the last numbered line of the side.
+ */
+void write_line_no(Writer& writer, const uint32_t line_no, const uint32_t next) {
+    if (line_no == 0) {
+        writer.varint(0);
+        return;
+    }
+    writer.varint(zigzag(difference(line_no, next)) + 1);
+}
+
+std::optional<uint32_t> read_line_no(Reader& reader, const uint32_t next) {
+    const uint64_t value = reader.varint();
+    if (value == 0) {
+        return 0;
+    }
+    const int64_t line_no = static_cast<int64_t>(next) + unzigzag(value - 1);
+    if (line_no <= 0 || line_no > UINT32_MAX) {
+        return std::nullopt;
+    }
+    return static_cast<uint32_t>(line_no);
+}
+
+void write_rows(Writer& writer, const ViewModel& vm) {
+    // Row runs are counted first so that the reader can check them
+    std::vector<std::pair<size_t, size_t>> runs;
+    for (size_t i = 0; i < vm.lines.size(); ++i) {
+        if (i == 0 || !continues_run(vm.lines[i - 1], vm.lines[i])) {
+            runs.emplace_back(i, 0);
+        }
+        ++runs.back().second;
+    }
+    writer.varint(runs.size());
+    uint32_t next_left = 1, next_right = 1;
+    for (const auto& [first, length] : runs) {
+        const auto& [left, right] = vm.lines[first];
+        writer.byte(static_cast<uint8_t>(static_cast<uint8_t>(left.kind) | static_cast<uint8_t>(right.kind) << 4));
+        writer.varint(length);
+        write_line_no(writer, left.line_no, next_left);
+        write_line_no(writer, right.line_no, next_right);
+        const auto& last = vm.lines[first + length - 1];
+        if (last.left.line_no != 0) {
+            next_left = last.left.line_no + 1;
+        }
+        if (last.right.line_no != 0) {
+            next_right = last.right.line_no + 1;
+        }
+    }
+
+    writer.varint(vm.highlights.size());
+    uint32_t previous_row = 0;
+    for (const auto& [row, start, end, is_left] : vm.highlights) {
+        writer.varint(zigzag(difference(row, previous_row)) << 1 | (is_left ? 1 : 0));
+        writer.varint(start);
+        writer.signed_varint(difference(end, start));
+        previous_row = row;
+    }
+
+    writer.varint(vm.connectors.size());
+    uint32_t previous_bottom = 0, previous_left = 0, previous_right = 0;
+    for (const auto& [top, bottom, left_start, left_end, right_start, right_end] : vm.connectors) {
+        writer.signed_varint(difference(top, previous_bottom));
+        writer.signed_varint(difference(bottom, top));
+        writer.signed_varint(difference(left_start, previous_left));
+        writer.signed_varint(difference(left_end, left_start));
+        writer.signed_varint(difference(right_start, previous_right));
+        writer.signed_varint(difference(right_end, right_start));
+        previous_bottom = bottom;
+        previous_left = left_end;
+        previous_right = right_end;
+    }
+
+    writer.varint(vm.folds.size());
+    uint32_t previous_fold = 0;
+    for (const auto& [row, count] : vm.folds) {
+        writer.signed_varint(difference(row, previous_fold));
+        writer.varint(count);
+        previous_fold = row;
+    }
+}
+
+/**
+ * `base` moved by a difference read from the encoding, or nullopt when the
+ * result leaves the 32-bit range.
+ */
+std::optional<uint32_t> read_u32_from(Reader& reader, const uint32_t base) {
+    const int64_t value = static_cast<int64_t>(base) + reader.signed_varint();
+    if (value < 0 || value > UINT32_MAX) {
+        return std::nullopt;
+    }
+    return static_cast<uint32_t>(value);
+}
+
+/**
+ * Whether lines [start, end] (1-based, 0 for none) are lines of `table`.
+ */
+bool valid_line_range(const uint64_t start, const uint64_t end, const LineTable& table) {
+    return start == 0 ? end == 0 : start <= end && end <= table.size();
+}
+
+/**
+ * Whether the first and last lines of a connector side (1-based, 0 for none)
+ * are lines of `table`. Rows of a hunk are ordered by kind before line
+ * number, so the last line may come before the first.
+ */
+bool valid_connector_lines(const uint64_t first, const uint64_t last, const LineTable& table) {
+    if (first == 0 || last == 0) {
+        return first == last;
+    }
+    return first <= table.size() && last <= table.size();
+}
+
+bool read_rows(Reader& reader, ViewModel& vm) {
+    // Every row of a real view model shows a line of one side at least, so
+    // the rows are bounded, whatever the encoding claims
+    const size_t row_limit = vm.old_lines.size() + vm.new_lines.size() + reader.size();
+    const size_t run_count = reader.count();
+    uint32_t next_left = 1, next_right = 1;
+    for (size_t run = 0; run < run_count && reader.ok(); ++run) {
+        const uint8_t kinds = reader.byte();
+        const auto left_kind = static_cast<uint8_t>(kinds & 0xf);
+        const auto right_kind = static_cast<uint8_t>(kinds >> 4);
+        const uint64_t length = reader.varint();
+        const auto left = read_line_no(reader, next_left);
+        const auto right = read_line_no(reader, next_right);
+        // A run numbers at most every line of its sides
+        if (!left || !right || left_kind > static_cast<uint8_t>(LineKind::Folded) ||
+            right_kind > static_cast<uint8_t>(LineKind::Folded) || length == 0 ||
+            length > std::min<size_t>(row_limit, UINT32_MAX) - vm.lines.size() ||
+            (*left != 0 && (*left > vm.old_lines.size() || length > vm.old_lines.size() - *left + 1)) ||
+            (*right != 0 && (*right > vm.new_lines.size() || length > vm.new_lines.size() - *right + 1))) {
+            return false;
+        }
+        for (uint32_t i = 0; i < length; ++i) {
+            vm.lines.push_back({
+                {static_cast<LineKind>(left_kind), *left == 0 ? 0 : *left + i},
+                {static_cast<LineKind>(right_kind), *right == 0 ? 0 : *right + i}
+            });
+        }
+        if (*left != 0) {
+            next_left = *left + static_cast<uint32_t>(length);
+        }
+        if (*right != 0) {
+            next_right = *right + static_cast<uint32_t>(length);
+        }
+    }
+
+    // Highlights are byte ranges of a line shown on their row
+    vm.highlights.resize(reader.count());
+    uint32_t previous_row = 0;
+    for (auto& [row, start, end, is_left] : vm.highlights) {
+        const uint64_t value = reader.varint();
+        const int64_t row_value = static_cast<int64_t>(previous_row) + unzigzag(value >> 1);
+        start = reader.u32();
+        const auto end_value = read_u32_from(reader, start);
+        if (row_value < 0 || static_cast<uint64_t>(row_value) >= vm.lines.size() || !end_value ||
+            *end_value < start) {
+            return false;
+        }
+        row = static_cast<uint32_t>(row_value);
+        end = *end_value;
+        is_left = (value & 1) != 0;
+        const auto& side = is_left ? vm.lines[row].left : vm.lines[row].right;
+        const auto& table = is_left ? vm.old_lines : vm.new_lines;
+        if (side.line_no == 0 || side.kind == LineKind::Folded || end > table[side.line_no - 1].size()) {
+            return false;
+        }
+        previous_row = row;
+    }
+
+    vm.connectors.resize(reader.count());
+    uint32_t previous_bottom = 0, previous_left = 0, previous_right = 0;
+    for (auto& [top, bottom, left_start, left_end, right_start, right_end] : vm.connectors) {
+        const auto top_value = read_u32_from(reader, previous_bottom);
+        const auto bottom_value = read_u32_from(reader, top_value.value_or(0));
+        const auto left_start_value = read_u32_from(reader, previous_left);
+        const auto left_end_value = read_u32_from(reader, left_start_value.value_or(0));
+        const auto right_start_value = read_u32_from(reader, previous_right);
+        const auto right_end_value = read_u32_from(reader, right_start_value.value_or(0));
+        if (!top_value || !bottom_value || !left_start_value || !left_end_value || !right_start_value ||
+            !right_end_value || *bottom_value < *top_value || *bottom_value >= vm.lines.size() ||
+            !valid_connector_lines(*left_start_value, *left_end_value, vm.old_lines) ||
+            !valid_connector_lines(*right_start_value, *right_end_value, vm.new_lines)) {
+            return false;
+        }
+        top = *top_value;
+        bottom = *bottom_value;
+        left_start = *left_start_value;
+        left_end = *left_end_value;
+        right_start = *right_start_value;
+        right_end = *right_end_value;
+        previous_bottom = bottom;
+        previous_left = left_end;
+        previous_right = right_end;
+    }
+
+    // Folds index Folded rows in order (expand_fold() searches them) and
+    // hide lines that exist on both sides
+    vm.folds.resize(reader.count());
+    uint32_t previous_fold = 0;
+    for (size_t i = 0; i < vm.folds.size(); ++i) {
+        auto& [row, count] = vm.folds[i];
+        const auto row_value = read_u32_from(reader, previous_fold);
+        count = reader.u32();
+        if (!row_value || *row_value >= vm.lines.size() || (i > 0 && *row_value <= previous_fold) || count == 0) {
+            return false;
+        }
+        const auto& [left, right] = vm.lines[*row_value];
+        if (left.kind != LineKind::Folded || right.kind != LineKind::Folded || left.line_no == 0 ||
+            right.line_no == 0 ||
+            !valid_line_range(left.line_no, uint64_t{left.line_no} + count - 1, vm.old_lines) ||
+            !valid_line_range(right.line_no, uint64_t{right.line_no} + count - 1, vm.new_lines)) {
+            return false;
+        }
+        row = *row_value;
+        previous_fold = row;
+    }
+    return reader.ok();
+}
+
+template <typename Result>
+std::optional<Result> read_result(const std::string_view data, const Kind kind, const bool has_text,
+                                  LineTable old_lines, LineTable new_lines) {
+    Reader reader(data);
+    const auto flags = read_header(reader, kind);
+    if (!flags || ((*flags & HAS_TEXT) != 0) != has_text) {
+        return std::nullopt;
+    }
+    auto old_table = read_lines(reader, has_text, std::move(old_lines));
+    auto new_table = read_lines(reader, has_text, std::move(new_lines));
+    if (!old_table || !new_table) {
+        return std::nullopt;
+    }
+    Result result;
+    result.old_lines = std::move(*old_table);
+    result.new_lines = std::move(*new_table);
+    result.approximate = (*flags & APPROXIMATE) != 0;
+    result.cancelled = (*flags & CANCELLED) != 0;
+    bool ok;
+    if constexpr (std::is_same_v<Result, DiffResult>) {
+        ok = read_hunks(reader, result);
+    } else {
+        ok = read_rows(reader, result);
+    }
+    if (!ok || !reader.at_end()) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+} // namespace
+
+std::string serialize(const DiffResult& result, const bool include_text) {
+    Writer writer;
+    write_header(writer, Kind::Diff, result.approximate, result.cancelled, include_text);
+    write_lines(writer, result.old_lines, include_text);
+    write_lines(writer, result.new_lines, include_text);
+    write_hunks(writer, result.hunks);
+    return writer.take();
+}
+
+std::string serialize(const ViewModel& vm, const bool include_text) {
+    Writer writer;
+    write_header(writer, Kind::View, vm.approximate, vm.cancelled, include_text);
+    write_lines(writer, vm.old_lines, include_text);
+    write_lines(writer, vm.new_lines, include_text);
+    write_rows(writer, vm);
+    return writer.take();
+}
+
+std::optional<DiffResult> deserialize_diff(const std::string_view data) {
+    return read_result<DiffResult>(data, Kind::Diff, true, {}, {});
+}
+
+std::optional<DiffResult> deserialize_diff(const std::string_view data, LineTable old_lines, LineTable new_lines) {
+    return read_result<DiffResult>(data, Kind::Diff, false, std::move(old_lines), std::move(new_lines));
+}
+
+std::optional<ViewModel> deserialize_view_model(const std::string_view data) {
+    return read_result<ViewModel>(data, Kind::View, true, {}, {});
+}
+
+std::optional<ViewModel> deserialize_view_model(const std::string_view data, LineTable old_lines, LineTable new_lines) {
+    return read_result<ViewModel>(data, Kind::View, false, std::move(old_lines), std::move(new_lines));
+}
+
+} // namespace diff_view
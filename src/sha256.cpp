@@ -0,0 +1,137 @@
+#include "sha256.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace diff_view {
+
+namespace {
+
+constexpr std::array<uint32_t, 64> ROUND_CONSTANTS = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+constexpr uint32_t rotate_right(const uint32_t value, const int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+} // namespace
+
+Sha256::Sha256()
+    : state_{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19} {}
+
+void Sha256::compress(const uint8_t* block) {
+    std::array<uint32_t, 64> w;
+    for (size_t i = 0; i < 16; ++i) {
+        w[i] = static_cast<uint32_t>(block[i * 4]) << 24 | static_cast<uint32_t>(block[i * 4 + 1]) << 16 |
+               static_cast<uint32_t>(block[i * 4 + 2]) << 8 | static_cast<uint32_t>(block[i * 4 + 3]);
+    }
+    for (size_t i = 16; i < 64; ++i) {
+        const uint32_t s0 = rotate_right(w[i - 15], 7) ^ rotate_right(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = rotate_right(w[i - 2], 17) ^ rotate_right(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    auto [a, b, c, d, e, f, g, h] = state_;
+    for (size_t i = 0; i < 64; ++i) {
+        const uint32_t s1 = rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25);
+        const uint32_t choice = (e & f) ^ (~e & g);
+        const uint32_t t1 = h + s1 + choice + ROUND_CONSTANTS[i] + w[i];
+        const uint32_t s0 = rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22);
+        const uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+        const uint32_t t2 = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state_[0] += a;
+    state_[1] += b;
+    state_[2] += c;
+    state_[3] += d;
+    state_[4] += e;
+    state_[5] += f;
+    state_[6] += g;
+    state_[7] += h;
+}
+
+void Sha256::update(std::string_view data) {
+    if (data.empty()) {
+        return;
+    }
+    total_size_ += data.size();
+    if (block_size_ > 0) {
+        const size_t count = std::min(data.size(), block_.size() - block_size_);
+        std::memcpy(block_.data() + block_size_, data.data(), count);
+        block_size_ += count;
+        data.remove_prefix(count);
+        if (block_size_ < block_.size()) {
+            return;
+        }
+        compress(block_.data());
+        block_size_ = 0;
+    }
+    // Whole blocks are compressed straight from the input
+    while (data.size() >= block_.size()) {
+        compress(reinterpret_cast<const uint8_t*>(data.data()));
+        data.remove_prefix(block_.size());
+    }
+    if (!data.empty()) {
+        std::memcpy(block_.data(), data.data(), data.size());
+    }
+    block_size_ = data.size();
+}
+
+Sha256Digest Sha256::finish() {
+    // A 1 bit, zeros up to 8 bytes before a block end, then the size in bits
+    const uint64_t bits = total_size_ * 8;
+    block_[block_size_++] = 0x80;
+    if (block_size_ > block_.size() - 8) {
+        std::fill(block_.begin() + static_cast<std::ptrdiff_t>(block_size_), block_.end(), uint8_t{0});
+        compress(block_.data());
+        block_size_ = 0;
+    }
+    std::fill(block_.begin() + static_cast<std::ptrdiff_t>(block_size_), block_.end() - 8, uint8_t{0});
+    for (size_t i = 0; i < 8; ++i) {
+        block_[block_.size() - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+    }
+    compress(block_.data());
+
+    Sha256Digest digest;
+    for (size_t i = 0; i < state_.size(); ++i) {
+        digest[i * 4] = static_cast<uint8_t>(state_[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state_[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state_[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state_[i]);
+    }
+    return digest;
+}
+
+Sha256Digest sha256(const std::string_view data) {
+    Sha256 hash;
+    hash.update(data);
+    return hash.finish();
+}
+
+std::string to_hex(const Sha256Digest& digest) {
+    constexpr char DIGITS[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(digest.size() * 2);
+    for (const uint8_t byte : digest) {
+        hex += DIGITS[byte >> 4];
+        hex += DIGITS[byte & 0xf];
+    }
+    return hex;
+}
+
+} // namespace diff_view
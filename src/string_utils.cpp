@@ -1,32 +1,142 @@
 #include "string_utils.h"
 
+#include <bit>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define DIFF_VIEW_X86_SIMD
+#include <immintrin.h>
+#endif
+
 namespace diff_view {
 
-std::vector<std::string> split_lines(const std::string_view str) {
-    std::vector<std::string> lines;
+namespace {
+
+constexpr size_t BLOCK_SIZE = 64;
+
+/**
+ * Bit i is set if p[i] is a line ending character, for i < size.
+ */
+uint64_t newline_mask_scalar(const char* p, const size_t size) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (p[i] == '\r' || p[i] == '\n') {
+            mask |= uint64_t{1} << i;
+        }
+    }
+    return mask;
+}
+
+uint64_t newline_mask_scalar_block(const char* p) {
+    return newline_mask_scalar(p, BLOCK_SIZE);
+}
+
+#ifdef DIFF_VIEW_X86_SIMD
+
+__attribute__((target("sse2")))
+uint64_t newline_mask_sse2(const char* p) {
+    const __m128i lf = _mm_set1_epi8('\n');
+    const __m128i cr = _mm_set1_epi8('\r');
+    uint64_t mask = 0;
+    for (size_t i = 0; i < BLOCK_SIZE; i += 16) {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        const __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, lf), _mm_cmpeq_epi8(chunk, cr));
+        mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(hits))) << i;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+uint64_t newline_mask_avx2(const char* p) {
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    uint64_t mask = 0;
+    for (size_t i = 0; i < BLOCK_SIZE; i += 32) {
+        const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        const __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, lf), _mm256_cmpeq_epi8(chunk, cr));
+        mask |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(hits))) << i;
+    }
+    return mask;
+}
+
+#endif
+
+using BlockMask = uint64_t (*)(const char*);
+
+BlockMask select_block_mask(const SimdLevel level) {
+#ifdef DIFF_VIEW_X86_SIMD
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    if ((level == SimdLevel::AVX2 || level == SimdLevel::Best) && has_avx2) {
+        return newline_mask_avx2;
+    }
+    if (level != SimdLevel::Scalar) {
+        return newline_mask_sse2;
+    }
+#else
+    (void)level;
+#endif
+    return newline_mask_scalar_block;
+}
+
+/**
+ * Scan for line endings one block at a time and report every line as it is found.
+ */
+template <typename OnLine>
+void scan_lines(const std::string_view str, const SimdLevel level, OnLine on_line) {
     if (str.empty()) {
-        return lines;
-    }
-    size_t start = 0, i = 0;
-    while (i < str.size()) {
-        if (str[i] == '\r') {
-            lines.emplace_back(str.substr(start, i - start));
-            if (i + 1 < str.size() && str[i + 1] == '\n') {
-                i += 2;
-            } else {
-                i += 1;
+        return;
+    }
+    const BlockMask block_mask = select_block_mask(level);
+    const char* data = str.data();
+    const size_t size = str.size();
+    size_t start = 0;
+    for (size_t block = 0; block < size; block += BLOCK_SIZE) {
+        uint64_t mask = size - block >= BLOCK_SIZE
+            ? block_mask(data + block)
+            : newline_mask_scalar(data + block, size - block);
+        while (mask != 0) {
+            const size_t i = block + static_cast<size_t>(std::countr_zero(mask));
+            mask &= mask - 1;
+            if (i < start) {
+                continue; // The '\n' of a "\r\n" that was already consumed
             }
-            start = i;
-        } else if (str[i] == '\n') {
-            lines.emplace_back(str.substr(start, i - start));
-            i += 1;
-            start = i;
-        } else {
-            i += 1;
+            on_line(start, i);
+            start = (data[i] == '\r' && i + 1 < size && data[i + 1] == '\n') ? i + 2 : i + 1;
         }
     }
-    if (start <= str.size()) {
-        lines.emplace_back(str.substr(start));
+    on_line(start, size);
+}
+
+uint64_t load_word(const char* p) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    return word;
+}
+
+} // namespace
+
+std::vector<LineSpan> find_lines(const std::string_view str) {
+    std::vector<LineSpan> lines;
+    scan_lines(str, SimdLevel::Best, [&lines](const size_t begin, const size_t end) {
+        lines.push_back({begin, end});
+    });
+    return lines;
+}
+
+void index_lines(const std::string_view str, std::vector<LineSpan>& spans, std::vector<uint64_t>& hashes,
+                 const SimdLevel level) {
+    scan_lines(str, level, [&](const size_t begin, const size_t end) {
+        spans.push_back({begin, end});
+        hashes.push_back(hash_line(str.substr(begin, end - begin)));
+    });
+}
+
+std::vector<std::string> split_lines(const std::string_view str) {
+    std::vector<std::string> lines;
+    const auto spans = find_lines(str);
+    lines.reserve(spans.size());
+    for (const auto& [begin, end] : spans) {
+        lines.emplace_back(str.substr(begin, end - begin));
     }
     return lines;
 }
@@ -41,4 +151,31 @@ uint64_t hash_string(const std::string_view str, const uint64_t seed) {
     return hash;
 }
 
+uint64_t hash_line(const std::string_view str) {
+    static constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+    const char* p = str.data();
+    size_t remaining = str.size();
+    uint64_t hash = PRIME_3 ^ (remaining * PRIME_1);
+    while (remaining >= 8) {
+        hash ^= std::rotl(load_word(p) * PRIME_2, 31) * PRIME_1;
+        hash = std::rotl(hash, 27) * PRIME_1 + PRIME_3;
+        p += 8;
+        remaining -= 8;
+    }
+    if (remaining > 0) {
+        uint64_t tail = 0;
+        std::memcpy(&tail, p, remaining);
+        hash ^= std::rotl(tail * PRIME_2, 31) * PRIME_1;
+        hash = std::rotl(hash, 27) * PRIME_1 + PRIME_3;
+    }
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
 } // namespace diff_view
@@ -0,0 +1,106 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace diff_view {
+
+namespace {
+
+// Set while the thread runs a task, so nested run() calls stay inline
+thread_local bool in_task = false;
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers_.reserve(threads - 1);
+    for (size_t i = 1; i < threads; ++i) {
+        workers_.emplace_back([this] { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+bool ThreadPool::parallel() const {
+    return !workers_.empty() && !in_task;
+}
+
+void ThreadPool::run(const size_t count, const std::function<void(size_t)>& task) {
+    if (workers_.empty() || count <= 1 || in_task) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+    std::lock_guard run_lock(run_mutex_);
+    {
+        std::lock_guard lock(mutex_);
+        task_ = &task;
+        count_ = count;
+        next_ = 0;
+        error_ = nullptr;
+        active_ = workers_.size();
+        ++generation_;
+    }
+    wake_.notify_all();
+    drain();
+    std::exception_ptr error;
+    {
+        std::unique_lock lock(mutex_);
+        done_.wait(lock, [this] { return active_ == 0; });
+        task_ = nullptr;
+        error = std::exchange(error_, nullptr);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::work() {
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            wake_.wait(lock, [this, seen] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+        }
+        drain();
+        std::lock_guard lock(mutex_);
+        if (--active_ == 0) {
+            done_.notify_one();
+        }
+    }
+}
+
+void ThreadPool::drain() {
+    in_task = true;
+    for (size_t i = next_++; i < count_; i = next_++) {
+        try {
+            (*task_)(i);
+        } catch (...) {
+            std::lock_guard lock(mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            next_ = count_;
+        }
+    }
+    in_task = false;
+}
+
+} // namespace diff_view
@@ -0,0 +1,271 @@
+#include "unified_diff.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <charconv>
+#include <climits>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace diff_view {
+
+namespace {
+
+constexpr size_t BUFFER_SIZE = size_t{16} << 10;
+constexpr size_t MAX_SLICES = 512;  // Within IOV_MAX on the usual systems
+constexpr size_t COPY_LIMIT = 64;   // Longer texts are passed on as slices
+
+// Sizes of git's hunk header and function name buffers (xdiff)
+constexpr size_t HEADER_LIMIT = 128;
+constexpr size_t FUNCTION_NAME_LIMIT = 80;
+
+constexpr std::string_view NO_NEWLINE = "\n\\ No newline at end of file\n";
+
+/**
+ * Collects the output as slices, copying short texts into one buffer so that
+ * consecutive ones become a single slice, and hands them to the sink in batches.
+ */
+class SliceWriter {
+public:
+    explicit SliceWriter(const UnifiedDiffSink& sink) : sink_(sink) {
+        slices_.reserve(MAX_SLICES);
+    }
+
+    [[nodiscard]] bool ok() const { return ok_; }
+
+    /** Write a text that stays valid until the writer is flushed. */
+    void write(const std::string_view text) {
+        if (text.size() <= COPY_LIMIT) {
+            copy(text);
+        } else {
+            push(text);
+        }
+    }
+
+    /** Write a text that may not outlive the call. */
+    void copy(const std::string_view text) {
+        if (text.empty()) {
+            return;
+        }
+        // Flush first if the text does not fit or needs a slice and none is left
+        if (text.size() > BUFFER_SIZE - used_ || (!last_copied_ && slices_.size() == MAX_SLICES)) {
+            flush();
+            if (text.size() > BUFFER_SIZE) {
+                push(text);
+                flush();
+                return;
+            }
+        }
+        char* destination = buffer_.data() + used_;
+        std::memcpy(destination, text.data(), text.size());
+        used_ += text.size();
+        if (last_copied_) {
+            slices_.back() = std::string_view(slices_.back().data(), slices_.back().size() + text.size());
+        } else {
+            push({destination, text.size()});
+            last_copied_ = true;
+        }
+    }
+
+    void flush() {
+        if (ok_ && !slices_.empty()) {
+            ok_ = sink_(slices_);
+        }
+        slices_.clear();
+        used_ = 0;
+        last_copied_ = false;
+    }
+
+private:
+    void push(const std::string_view slice) {
+        if (slices_.size() == MAX_SLICES) {
+            flush();
+        }
+        slices_.push_back(slice);
+        last_copied_ = false;
+    }
+
+    const UnifiedDiffSink& sink_;
+    std::array<char, BUFFER_SIZE> buffer_;
+    size_t used_ = 0;
+    std::vector<std::string_view> slices_;
+    bool last_copied_ = false;  // The last slice is in the buffer and can grow
+    bool ok_ = true;
+};
+
+bool is_git_space(const char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+/**
+ * git's default function name of a line: the line, cut to 80 bytes and
+ * stripped of trailing whitespace, if it starts with a letter, '_' or '$'.
+ */
+std::optional<std::string_view> function_name(std::string_view line) {
+    if (line.empty()) {
+        return std::nullopt;
+    }
+    if (const char c = line.front(); !(('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || c == '_' || c == '$')) {
+        return std::nullopt;
+    }
+    line = line.substr(0, FUNCTION_NAME_LIMIT);
+    while (!line.empty() && is_git_space(line.back())) {
+        line.remove_suffix(1);
+    }
+    return line;
+}
+
+void append_number(std::string& out, const size_t value) {
+    char digits[24];
+    const auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    out.append(digits, end);
+}
+
+/**
+ * "start,count" of one side of a hunk header: 1-based, the line before the
+ * hunk if it is empty on that side, and no count when it is 1.
+ */
+void append_range(std::string& out, const size_t start, const size_t count) {
+    append_number(out, count == 0 ? start : start + 1);
+    if (count != 1) {
+        out += ',';
+        append_number(out, count);
+    }
+}
+
+void write_line(SliceWriter& writer, const std::string_view prefix, const std::string_view line) {
+    writer.copy(prefix);
+    writer.write(line);
+    if (!line.ends_with('\n')) {
+        writer.write(NO_NEWLINE);
+    }
+}
+
+} // namespace
+
+bool write_unified_diff(const DiffResult& result, const UnifiedDiffOptions& options, const UnifiedDiffSink& sink) {
+    if (result.hunks.empty()) {
+        return true;
+    }
+    SliceWriter writer(sink);
+    std::string header;
+    if (!options.old_label.empty() || !options.new_label.empty()) {
+        header.append("--- ").append(options.old_label).append("\n+++ ").append(options.new_label).append("\n");
+        writer.copy(header);
+    }
+
+    // Like git, look for the function name of a hunk between the start of the
+    // previous hunk and its own, and keep the last one found
+    std::string_view function;
+    size_t searched = 0;
+    for (const auto& hunk : result.hunks) {
+        if (options.function_names) {
+            for (size_t line = hunk.old_start; line > searched; --line) {
+                if (const auto name = function_name(result.old_lines[line - 1])) {
+                    function = *name;
+                    break;
+                }
+            }
+            searched = hunk.old_start;
+        }
+
+        header.assign("@@ -");
+        append_range(header, hunk.old_start, hunk.old_count);
+        header += " +";
+        append_range(header, hunk.new_start, hunk.new_count);
+        header += " @@";
+        if (!function.empty()) {
+            header += ' ';
+            header.append(function.substr(0, HEADER_LIMIT - header.size() - 1));
+        }
+        header += '\n';
+        writer.copy(header);
+
+        size_t old_index = hunk.old_start;
+        size_t new_index = hunk.new_start;
+        for (size_t r = 0; r < hunk.runs.size();) {
+            if (hunk.runs[r].op == DiffOp::Equal) {
+                for (size_t i = 0; i < hunk.runs[r].length; ++i) {
+                    write_line(writer, " ", result.old_lines[old_index++]);
+                }
+                new_index += hunk.runs[r++].length;
+                continue;
+            }
+            // Like git, print the deleted lines of a change before its inserted ones
+            size_t deleted = 0;
+            size_t inserted = 0;
+            for (; r < hunk.runs.size() && hunk.runs[r].op != DiffOp::Equal; ++r) {
+                (hunk.runs[r].op == DiffOp::Delete ? deleted : inserted) += hunk.runs[r].length;
+            }
+            for (const size_t end = old_index + deleted; old_index < end; ++old_index) {
+                write_line(writer, "-", result.old_lines[old_index]);
+            }
+            for (const size_t end = new_index + inserted; new_index < end; ++new_index) {
+                write_line(writer, "+", result.new_lines[new_index]);
+            }
+        }
+        if (!writer.ok()) {
+            return false;
+        }
+    }
+    writer.flush();
+    return writer.ok();
+}
+
+bool write_unified_diff(const DiffResult& result, const UnifiedDiffOptions& options, const int fd) {
+    return write_unified_diff(result, options, [fd](const std::span<const std::string_view> slices) {
+#if defined(_WIN32)
+        for (auto slice : slices) {
+            while (!slice.empty()) {
+                const int written = _write(fd, slice.data(), static_cast<unsigned>(slice.size()));
+                if (written < 0) {
+                    return false;
+                }
+                slice.remove_prefix(static_cast<size_t>(written));
+            }
+        }
+        return true;
+#else
+        std::array<iovec, MAX_SLICES> vectors;
+        for (size_t i = 0; i < slices.size(); ++i) {
+            vectors[i].iov_base = const_cast<char*>(slices[i].data());
+            vectors[i].iov_len = slices[i].size();
+        }
+        size_t first = 0;
+        while (first < slices.size()) {
+            size_t count = slices.size() - first;
+#ifdef IOV_MAX
+            count = std::min<size_t>(count, IOV_MAX);
+#endif
+            const ssize_t written = writev(fd, vectors.data() + first, static_cast<int>(count));
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            // Skip what was written; a partial write resumes inside a slice
+            auto left = static_cast<size_t>(written);
+            while (first < slices.size() && left >= vectors[first].iov_len) {
+                left -= vectors[first++].iov_len;
+            }
+            if (left > 0) {
+                vectors[first].iov_base = static_cast<char*>(vectors[first].iov_base) + left;
+                vectors[first].iov_len -= left;
+            }
+        }
+        return true;
+#endif
+    });
+}
+
+} // namespace diff_view
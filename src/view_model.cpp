@@ -1,151 +1,111 @@
 #include "view_model.h"
 #include "diff.h"
-#include "string_utils.h"
+#include "phase_progress.h"
 
-#include <map>
-#include <set>
 #include <algorithm>
-#include <grapheme_break.h>
+#include <atomic>
 
 namespace diff_view {
 
 namespace {
 
 constexpr double SIMILARITY_THRESHOLD = 0.5;
+constexpr size_t CANCEL_CHECK_INTERVAL = 64;  // Line pairs between checks of the token
 
-size_t grapheme_to_byte_offset(const std::vector<std::string>& graphemes, const size_t grapheme_idx) {
-    size_t offset = 0;
-    for (size_t i = 0; i < grapheme_idx && i < graphemes.size(); ++i) {
-        offset += graphemes[i].size();
-    }
-    return offset;
+bool is_cancelled(const CancelToken* cancel) {
+    return cancel != nullptr && cancel->cancelled();
 }
 
 /**
- * Calculate similarity ratio between two lines based on character diff.
- * Returns a value between 0.0 (completely different) and 1.0 (identical).
+ * Line indices of the deletions and insertions of a hunk, in order.
  */
-double calculate_similarity(const CharDiffResult& diff_result) {
-    size_t equal_chars = 0;
-    size_t total_old_chars = 0;
-    size_t total_new_chars = 0;
-
-    for (const auto& [op, text] : diff_result.old_segments) {
-        const size_t len = text.size();
-        total_old_chars += len;
+void collect_changes(const DiffHunk& hunk, std::vector<size_t>& delete_indices, std::vector<size_t>& insert_indices) {
+    size_t old_index = hunk.old_start, new_index = hunk.new_start;
+    for (const auto& [op, length] : hunk.runs) {
         if (op == DiffOp::Equal) {
-            equal_chars += len;
+            old_index += length;
+            new_index += length;
+        } else if (op == DiffOp::Delete) {
+            for (size_t i = 0; i < length; ++i) {
+                delete_indices.push_back(old_index++);
+            }
+        } else if (op == DiffOp::Insert) {
+            for (size_t i = 0; i < length; ++i) {
+                insert_indices.push_back(new_index++);
+            }
         }
     }
-
-    for (const auto& [op, text] : diff_result.new_segments) {
-        total_new_chars += text.size();
-    }
-
-    const size_t total_chars = std::max(total_old_chars, total_new_chars);
-    if (total_chars == 0) {
-        return 1.0;
-    }
-
-    return static_cast<double>(equal_chars) / static_cast<double>(total_chars);
 }
 
-} // namespace
-
-ViewModel create_view_model(const std::string& old_text, const std::string& new_text, uint32_t context) {
-    ViewModel vm;
-    vm.old_lines = split_lines(old_text);
-    vm.new_lines = split_lines(new_text);
-    auto diff_result = diff_lines(old_text, new_text, context);
-    if (diff_result.hunks.empty()) {
-        size_t max_lines = std::max(vm.old_lines.size(), vm.new_lines.size());
-        for (size_t i = 0; i < max_lines; ++i) {
-            ViewLine vl;
-            if (i < vm.old_lines.size()) {
-                vl.left = {LineKind::Context, static_cast<uint32_t>(i + 1)};
-            }
-            if (i < vm.new_lines.size()) {
-                vl.right = {LineKind::Context, static_cast<uint32_t>(i + 1)};
-            }
-            vm.lines.push_back(vl);
+/**
+ * The i-th deletion and the i-th insertion of a hunk are shown on one row
+ * when they are similar enough. Returns their character diff in that case.
+ */
+std::vector<std::optional<CharDiffRanges>> pair_lines(const DiffHunk& hunk,
+                                                      const LineTable& old_lines, const LineTable& new_lines,
+                                                      SimilarityStats& stats, const CancelToken* cancel) {
+    std::vector<size_t> delete_indices, insert_indices;
+    collect_changes(hunk, delete_indices, insert_indices);
+    const size_t potential_pair_count = std::min(delete_indices.size(), insert_indices.size());
+    std::vector<std::optional<CharDiffRanges>> pairs(potential_pair_count);
+    for (size_t i = 0; i < potential_pair_count; ++i) {
+        if (i % CANCEL_CHECK_INTERVAL == 0 && is_cancelled(cancel)) {
+            break;
         }
-        return vm;
+        pairs[i] = similar_char_ranges(old_lines[delete_indices[i]], new_lines[insert_indices[i]],
+                                       SIMILARITY_THRESHOLD, &stats);
     }
+    return pairs;
+}
 
-    size_t old_pos = 0, new_pos = 0;
-    for (const auto& hunk : diff_result.hunks) {
-        while (old_pos < hunk.old_start && new_pos < hunk.new_start) {
-            vm.lines.push_back({
-                {LineKind::Context, static_cast<uint32_t>(old_pos + 1)},
-                {LineKind::Context, static_cast<uint32_t>(new_pos + 1)}
-            });
-            ++old_pos;
-            ++new_pos;
-        }
-        auto connector_top = static_cast<uint32_t>(vm.lines.size());
-        uint32_t left_start = 0, left_end = 0, right_start = 0, right_end = 0;
-        std::vector<size_t> delete_indices, insert_indices;
-        for (const auto& [op, old_index, new_index] : hunk.lines) {
-            if (op == DiffOp::Delete) {
-                delete_indices.push_back(old_index);
-            } else if (op == DiffOp::Insert) {
-                insert_indices.push_back(new_index);
-            }
-        }
-        size_t potential_pair_count = std::min(delete_indices.size(), insert_indices.size());
-        std::set<size_t> valid_pair_del_indices;
-        std::set<size_t> valid_pair_ins_indices;
-        for (size_t i = 0; i < potential_pair_count; ++i) {
-            size_t del_idx = delete_indices[i];
-            size_t ins_idx = insert_indices[i];
-            auto char_diff = diff_chars(vm.old_lines[del_idx], vm.new_lines[ins_idx]);
-            const double similarity = calculate_similarity(char_diff);
-            if (similarity >= SIMILARITY_THRESHOLD) {
-                valid_pair_del_indices.insert(del_idx);
-                valid_pair_ins_indices.insert(ins_idx);
-            }
-        }
-        std::map<size_t, size_t> del_to_ins_map;
-        for (size_t i = 0; i < potential_pair_count; ++i) {
-            size_t del_idx = delete_indices[i];
-            size_t ins_idx = insert_indices[i];
-            if (valid_pair_del_indices.contains(del_idx)) {
-                del_to_ins_map[del_idx] = ins_idx;
-            }
-        }
-        for (const auto& [op, old_index, new_index] : hunk.lines) {
-            if (op == DiffOp::Equal) {
-                vm.lines.push_back({
+/**
+ * Build the rows, inline highlights and connector of one hunk.
+ * Row indices are relative to the first row of the hunk.
+ */
+void build_hunk_rows(const DiffHunk& hunk, const std::vector<std::optional<CharDiffRanges>>& pairs,
+                     std::vector<ViewLine>& lines, std::vector<InlineHighlight>& highlights, Connector& connector) {
+    std::vector<size_t> delete_indices, insert_indices;
+    collect_changes(hunk, delete_indices, insert_indices);
+    uint32_t left_start = 0, left_end = 0, right_start = 0, right_end = 0;
+    size_t old_index = hunk.old_start, new_index = hunk.new_start;
+    size_t delete_count = 0, insert_count = 0;
+    for (const auto& [op, length] : hunk.runs) {
+        if (op == DiffOp::Equal) {
+            for (size_t i = 0; i < length; ++i) {
+                lines.push_back({
                     {LineKind::Context, static_cast<uint32_t>(old_index + 1)},
                     {LineKind::Context, static_cast<uint32_t>(new_index + 1)}
                 });
-                old_pos = old_index + 1;
-                new_pos = new_index + 1;
-            } else if (op == DiffOp::Delete) {
+                ++old_index;
+                ++new_index;
+            }
+        } else if (op == DiffOp::Delete) {
+            for (size_t i = 0; i < length; ++i, ++old_index, ++delete_count) {
                 auto line_no = static_cast<uint32_t>(old_index + 1);
                 if (left_start == 0) {
                     left_start = line_no;
                 }
                 left_end = line_no;
-                if (valid_pair_del_indices.contains(old_index)) {
-                    size_t ins_idx = del_to_ins_map[old_index];
-                    vm.lines.push_back({
+                if (delete_count < pairs.size() && pairs[delete_count].has_value()) {
+                    const auto ins_line_no = static_cast<uint32_t>(insert_indices[delete_count] + 1);
+                    lines.push_back({
                         {LineKind::Removed, line_no},
-                        {LineKind::Added, static_cast<uint32_t>(ins_idx + 1)}
+                        {LineKind::Added, ins_line_no}
                     });
                     if (right_start == 0) {
-                        right_start = static_cast<uint32_t>(ins_idx + 1);
+                        right_start = ins_line_no;
                     }
-                    right_end = static_cast<uint32_t>(ins_idx + 1);
+                    right_end = ins_line_no;
                 } else {
-                    vm.lines.push_back({
+                    lines.push_back({
                         {LineKind::Removed, line_no},
                         {LineKind::Blank, 0}
                     });
                 }
-                old_pos = old_index + 1;
-            } else if (op == DiffOp::Insert) {
-                if (valid_pair_ins_indices.contains(new_index)) {
+            }
+        } else if (op == DiffOp::Insert) {
+            for (size_t i = 0; i < length; ++i, ++new_index, ++insert_count) {
+                if (insert_count < pairs.size() && pairs[insert_count].has_value()) {
                     continue;
                 }
                 auto line_no = static_cast<uint32_t>(new_index + 1);
@@ -153,91 +113,335 @@ ViewModel create_view_model(const std::string& old_text, const std::string& new_
                     right_start = line_no;
                 }
                 right_end = line_no;
-                vm.lines.push_back({
+                lines.push_back({
                     {LineKind::Blank, 0},
                     {LineKind::Added, line_no}
                 });
-                new_pos = new_index + 1;
             }
         }
-        if (vm.lines.size() > connector_top) {
-            auto get_type_order = [](const ViewLine& v) -> int {
-                if (v.left.kind != LineKind::Blank && v.right.kind == LineKind::Blank) {
-                    return 0;
-                }
-                if (v.left.kind != LineKind::Blank && v.right.kind != LineKind::Blank) {
-                    return 1;
-                }
-                return 2;
-            };
-            std::sort(vm.lines.begin() + connector_top, vm.lines.end(),
-                [&get_type_order](const ViewLine& a, const ViewLine& b) {
-                    const int a_type = get_type_order(a);
-                    const int b_type = get_type_order(b);
-                    if (a_type != b_type) {
-                        return a_type < b_type;
-                    }
-                    const uint32_t a_key = (a.right.kind != LineKind::Blank) ? a.right.line_no : a.left.line_no;
-                    const uint32_t b_key = (b.right.kind != LineKind::Blank) ? b.right.line_no : b.left.line_no;
-                    return a_key < b_key;
-                });
+    }
+    auto get_type_order = [](const ViewLine& v) -> int {
+        if (v.left.kind != LineKind::Blank && v.right.kind == LineKind::Blank) {
+            return 0;
         }
-        for (size_t row_idx = connector_top; row_idx < vm.lines.size(); ++row_idx) {
-            const auto& [left, right] = vm.lines[row_idx];
-            if (left.kind == LineKind::Removed && right.kind == LineKind::Added) {
-                size_t old_idx = left.line_no - 1;
-                size_t new_idx = right.line_no - 1;
-                auto [old_segments, new_segments] = diff_chars(vm.old_lines[old_idx], vm.new_lines[new_idx]);
-                const double similarity = calculate_similarity({old_segments, new_segments});
-                if (similarity >= SIMILARITY_THRESHOLD) {
-                    auto old_graphemes = grapheme_break::segmentGraphemeClusters(vm.old_lines[old_idx]);
-                    auto new_graphemes = grapheme_break::segmentGraphemeClusters(vm.new_lines[new_idx]);
-                    size_t grapheme_pos = 0;
-                    for (const auto& [seg_op, text] : old_segments) {
-                        size_t seg_len = grapheme_break::segmentGraphemeClusters(text).size();
-                        if (seg_op == DiffOp::Delete) {
-                            vm.highlights.push_back({
-                                static_cast<uint32_t>(row_idx),
-                                static_cast<uint32_t>(grapheme_to_byte_offset(old_graphemes, grapheme_pos)),
-                                static_cast<uint32_t>(grapheme_to_byte_offset(old_graphemes, grapheme_pos + seg_len)),
-                                true
-                            });
-                        }
-                        grapheme_pos += seg_len;
-                    }
-                    grapheme_pos = 0;
-                    for (const auto& [seg_op, text] : new_segments) {
-                        size_t seg_len = grapheme_break::segmentGraphemeClusters(text).size();
-                        if (seg_op == DiffOp::Insert) {
-                            vm.highlights.push_back({
-                                static_cast<uint32_t>(row_idx),
-                                static_cast<uint32_t>(grapheme_to_byte_offset(new_graphemes, grapheme_pos)),
-                                static_cast<uint32_t>(grapheme_to_byte_offset(new_graphemes, grapheme_pos + seg_len)),
-                                false
-                            });
-                        }
-                        grapheme_pos += seg_len;
-                    }
-                }
+        if (v.left.kind != LineKind::Blank && v.right.kind != LineKind::Blank) {
+            return 1;
+        }
+        return 2;
+    };
+    std::sort(lines.begin(), lines.end(),
+        [&get_type_order](const ViewLine& a, const ViewLine& b) {
+            const int a_type = get_type_order(a);
+            const int b_type = get_type_order(b);
+            if (a_type != b_type) {
+                return a_type < b_type;
             }
+            const uint32_t a_key = (a.right.kind != LineKind::Blank) ? a.right.line_no : a.left.line_no;
+            const uint32_t b_key = (b.right.kind != LineKind::Blank) ? b.right.line_no : b.left.line_no;
+            return a_key < b_key;
+        });
+    // Paired rows highlight the byte ranges their character diff changed
+    for (size_t row_idx = 0; row_idx < lines.size(); ++row_idx) {
+        const auto& [left, right] = lines[row_idx];
+        if (left.kind != LineKind::Removed || right.kind != LineKind::Added) {
+            continue;
         }
-        if (auto connector_bottom = static_cast<uint32_t>(vm.lines.size() - 1); connector_bottom >= connector_top) {
-            vm.connectors.push_back({
-                connector_top, connector_bottom,
-                left_start, left_end,
-                right_start, right_end
-            });
+        const auto pair = std::lower_bound(delete_indices.begin(), delete_indices.end(), left.line_no - 1);
+        const auto& [old_ranges, new_ranges] = *pairs[static_cast<size_t>(pair - delete_indices.begin())];
+        for (const auto& [op, begin, end] : old_ranges) {
+            if (op == DiffOp::Delete) {
+                highlights.push_back({static_cast<uint32_t>(row_idx), begin, end, true});
+            }
+        }
+        for (const auto& [op, begin, end] : new_ranges) {
+            if (op == DiffOp::Insert) {
+                highlights.push_back({static_cast<uint32_t>(row_idx), begin, end, false});
+            }
+        }
+    }
+    connector = {
+        0, static_cast<uint32_t>(lines.size() - 1),
+        left_start, left_end,
+        right_start, right_end
+    };
+}
+
+} // namespace
+
+/**
+ * Rows of one hunk, relative to its first row.
+ */
+struct LazyViewModel::Fragment {
+    std::vector<ViewLine> lines;
+    std::vector<InlineHighlight> highlights;
+    Connector connector{};
+};
+
+LazyViewModel::LazyViewModel(const std::string_view old_text, const std::string_view new_text, const ViewOptions& options)
+    : LazyViewModel(diff_lines(LineTable::copy(old_text), LineTable::copy(new_text), options.diff), options) {}
+
+LazyViewModel::LazyViewModel(DiffResult diff_result, const ViewOptions& options)
+    : pool_(options.pool), cancel_(options.diff.cancel), progress_(options.diff.progress) {
+    old_lines_ = std::move(diff_result.old_lines);
+    new_lines_ = std::move(diff_result.new_lines);
+    approximate_ = diff_result.approximate;
+    if (diff_result.cancelled) {
+        cancelled_ = true;
+        return;
+    }
+    hunks_ = std::move(diff_result.hunks);
+    fragments_.resize(hunks_.size());
+
+    // Unchanged lines between hunks are the same on both sides
+    const auto add_unchanged = [this, &options](const size_t old_pos, const size_t new_pos, const size_t count) {
+        if (count > 0) {
+            segments_.push_back({SIZE_MAX, old_pos, new_pos, count, options.fold_unchanged, 0, 0});
+        }
+    };
+    // Hunks are paired independently; their stats are summed in order
+    pairs_.resize(hunks_.size());
+    std::vector<SimilarityStats> hunk_stats(hunks_.size());
+    PhaseProgress pairing(progress_, DiffPhase::Pairing, hunks_.size());
+    parallel_for(pool_, hunks_.size(), [&](const size_t i) {
+        pairs_[i] = pair_lines(hunks_[i], old_lines_, new_lines_, hunk_stats[i], cancel_);
+        pairing.advance();
+    });
+    if (is_cancelled(cancel_)) {
+        // Some pairs may be missing; no rows are built from them
+        cancelled_ = true;
+        hunks_.clear();
+        pairs_.clear();
+        fragments_.clear();
+        return;
+    }
+    pairing.finish();
+    for (const auto& stats : hunk_stats) {
+        similarity_stats_ += stats;
+    }
+
+    size_t old_pos = 0, new_pos = 0;
+    for (size_t i = 0; i < hunks_.size(); ++i) {
+        const auto& hunk = hunks_[i];
+        add_unchanged(old_pos, new_pos, std::min(hunk.old_start - old_pos, hunk.new_start - new_pos));
+        const auto paired = static_cast<size_t>(std::count_if(pairs_[i].begin(), pairs_[i].end(),
+            [](const std::optional<CharDiffRanges>& pair) { return pair.has_value(); }));
+        size_t rows = 0;
+        for (const auto& [op, length] : hunk.runs) {
+            rows += length;
         }
+        segments_.push_back({i, hunk.old_start, hunk.new_start, 0, false, 0, rows - paired});
+        old_pos = hunk.old_start + hunk.old_count;
+        new_pos = hunk.new_start + hunk.new_count;
     }
-    while (old_pos < vm.old_lines.size() && new_pos < vm.new_lines.size()) {
-        vm.lines.push_back({
-            {LineKind::Context, static_cast<uint32_t>(old_pos + 1)},
-            {LineKind::Context, static_cast<uint32_t>(new_pos + 1)}
+    add_unchanged(old_pos, new_pos, std::min(old_lines_.size() - old_pos, new_lines_.size() - new_pos));
+    layout();
+}
+
+LazyViewModel::~LazyViewModel() = default;
+LazyViewModel::LazyViewModel(LazyViewModel&&) noexcept = default;
+LazyViewModel& LazyViewModel::operator=(LazyViewModel&&) noexcept = default;
+
+size_t LazyViewModel::row_count() const {
+    return segments_.empty() ? 0 : segments_.back().first_row + segments_.back().row_count;
+}
+
+void LazyViewModel::layout() {
+    hunk_rows_.clear();
+    size_t row = 0;
+    for (auto& segment : segments_) {
+        if (segment.hunk == SIZE_MAX) {
+            segment.row_count = segment.folded ? 1 : segment.count;
+        } else {
+            hunk_rows_.push_back({static_cast<uint32_t>(row), static_cast<uint32_t>(segment.row_count)});
+        }
+        segment.first_row = row;
+        row += segment.row_count;
+    }
+}
+
+const LazyViewModel::Fragment& LazyViewModel::fragment(const size_t hunk) {
+    if (!fragments_[hunk]) {
+        auto built = std::make_unique<Fragment>();
+        build_hunk_rows(hunks_[hunk], pairs_[hunk], built->lines, built->highlights, built->connector);
+        fragments_[hunk] = std::move(built);
+    }
+    return *fragments_[hunk];
+}
+
+void LazyViewModel::append_rows(const Segment& segment, const Fragment* fragment,
+                                const size_t begin, const size_t end, ViewWindow& window) const {
+    const size_t first = std::max(begin, segment.first_row);
+    const size_t last = std::min(end, segment.first_row + segment.row_count);
+    if (fragment != nullptr) {
+        const auto offset = static_cast<uint32_t>(segment.first_row);
+        window.lines.insert(window.lines.end(),
+                            fragment->lines.begin() + static_cast<std::ptrdiff_t>(first - segment.first_row),
+                            fragment->lines.begin() + static_cast<std::ptrdiff_t>(last - segment.first_row));
+        for (auto highlight : fragment->highlights) {
+            highlight.row += offset;
+            if (highlight.row >= first && highlight.row < last) {
+                window.highlights.push_back(highlight);
+            }
+        }
+        auto connector = fragment->connector;
+        connector.top += offset;
+        connector.bottom += offset;
+        window.connectors.push_back(connector);
+    } else if (segment.folded) {
+        window.folds.push_back({static_cast<uint32_t>(segment.first_row), static_cast<uint32_t>(segment.count)});
+        window.lines.push_back({
+            {LineKind::Folded, static_cast<uint32_t>(segment.old_start + 1)},
+            {LineKind::Folded, static_cast<uint32_t>(segment.new_start + 1)}
         });
-        ++old_pos;
-        ++new_pos;
+    } else {
+        for (size_t row = first; row < last; ++row) {
+            const size_t offset = row - segment.first_row;
+            window.lines.push_back({
+                {LineKind::Context, static_cast<uint32_t>(segment.old_start + offset + 1)},
+                {LineKind::Context, static_cast<uint32_t>(segment.new_start + offset + 1)}
+            });
+        }
+    }
+}
+
+ViewWindow LazyViewModel::rows(size_t begin, size_t end) {
+    end = std::min(end, row_count());
+    begin = std::min(begin, end);
+    ViewWindow window;
+    window.begin = static_cast<uint32_t>(begin);
+    // First segment that ends after `begin`
+    auto it = std::upper_bound(segments_.begin(), segments_.end(), begin,
+        [](const size_t row, const Segment& segment) { return row < segment.first_row + segment.row_count; });
+    for (; it != segments_.end() && it->first_row < end; ++it) {
+        const Fragment* hunk_fragment = it->hunk == SIZE_MAX ? nullptr : &fragment(it->hunk);
+        append_rows(*it, hunk_fragment, begin, end, window);
+    }
+    return window;
+}
+
+size_t LazyViewModel::expand_fold(const size_t row) {
+    const auto it = std::find_if(segments_.begin(), segments_.end(),
+        [row](const Segment& segment) { return segment.first_row == row && segment.hunk == SIZE_MAX && segment.folded; });
+    if (it == segments_.end()) {
+        return 0;
+    }
+    it->folded = false;
+    layout();
+    return it->count - 1;
+}
+
+ViewModel LazyViewModel::to_view_model() && {
+    ViewModel vm;
+    vm.old_lines = std::move(old_lines_);
+    vm.new_lines = std::move(new_lines_);
+    vm.approximate = approximate_;
+    vm.cancelled = cancelled_;
+    if (cancelled_) {
+        return vm;
     }
+
+    // Runs of consecutive segments are built into separate windows, several
+    // per thread so that uneven hunks balance out, then concatenated in order
+    const size_t end = row_count();
+    const size_t chunk_count = pool_ == nullptr ? 1 : std::min(segments_.size(), pool_->size() * 4);
+    std::vector<ViewWindow> windows(std::max<size_t>(chunk_count, 1));
+    PhaseProgress highlights(progress_, DiffPhase::Highlights, segments_.size());
+    std::atomic<bool> cancelled{false};
+    parallel_for(pool_, chunk_count, [&](const size_t chunk) {
+        const size_t first = segments_.size() * chunk / chunk_count;
+        const size_t last = segments_.size() * (chunk + 1) / chunk_count;
+        for (size_t i = first; i < last; ++i) {
+            if (is_cancelled(cancel_)) {
+                cancelled.store(true, std::memory_order_relaxed);
+                return;
+            }
+            const auto& segment = segments_[i];
+            if (segment.hunk == SIZE_MAX) {
+                append_rows(segment, nullptr, 0, end, windows[chunk]);
+            } else if (fragments_[segment.hunk]) {
+                append_rows(segment, fragments_[segment.hunk].get(), 0, end, windows[chunk]);
+            } else {
+                // Not cached: this is the only use of the rows
+                Fragment built;
+                build_hunk_rows(hunks_[segment.hunk], pairs_[segment.hunk],
+                                built.lines, built.highlights, built.connector);
+                append_rows(segment, &built, 0, end, windows[chunk]);
+            }
+            highlights.advance();
+        }
+    });
+    if (cancelled.load(std::memory_order_relaxed)) {
+        vm.cancelled = true;
+        return vm;
+    }
+    highlights.finish();
+
+    ViewWindow window = std::move(windows[0]);
+    for (size_t chunk = 1; chunk < windows.size(); ++chunk) {
+        const auto& part = windows[chunk];
+        window.lines.insert(window.lines.end(), part.lines.begin(), part.lines.end());
+        window.highlights.insert(window.highlights.end(), part.highlights.begin(), part.highlights.end());
+        window.connectors.insert(window.connectors.end(), part.connectors.begin(), part.connectors.end());
+        window.folds.insert(window.folds.end(), part.folds.begin(), part.folds.end());
+    }
+    vm.lines = std::move(window.lines);
+    vm.highlights = std::move(window.highlights);
+    vm.connectors = std::move(window.connectors);
+    vm.folds = std::move(window.folds);
     return vm;
 }
 
+ViewModel create_view_model(const std::string& old_text, const std::string& new_text, const uint32_t context) {
+    DiffOptions options;
+    options.context_lines = context;
+    return create_view_model(old_text, new_text, options);
+}
+
+ViewModel create_view_model(const std::string& old_text, const std::string& new_text, const DiffOptions& options) {
+    ViewOptions view_options;
+    view_options.diff = options;
+    return create_view_model(old_text, new_text, view_options);
+}
+
+ViewModel create_view_model(const std::string& old_text, const std::string& new_text, const ViewOptions& options) {
+    return LazyViewModel(old_text, new_text, options).to_view_model();
+}
+
+size_t expand_fold(ViewModel& vm, const size_t row) {
+    const auto fold = std::lower_bound(vm.folds.begin(), vm.folds.end(), row,
+        [](const Fold& f, const size_t r) { return f.row < r; });
+    if (fold == vm.folds.end() || fold->row != row) {
+        return 0;
+    }
+    const uint32_t count = fold->count;
+    const auto [left, right] = vm.lines[row];
+    std::vector<ViewLine> rows;
+    rows.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        rows.push_back({
+            {LineKind::Context, left.line_no + i},
+            {LineKind::Context, right.line_no + i}
+        });
+    }
+    const auto it = vm.lines.erase(vm.lines.begin() + static_cast<std::ptrdiff_t>(row));
+    vm.lines.insert(it, rows.begin(), rows.end());
+
+    const uint32_t added = count - 1;
+    for (auto next = vm.folds.erase(fold); next != vm.folds.end(); ++next) {
+        next->row += added;
+    }
+    for (auto& highlight : vm.highlights) {
+        if (highlight.row > row) {
+            highlight.row += added;
+        }
+    }
+    for (auto& connector : vm.connectors) {
+        if (connector.top > row) {
+            connector.top += added;
+            connector.bottom += added;
+        }
+    }
+    return added;
+}
+
 } // namespace diff_view
@@ -0,0 +1,124 @@
+#include <gtest/gtest.h>
+#include "anchored_diff.h"
+#include "myers.h"
+
+#include <random>
+
+using namespace diff_view;
+
+namespace {
+
+InternedLines intern(const std::vector<std::string>& old_lines, const std::vector<std::string>& new_lines) {
+    return intern_lines(LineTable::from_lines(old_lines), LineTable::from_lines(new_lines));
+}
+
+/**
+ * Check that the script turns the old IDs into the new ones and return its edit count.
+ */
+size_t check_script(const InternedLines& interned, const std::vector<EditRun>& runs) {
+    size_t old_idx = 0, new_idx = 0, edits = 0;
+    for (const auto op : expand_runs(runs)) {
+        if (op == DiffOp::Equal) {
+            EXPECT_LT(old_idx, interned.old_ids.size());
+            EXPECT_LT(new_idx, interned.new_ids.size());
+            if (old_idx < interned.old_ids.size() && new_idx < interned.new_ids.size()) {
+                EXPECT_EQ(interned.old_ids[old_idx], interned.new_ids[new_idx]);
+            }
+            ++old_idx;
+            ++new_idx;
+        } else if (op == DiffOp::Delete) {
+            ++old_idx;
+            ++edits;
+        } else {
+            ++new_idx;
+            ++edits;
+        }
+    }
+    EXPECT_EQ(old_idx, interned.old_ids.size());
+    EXPECT_EQ(new_idx, interned.new_ids.size());
+    return edits;
+}
+
+std::string ops_to_string(const std::vector<EditRun>& runs) {
+    std::string result;
+    for (const auto op : expand_runs(runs)) {
+        result += op == DiffOp::Equal ? '=' : (op == DiffOp::Delete ? '-' : '+');
+    }
+    return result;
+}
+
+} // namespace
+
+TEST(AnchoredDiff, BothEmpty) {
+    const auto interned = intern({}, {});
+    EXPECT_TRUE(patience_diff(interned).empty());
+    EXPECT_TRUE(histogram_diff(interned).empty());
+}
+
+TEST(AnchoredDiff, OneSideEmpty) {
+    const auto inserted = intern({}, {"a", "b"});
+    EXPECT_EQ(ops_to_string(patience_diff(inserted)), "++");
+    EXPECT_EQ(ops_to_string(histogram_diff(inserted)), "++");
+    const auto deleted = intern({"a", "b"}, {});
+    EXPECT_EQ(ops_to_string(patience_diff(deleted)), "--");
+    EXPECT_EQ(ops_to_string(histogram_diff(deleted)), "--");
+}
+
+TEST(AnchoredDiff, AnchorsOnUniqueLinesInsteadOfBraces) {
+    // Inserting a function before another one: Myers matches the closing
+    // braces, anchored algorithms keep the existing function intact.
+    const auto interned = intern(
+        {"void a() {", "  one();", "}", "", "void c() {", "  three();", "}"},
+        {"void a() {", "  one();", "}", "", "void b() {", "  two();", "}", "", "void c() {", "  three();", "}"});
+    const std::string expected = "====++++===";
+    EXPECT_EQ(ops_to_string(patience_diff(interned)), expected);
+    EXPECT_EQ(ops_to_string(histogram_diff(interned)), expected);
+}
+
+TEST(AnchoredDiff, MovedBlock) {
+    const auto interned = intern({"a", "b", "c", "x", "y", "z"}, {"x", "y", "z", "a", "b", "c"});
+    EXPECT_EQ(check_script(interned, patience_diff(interned)), 6);
+    EXPECT_EQ(check_script(interned, histogram_diff(interned)), 6);
+}
+
+TEST(AnchoredDiff, NoCommonLines) {
+    const auto interned = intern({"a", "b"}, {"c", "d", "e"});
+    EXPECT_EQ(ops_to_string(patience_diff(interned)), "--+++");
+    EXPECT_EQ(ops_to_string(histogram_diff(interned)), "--+++");
+}
+
+TEST(AnchoredDiff, OnlyRepeatedLinesFallBackToMyers) {
+    const auto interned = intern({"}", "}", "x", "}"}, {"}", "y", "}", "}"});
+    const auto myers = myers_edit_runs(interned.old_ids, interned.new_ids);
+    EXPECT_EQ(patience_diff(interned), myers);
+}
+
+TEST(AnchoredDiff, HistogramSkipsLinesAboveChainLimit) {
+    // The only shared line occurs `count` times in the old region: histogram
+    // anchors on its longest run up to the chain limit, and falls back to
+    // Myers above it
+    const std::vector<std::string> new_lines = {"a", "x", "b", "x", "x", "c"};
+    const auto at_limit = intern(std::vector<std::string>(64, "x"), new_lines);
+    EXPECT_EQ(ops_to_string(histogram_diff(at_limit)), "+++==" + std::string(62, '-') + "+");
+    EXPECT_NE(histogram_diff(at_limit), myers_edit_runs(at_limit.old_ids, at_limit.new_ids));
+    const auto above_limit = intern(std::vector<std::string>(65, "x"), new_lines);
+    EXPECT_EQ(histogram_diff(above_limit), myers_edit_runs(above_limit.old_ids, above_limit.new_ids));
+}
+
+TEST(AnchoredDiff, RandomScriptsAreValid) {
+    std::mt19937 rng(11);
+    for (int round = 0; round < 300; ++round) {
+        std::vector<std::string> old_lines, new_lines;
+        const size_t alphabet = 2 + rng() % 20;
+        for (size_t i = rng() % 60; i > 0; --i) {
+            old_lines.push_back(std::to_string(rng() % alphabet));
+        }
+        for (size_t i = rng() % 60; i > 0; --i) {
+            new_lines.push_back(std::to_string(rng() % alphabet));
+        }
+        const auto interned = intern(old_lines, new_lines);
+        const size_t minimal = check_script(interned, myers_edit_runs(interned.old_ids, interned.new_ids));
+        EXPECT_GE(check_script(interned, patience_diff(interned)), minimal);
+        EXPECT_GE(check_script(interned, histogram_diff(interned)), minimal);
+    }
+}
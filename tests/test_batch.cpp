@@ -0,0 +1,69 @@
+#include <gtest/gtest.h>
+#include "batch.h"
+#include "test_utils.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace diff_view;
+
+TEST(Batch, Empty) {
+    EXPECT_TRUE(create_view_models({}).empty());
+}
+
+TEST(Batch, MatchesCreateViewModel) {
+    // Tiny, small and large pairs, out of size order
+    std::vector<std::string> texts;
+    for (const size_t line_count : {3, 2000, 0, 40, 5000, 1, 300, 40}) {
+        texts.push_back(test::numbered_lines(line_count));
+        texts.push_back(test::numbered_lines(line_count + line_count / 10, 7));
+    }
+    std::vector<FilePair> pairs;
+    for (size_t i = 0; i < texts.size(); i += 2) {
+        pairs.push_back({texts[i], texts[i + 1]});
+    }
+    ThreadPool pool(4);
+    BatchOptions options;
+    options.pool = &pool;
+    options.split_bytes = 50000;
+    options.group_bytes = 2000;
+    const auto items = create_view_models(pairs, options);
+    ASSERT_EQ(items.size(), pairs.size());
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        const auto expected = create_view_model(std::string(pairs[i].old_text), std::string(pairs[i].new_text));
+        if (pairs[i].old_text.size() + pairs[i].new_text.size() < options.split_bytes) {
+            test::expect_same_rows(items[i].view_model, expected);
+        } else {
+            // Built with the pool: the line diff is minimal, maybe aligned differently
+            EXPECT_EQ(items[i].view_model.old_lines.size(), expected.old_lines.size());
+            EXPECT_EQ(items[i].view_model.new_lines.size(), expected.new_lines.size());
+        }
+        EXPECT_GT(items[i].elapsed.count(), 0);
+    }
+}
+
+TEST(Batch, CallbackOncePerPair) {
+    const auto old_text = test::numbered_lines(50);
+    const auto new_text = test::numbered_lines(50, 7);
+    const std::vector<FilePair> pairs(100, FilePair{old_text, new_text});
+    ThreadPool pool(3);
+    BatchOptions options;
+    options.pool = &pool;
+    std::vector<std::atomic<int>> calls(pairs.size());
+    std::mutex mutex;
+    std::vector<size_t> rows;
+    create_view_models(pairs, options, [&](const size_t i, BatchItem&& item) {
+        ++calls[i];
+        std::lock_guard lock(mutex);
+        rows.push_back(item.view_model.lines.size());
+    });
+    for (const auto& count : calls) {
+        EXPECT_EQ(count, 1);
+    }
+    ASSERT_EQ(rows.size(), pairs.size());
+    for (const size_t count : rows) {
+        EXPECT_EQ(count, rows.front());
+    }
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include "bit_lcs.h"
+
+#include <random>
+#include <string>
+
+using namespace diff_view;
+
+namespace {
+
+size_t reference_lcs(const std::string& a, const std::string& b) {
+    std::vector<size_t> row(b.size() + 1, 0);
+    for (size_t i = 0; i < a.size(); ++i) {
+        size_t diagonal = 0;
+        for (size_t j = 0; j < b.size(); ++j) {
+            const size_t above = row[j + 1];
+            row[j + 1] = a[i] == b[j] ? diagonal + 1 : std::max(row[j], above);
+            diagonal = above;
+        }
+    }
+    return row[b.size()];
+}
+
+std::string random_string(std::mt19937& rng, const size_t length, const char alphabet) {
+    std::string str(length, 'a');
+    for (auto& c : str) {
+        c = static_cast<char>('a' + rng() % static_cast<unsigned>(alphabet));
+    }
+    return str;
+}
+
+/**
+ * Whether the script turns a into b, and the number of bytes it keeps.
+ */
+bool apply_script(const std::string& a, const std::string& b, const std::vector<EditRun>& runs, size_t& kept) {
+    size_t i = 0, j = 0;
+    kept = 0;
+    for (const auto& [op, length] : runs) {
+        for (size_t k = 0; k < length; ++k) {
+            if (op == DiffOp::Equal) {
+                if (i >= a.size() || j >= b.size() || a[i] != b[j]) {
+                    return false;
+                }
+                ++kept;
+            }
+            if (op != DiffOp::Insert) ++i;
+            if (op != DiffOp::Delete) ++j;
+        }
+    }
+    return i == a.size() && j == b.size();
+}
+
+} // namespace
+
+TEST(BitLcs, Empty) {
+    EXPECT_EQ(BitLcs("", "").length(), 0);
+    EXPECT_TRUE(BitLcs("", "").edit_runs().empty());
+    EXPECT_EQ(BitLcs("abc", "").edit_runs(), (std::vector<EditRun>{{DiffOp::Delete, 3}}));
+    EXPECT_EQ(BitLcs("", "abc").edit_runs(), (std::vector<EditRun>{{DiffOp::Insert, 3}}));
+}
+
+TEST(BitLcs, DeletionsBeforeInsertions) {
+    const BitLcs lcs("abcd", "xyzd");
+    EXPECT_EQ(lcs.length(), 1);
+    EXPECT_EQ(lcs.edit_runs(), (std::vector<EditRun>{{DiffOp::Delete, 3}, {DiffOp::Insert, 3}, {DiffOp::Equal, 1}}));
+}
+
+TEST(BitLcs, MatchesReference) {
+    std::mt19937 rng(17);
+    // Lengths around and across word boundaries
+    for (const size_t length : {1, 5, 63, 64, 65, 130, 500, 1024}) {
+        for (const char alphabet : {2, 4, 26}) {
+            const auto a = random_string(rng, length, alphabet);
+            const auto b = random_string(rng, rng() % (length + 1) + length / 2, alphabet);
+            const BitLcs lcs(a, b);
+            EXPECT_EQ(lcs.length(), reference_lcs(a, b)) << length << " " << static_cast<int>(alphabet);
+            size_t kept = 0;
+            EXPECT_TRUE(apply_script(a, b, lcs.edit_runs(), kept));
+            EXPECT_EQ(kept, lcs.length());
+        }
+    }
+}
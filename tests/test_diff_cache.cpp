@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include "diff_cache.h"
+#include "test_utils.h"
+#include "thread_pool.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace diff_view;
+
+namespace {
+
+/**
+ * An empty directory in the temporary directory, removed with the object.
+ */
+class TempDirectory {
+public:
+    explicit TempDirectory(const std::string& name) : path_(std::filesystem::temp_directory_path() / name) {
+        std::filesystem::remove_all(path_);
+        std::filesystem::create_directories(path_);
+    }
+    ~TempDirectory() { std::filesystem::remove_all(path_); }
+
+    [[nodiscard]] std::string path() const { return path_.string(); }
+
+private:
+    std::filesystem::path path_;
+};
+
+} // namespace
+
+TEST(DiffCache, DiffLinesHit) {
+    const auto old_text = test::numbered_lines(500, 0);
+    const auto new_text = test::numbered_lines(500, 37);
+    DiffCache cache;
+    const auto computed = cache.diff_lines(old_text, new_text);
+    const auto cached = cache.diff_lines(old_text, new_text);
+    test::expect_same_diff(computed, diff_lines(old_text, new_text));
+    test::expect_same_diff(cached, computed);
+    EXPECT_EQ(cached.old_lines.size(), computed.old_lines.size());
+    EXPECT_EQ(cached.new_lines[37], "line 37 changed");
+
+    const auto stats = cache.stats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.entries, 1);
+    EXPECT_GT(stats.bytes, 0);
+}
+
+TEST(DiffCache, KeyedByTextsAndOptions) {
+    const auto old_text = test::numbered_lines(100, 0);
+    const auto new_text = test::numbered_lines(100, 9);
+    DiffCache cache;
+    cache.diff_lines(old_text, new_text);
+    DiffOptions options;
+    options.context_lines = 1;
+    test::expect_same_diff(cache.diff_lines(old_text, new_text, options), diff_lines(old_text, new_text, options));
+    options.context_lines = 3;
+    options.algorithm = DiffAlgorithm::Histogram;
+    cache.diff_lines(old_text, new_text, options);
+    // The texts swapped, and moved across the boundary between them
+    cache.diff_lines(new_text, old_text);
+    cache.diff_lines(old_text + new_text.substr(0, 5), new_text.substr(5));
+    cache.view_model(old_text, new_text);
+    EXPECT_EQ(cache.stats().hits, 0);
+    EXPECT_EQ(cache.stats().misses, 6);
+
+    // The parallel search may align differently; its threshold only matters
+    // with a pool
+    ThreadPool pool(2);
+    DiffOptions parallel;
+    parallel.pool = &pool;
+    cache.diff_lines(old_text, new_text, parallel);
+    parallel.parallel_threshold = 64;
+    cache.diff_lines(old_text, new_text, parallel);
+    DiffOptions serial;
+    serial.parallel_threshold = 64;
+    cache.diff_lines(old_text, new_text, serial);
+    EXPECT_EQ(cache.stats().hits, 1);
+    EXPECT_EQ(cache.stats().misses, 8);
+}
+
+TEST(DiffCache, ViewModelHit) {
+    const auto old_text = test::numbered_lines(400, 0);
+    const auto new_text = test::numbered_lines(400, 23);
+    DiffCache cache;
+    for (const bool fold : {false, true}) {
+        ViewOptions options;
+        options.fold_unchanged = fold;
+        const auto expected = create_view_model(old_text, new_text, options);
+        ASSERT_FALSE(expected.highlights.empty());
+        test::expect_same_view_model(cache.view_model(old_text, new_text, options), expected);
+        test::expect_same_view_model(cache.view_model(old_text, new_text, options), expected);
+    }
+    EXPECT_EQ(cache.stats().hits, 2);
+    EXPECT_EQ(cache.stats().misses, 2);
+}
+
+TEST(DiffCache, ViewModelHitWithReorderedRows) {
+    // The deletion paired with the second insertion is shown before the
+    // unpaired first insertion, so the connector's new side ends before it starts
+    const std::string old_text = "same\nalpha beta gamma\nhello world 1\nsame\n";
+    const std::string new_text = "same\nzzzzzzzzzzzzzzzzzz\nhello world 2\nsame\n";
+    const auto expected = create_view_model(old_text, new_text);
+    ASSERT_EQ(expected.connectors.size(), 1);
+    ASSERT_LT(expected.connectors[0].right_end, expected.connectors[0].right_start);
+    DiffCache cache;
+    test::expect_same_view_model(cache.view_model(old_text, new_text), expected);
+    for (uint64_t hits = 1; hits <= 2; ++hits) {
+        test::expect_same_view_model(cache.view_model(old_text, new_text), expected);
+        EXPECT_EQ(cache.stats().hits, hits);
+    }
+    EXPECT_EQ(cache.stats().misses, 1);
+}
+
+TEST(DiffCache, EvictsLeastRecentlyUsed) {
+    const auto base = test::numbered_lines(200, 0);
+    const auto first = test::numbered_lines(200, 7);
+    const auto second = test::numbered_lines(200, 11);
+    const auto third = test::numbered_lines(200, 13);
+    DiffCache sizing;
+    sizing.diff_lines(base, first);
+    // Room for about two entries
+    DiffCache cache({sizing.stats().bytes * 5 / 2, ""});
+    cache.diff_lines(base, first);
+    cache.diff_lines(base, second);
+    cache.diff_lines(base, first);  // Now the most recent
+    cache.diff_lines(base, third);
+    EXPECT_EQ(cache.stats().evictions, 1);
+    EXPECT_EQ(cache.stats().entries, 2);
+
+    cache.diff_lines(base, first);
+    EXPECT_EQ(cache.stats().hits, 2);
+    cache.diff_lines(base, second);
+    EXPECT_EQ(cache.stats().hits, 2);
+    EXPECT_EQ(cache.stats().misses, 4);
+
+    cache.clear();
+    EXPECT_EQ(cache.stats().entries, 0);
+    EXPECT_EQ(cache.stats().bytes, 0);
+}
+
+TEST(DiffCache, OversizedEntriesAreNotKept) {
+    DiffCache cache({16, ""});
+    const auto old_text = test::numbered_lines(50, 0);
+    const auto new_text = test::numbered_lines(50, 3);
+    cache.diff_lines(old_text, new_text);
+    test::expect_same_diff(cache.diff_lines(old_text, new_text), diff_lines(old_text, new_text));
+    EXPECT_EQ(cache.stats().misses, 2);
+    EXPECT_EQ(cache.stats().entries, 0);
+}
+
+TEST(DiffCache, CancelledResultsAreNotKept) {
+    CancelToken token;
+    token.cancel();
+    DiffOptions options;
+    options.cancel = &token;
+    DiffCache cache;
+    EXPECT_TRUE(cache.diff_lines("a\n", "b\n", options).cancelled);
+    EXPECT_EQ(cache.stats().entries, 0);
+    options.cancel = nullptr;
+    EXPECT_FALSE(cache.diff_lines("a\n", "b\n", options).cancelled);
+    EXPECT_EQ(cache.stats().misses, 2);
+}
+
+TEST(DiffCache, DirectoryBackend) {
+    const TempDirectory directory("diff_view_cache_test");
+    const auto old_text = test::numbered_lines(300, 0);
+    const auto new_text = test::numbered_lines(300, 17);
+    {
+        DiffCache cache({size_t{1} << 20, directory.path()});
+        cache.diff_lines(old_text, new_text);
+        cache.view_model(old_text, new_text);
+    }
+    EXPECT_EQ(std::distance(std::filesystem::directory_iterator(directory.path()),
+                            std::filesystem::directory_iterator()), 2);
+
+    // A new cache, as after a restart, finds both on disk
+    DiffCache cache({size_t{1} << 20, directory.path()});
+    test::expect_same_diff(cache.diff_lines(old_text, new_text), diff_lines(old_text, new_text));
+    test::expect_same_view_model(cache.view_model(old_text, new_text), create_view_model(std::string(old_text), std::string(new_text)));
+    EXPECT_EQ(cache.stats().disk_hits, 2);
+    EXPECT_EQ(cache.stats().misses, 0);
+    cache.diff_lines(old_text, new_text);
+    EXPECT_EQ(cache.stats().hits, 1);
+}
+
+TEST(DiffCache, DamagedFilesAreRecomputed) {
+    const TempDirectory directory("diff_view_cache_damaged");
+    const auto old_text = test::numbered_lines(300, 0);
+    const auto new_text = test::numbered_lines(300, 17);
+    {
+        DiffCache cache({size_t{1} << 20, directory.path()});
+        cache.diff_lines(old_text, new_text);
+    }
+    for (const auto& entry : std::filesystem::directory_iterator(directory.path())) {
+        const auto size = std::filesystem::file_size(entry.path());
+        std::filesystem::resize_file(entry.path(), size / 2);
+    }
+    DiffCache cache({size_t{1} << 20, directory.path()});
+    test::expect_same_diff(cache.diff_lines(old_text, new_text), diff_lines(old_text, new_text));
+    EXPECT_EQ(cache.stats().disk_hits, 0);
+    EXPECT_EQ(cache.stats().misses, 1);
+    // The file was rewritten with the computed entry
+    DiffCache restarted({size_t{1} << 20, directory.path()});
+    test::expect_same_diff(restarted.diff_lines(old_text, new_text), diff_lines(old_text, new_text));
+    EXPECT_EQ(restarted.stats().misses, 0);
+}
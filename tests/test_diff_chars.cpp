@@ -1,6 +1,11 @@
 #include <gtest/gtest.h>
 #include "diff.h"
 
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
 using namespace diff_view;
 
 TEST(DiffChars, BothEmpty) {
@@ -178,3 +183,207 @@ TEST(DiffChars, MixedContent) {
     EXPECT_TRUE(found_chinese_delete);
     EXPECT_TRUE(found_chinese_insert);
 }
+
+TEST(DiffChars, LargeInput) {
+    // 100k characters with 2000 substitutions stays well within linear memory
+    std::string old_str, new_str;
+    for (size_t i = 0; i < 100000; ++i) {
+        const char c = static_cast<char>('a' + i * 7 % 26);
+        old_str += c;
+        new_str += (i % 50 == 25) ? '#' : c;
+    }
+    const auto [old_segments, new_segments] = diff_chars(old_str, new_str);
+    size_t deleted = 0, inserted = 0;
+    for (const auto& [op, text] : old_segments) {
+        if (op == DiffOp::Delete) deleted += text.size();
+    }
+    for (const auto& [op, text] : new_segments) {
+        if (op == DiffOp::Insert) inserted += text.size();
+    }
+    EXPECT_EQ(deleted, 2000);
+    EXPECT_EQ(inserted, 2000);
+}
+
+TEST(DiffChars, CombiningMarkAfterAscii) {
+    // The accent joins the ASCII letter before it into one cluster
+    const auto [old_segments, new_segments] = diff_chars("cafe\u0301 ok", "cafe ok");
+    ASSERT_EQ(old_segments.size(), 3);
+    EXPECT_EQ(old_segments[0].text, "caf");
+    EXPECT_EQ(old_segments[1].op, DiffOp::Delete);
+    EXPECT_EQ(old_segments[1].text, "e\u0301");
+    EXPECT_EQ(old_segments[2].text, " ok");
+    ASSERT_EQ(new_segments.size(), 3);
+    EXPECT_EQ(new_segments[1].op, DiffOp::Insert);
+    EXPECT_EQ(new_segments[1].text, "e");
+}
+
+TEST(DiffChars, CrLfInAsciiLine) {
+    const auto [old_segments, new_segments] = diff_chars("a\r\nb", "a\rb");
+    ASSERT_EQ(old_segments.size(), 3);
+    EXPECT_EQ(old_segments[1].op, DiffOp::Delete);
+    EXPECT_EQ(old_segments[1].text, "\r\n");
+    ASSERT_EQ(new_segments.size(), 3);
+    EXPECT_EQ(new_segments[1].op, DiffOp::Insert);
+    EXPECT_EQ(new_segments[1].text, "\r");
+}
+
+TEST(DiffChars, NonAsciiBetweenAscii) {
+    const auto [old_segments, new_segments] = diff_chars("id=\U0001F1FA\U0001F1F8;x", "id=\U0001F1EC\U0001F1E7;x");
+    ASSERT_EQ(old_segments.size(), 3);
+    EXPECT_EQ(old_segments[0].text, "id=");
+    EXPECT_EQ(old_segments[1].op, DiffOp::Delete);
+    EXPECT_EQ(old_segments[1].text, "\U0001F1FA\U0001F1F8");
+    EXPECT_EQ(old_segments[2].text, ";x");
+    ASSERT_EQ(new_segments.size(), 3);
+    EXPECT_EQ(new_segments[1].op, DiffOp::Insert);
+    EXPECT_EQ(new_segments[1].text, "\U0001F1EC\U0001F1E7");
+}
+
+TEST(DiffChars, LongMixedLine) {
+    // Past the bit-parallel length limit, with ASCII runs around non-ASCII parts
+    std::string old_str, new_str;
+    for (size_t i = 0; i < 200; ++i) {
+        old_str += "item" + std::to_string(i) + (i % 20 == 0 ? "\u4f60\u597d;" : ";");
+        new_str += "item" + std::to_string(i) + (i % 20 == 0 ? (i == 100 ? "\u4f60\u5417;" : "\u4f60\u597d;") : ";");
+    }
+    ASSERT_GT(old_str.size(), 1024);
+    const auto [old_segments, new_segments] = diff_chars(old_str, new_str);
+    ASSERT_EQ(old_segments.size(), 3);
+    EXPECT_EQ(old_segments[1].op, DiffOp::Delete);
+    EXPECT_EQ(old_segments[1].text, "\u597d");
+    ASSERT_EQ(new_segments.size(), 3);
+    EXPECT_EQ(new_segments[1].op, DiffOp::Insert);
+    EXPECT_EQ(new_segments[1].text, "\u5417");
+}
+
+TEST(DiffChars, LongAsciiLine) {
+    std::string old_str(3000, 'a'), new_str(3000, 'a');
+    new_str[1500] = 'b';
+    const auto [old_segments, new_segments] = diff_chars(old_str, new_str);
+    ASSERT_EQ(old_segments.size(), 3);
+    EXPECT_EQ(old_segments[0].text.size(), 1500);
+    EXPECT_EQ(old_segments[1].text, "a");
+    ASSERT_EQ(new_segments.size(), 3);
+    EXPECT_EQ(new_segments[1].text, "b");
+}
+
+TEST(DiffCharRanges, ByteOffsets) {
+    const auto [old_ranges, new_ranges] = diff_char_ranges("a你😀b", "a我😀c");
+    ASSERT_EQ(old_ranges.size(), 4);
+    EXPECT_EQ(old_ranges[0].op, DiffOp::Equal);
+    EXPECT_EQ(old_ranges[0].begin, 0);
+    EXPECT_EQ(old_ranges[0].end, 1);
+    EXPECT_EQ(old_ranges[1].op, DiffOp::Delete);
+    EXPECT_EQ(old_ranges[1].begin, 1);
+    EXPECT_EQ(old_ranges[1].end, 4);
+    EXPECT_EQ(old_ranges[2].op, DiffOp::Equal);
+    EXPECT_EQ(old_ranges[2].begin, 4);
+    EXPECT_EQ(old_ranges[2].end, 8);
+    EXPECT_EQ(old_ranges[3].op, DiffOp::Delete);
+    EXPECT_EQ(old_ranges[3].begin, 8);
+    EXPECT_EQ(old_ranges[3].end, 9);
+    ASSERT_EQ(new_ranges.size(), 4);
+    EXPECT_EQ(new_ranges[1].op, DiffOp::Insert);
+    EXPECT_EQ(new_ranges[1].begin, 1);
+    EXPECT_EQ(new_ranges[1].end, 4);
+    EXPECT_EQ(new_ranges[3].op, DiffOp::Insert);
+    EXPECT_EQ(new_ranges[3].begin, 8);
+    EXPECT_EQ(new_ranges[3].end, 9);
+}
+
+TEST(DiffCharRanges, MatchesSegments) {
+    const std::string old_str = "let x = 1; // 👋🏻 hi", new_str = "let y = 12; // 👋🏿 hi";
+    const auto [old_ranges, new_ranges] = diff_char_ranges(old_str, new_str);
+    const auto [old_segments, new_segments] = diff_chars(old_str, new_str);
+    ASSERT_EQ(old_ranges.size(), old_segments.size());
+    for (size_t i = 0; i < old_ranges.size(); ++i) {
+        EXPECT_EQ(old_ranges[i].op, old_segments[i].op);
+        EXPECT_EQ(old_str.substr(old_ranges[i].begin, old_ranges[i].end - old_ranges[i].begin), old_segments[i].text);
+    }
+    ASSERT_EQ(new_ranges.size(), new_segments.size());
+    for (size_t i = 0; i < new_ranges.size(); ++i) {
+        EXPECT_EQ(new_ranges[i].op, new_segments[i].op);
+        EXPECT_EQ(new_str.substr(new_ranges[i].begin, new_ranges[i].end - new_ranges[i].begin), new_segments[i].text);
+    }
+}
+
+TEST(DiffCharRanges, Similarity) {
+    EXPECT_DOUBLE_EQ(char_similarity(diff_char_ranges("", "")), 1.0);
+    EXPECT_DOUBLE_EQ(char_similarity(diff_char_ranges("abcd", "abcd")), 1.0);
+    EXPECT_DOUBLE_EQ(char_similarity(diff_char_ranges("abcd", "abxd")), 0.75);
+    EXPECT_DOUBLE_EQ(char_similarity(diff_char_ranges("ab", "abcd")), 0.5);
+    EXPECT_DOUBLE_EQ(char_similarity(diff_char_ranges("abc", "xyz")), 0.0);
+}
+
+TEST(SimilarCharRanges, Bounds) {
+    SimilarityStats stats;
+    EXPECT_FALSE(similar_char_ranges("abcdefgh", "abc", 0.5, &stats).has_value());
+    EXPECT_EQ(stats.length_rejected, 1);
+    EXPECT_FALSE(similar_char_ranges("abcdefgh", "stuvwxyz", 0.5, &stats).has_value());
+    EXPECT_EQ(stats.bytes_rejected, 1);
+    EXPECT_FALSE(similar_char_ranges("abcdefgh", "hgfedcba", 0.5, &stats).has_value());
+    EXPECT_EQ(stats.lcs_rejected, 1);
+    EXPECT_FALSE(similar_char_ranges("éabcdefgh", "éhgfedcba", 0.5, &stats).has_value());
+    EXPECT_EQ(stats.distance_rejected, 1);
+    EXPECT_EQ(stats.compared, 4);
+    EXPECT_EQ(stats.avoided(), 4);
+}
+
+TEST(SimilarCharRanges, MatchesFullDiff) {
+    const std::vector<std::string> lines = {
+        "", "a", "ab", "abcd", "abxd", "dcba", "你好世界", "你好地球", "👋🏻 hello", "👋🏿 hello", "hello", "help",
+    };
+    SimilarityStats stats;
+    for (const auto& old_line : lines) {
+        for (const auto& new_line : lines) {
+            const auto full = diff_char_ranges(old_line, new_line);
+            const auto similar = similar_char_ranges(old_line, new_line, 0.5, &stats);
+            ASSERT_EQ(similar.has_value(), char_similarity(full) >= 0.5) << old_line << " / " << new_line;
+            if (similar) {
+                EXPECT_EQ(similar->old_ranges.size(), full.old_ranges.size());
+                EXPECT_EQ(similar->new_ranges.size(), full.new_ranges.size());
+            }
+        }
+    }
+    EXPECT_EQ(stats.compared, lines.size() * lines.size());
+    EXPECT_GT(stats.avoided(), 0);
+}
+
+namespace {
+
+bool same_ranges(const std::vector<CharDiffRange>& a, const std::vector<CharDiffRange>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const CharDiffRange& x, const CharDiffRange& y) {
+        return x.op == y.op && x.begin == y.begin && x.end == y.end;
+    });
+}
+
+} // namespace
+
+TEST(DiffCharRanges, ReusedEngine) {
+    // Long and short, ASCII and not, so that every scratch buffer shrinks and grows
+    const std::vector<std::pair<std::string, std::string>> pairs = {
+        {std::string(3000, 'a') + "你好", "b" + std::string(2500, 'a')},
+        {"abcd", "abxd"},
+        {"你好世界", "你好地球"},
+        {"line\r\n", "lane\r\n"},
+        {std::string(1500, 'x'), std::string(1400, 'x') + "y"},
+        {"", "abc"},
+        {"👋🏻 hello", "👋🏿 help"},
+    };
+    DiffEngine engine;
+    for (int round = 0; round < 2; ++round) {
+        for (const auto& [old_str, new_str] : pairs) {
+            DiffEngine fresh;
+            const auto reused = engine.diff_char_ranges(old_str, new_str);
+            const auto expected = fresh.diff_char_ranges(old_str, new_str);
+            EXPECT_TRUE(same_ranges(reused.old_ranges, expected.old_ranges)) << old_str << " / " << new_str;
+            EXPECT_TRUE(same_ranges(reused.new_ranges, expected.new_ranges)) << old_str << " / " << new_str;
+            const auto similar = engine.similar_char_ranges(old_str, new_str, 0.5);
+            ASSERT_EQ(similar.has_value(), char_similarity(expected) >= 0.5);
+            if (similar) {
+                EXPECT_TRUE(same_ranges(similar->old_ranges, expected.old_ranges));
+            }
+        }
+        engine.release();
+    }
+}
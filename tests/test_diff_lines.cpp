@@ -1,17 +1,63 @@
 #include <gtest/gtest.h>
 #include "diff.h"
+#include "test_utils.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
 
 using namespace diff_view;
 
+namespace {
+
+/**
+ * Run `fn` with the address space capped to the current size plus `extra_bytes`.
+ * The cap is only applied on Linux; elsewhere `fn` runs unrestricted.
+ */
+template <typename Fn>
+void with_memory_limit(const size_t extra_bytes, Fn fn) {
+#if defined(__linux__)
+    size_t pages = 0;
+    std::ifstream("/proc/self/statm") >> pages;
+    rlimit original{};
+    getrlimit(RLIMIT_AS, &original);
+    rlimit limited = original;
+    limited.rlim_cur = pages * static_cast<size_t>(sysconf(_SC_PAGESIZE)) + extra_bytes;
+    if (original.rlim_cur != RLIM_INFINITY && original.rlim_cur < limited.rlim_cur) {
+        limited.rlim_cur = original.rlim_cur;
+    }
+    setrlimit(RLIMIT_AS, &limited);
+    fn();
+    setrlimit(RLIMIT_AS, &original);
+#else
+    (void)extra_bytes;
+    fn();
+#endif
+}
+
+} // namespace
+
 TEST(DiffLines, BothEmpty) {
-    const auto [old_lines, new_lines, hunks] = diff_lines("", "");
+    const auto [old_lines, new_lines, hunks, approximate, cancelled] = diff_lines("", "");
     EXPECT_TRUE(old_lines.empty());
     EXPECT_TRUE(new_lines.empty());
     EXPECT_TRUE(hunks.empty());
 }
 
 TEST(DiffLines, OldEmpty) {
-    const auto [old_lines, new_lines, hunks] = diff_lines("", "line1\nline2");
+    const auto [old_lines, new_lines, hunks, approximate, cancelled] = diff_lines("", "line1\nline2");
     EXPECT_TRUE(old_lines.empty());
     ASSERT_EQ(new_lines.size(), 2);
     ASSERT_EQ(hunks.size(), 1);
@@ -20,7 +66,7 @@ TEST(DiffLines, OldEmpty) {
 }
 
 TEST(DiffLines, NewEmpty) {
-    const auto [old_lines, new_lines, hunks] = diff_lines("line1\nline2", "");
+    const auto [old_lines, new_lines, hunks, approximate, cancelled] = diff_lines("line1\nline2", "");
     ASSERT_EQ(old_lines.size(), 2);
     EXPECT_TRUE(new_lines.empty());
     ASSERT_EQ(hunks.size(), 1);
@@ -39,7 +85,7 @@ TEST(DiffLines, SingleInsert) {
 
     const auto& hunk = result.hunks[0];
     bool has_insert = false;
-    for (const auto& line : hunk.lines) {
+    for (const auto& line : expand_hunk(hunk)) {
         if (line.op == DiffOp::Insert) {
             has_insert = true;
             EXPECT_EQ(result.new_lines[line.new_index], "line2");
@@ -54,7 +100,7 @@ TEST(DiffLines, SingleDelete) {
 
     const auto& hunk = result.hunks[0];
     bool has_delete = false;
-    for (const auto& line : hunk.lines) {
+    for (const auto& line : expand_hunk(hunk)) {
         if (line.op == DiffOp::Delete) {
             has_delete = true;
             EXPECT_EQ(result.old_lines[line.old_index], "line2");
@@ -64,12 +110,12 @@ TEST(DiffLines, SingleDelete) {
 }
 
 TEST(DiffLines, Modification) {
-    const auto [old_lines, new_lines, hunks] = diff_lines("line1\nold\nline3", "line1\nnew\nline3");
+    const auto [old_lines, new_lines, hunks, approximate, cancelled] = diff_lines("line1\nold\nline3", "line1\nnew\nline3");
     ASSERT_EQ(hunks.size(), 1);
 
     const auto& hunk = hunks[0];
     bool has_delete = false, has_insert = false;
-    for (const auto&[op, old_index, new_index] : hunk.lines) {
+    for (const auto&[op, old_index, new_index] : expand_hunk(hunk)) {
         if (op == DiffOp::Delete) {
             has_delete = true;
             EXPECT_EQ(old_lines[old_index], "old");
@@ -90,7 +136,7 @@ TEST(DiffLines, ContextLines) {
         3);
 
     ASSERT_EQ(result.hunks.size(), 1);
-    EXPECT_GE(result.hunks[0].lines.size(), 5);
+    EXPECT_GE(expand_hunk(result.hunks[0]).size(), 5);
 }
 
 TEST(DiffLines, HunkMerging) {
@@ -113,7 +159,7 @@ TEST(DiffLines, ZeroContext) {
     const auto result = diff_lines("1\n2\n3", "1\nX\n3", 0);
     ASSERT_EQ(result.hunks.size(), 1);
     size_t change_count = 0;
-    for (const auto& line : result.hunks[0].lines) {
+    for (const auto& line : expand_hunk(result.hunks[0])) {
         if (line.op != DiffOp::Equal) {
             ++change_count;
         }
@@ -127,11 +173,11 @@ TEST(DiffLines, MixedLineEndings) {
 }
 
 TEST(DiffLines, UTF8Content) {
-    const auto [old_lines, new_lines, hunks] = diff_lines("你好\n世界", "你好\n宇宙");
+    const auto [old_lines, new_lines, hunks, approximate, cancelled] = diff_lines("你好\n世界", "你好\n宇宙");
     ASSERT_EQ(hunks.size(), 1);
 
     bool found_delete = false, found_insert = false;
-    for (const auto&[op, old_index, new_index] : hunks[0].lines) {
+    for (const auto&[op, old_index, new_index] : expand_hunk(hunks[0])) {
         if (op == DiffOp::Delete) {
             EXPECT_EQ(old_lines[old_index], "世界");
             found_delete = true;
@@ -163,7 +209,7 @@ TEST(DiffLines, MultipleDeletes) {
     ASSERT_EQ(result.hunks.size(), 1);
 
     size_t delete_count = 0;
-    for (const auto& line : result.hunks[0].lines) {
+    for (const auto& line : expand_hunk(result.hunks[0])) {
         if (line.op == DiffOp::Delete) {
             ++delete_count;
         }
@@ -176,7 +222,7 @@ TEST(DiffLines, MultipleInserts) {
     ASSERT_EQ(result.hunks.size(), 1);
 
     size_t insert_count = 0;
-    for (const auto& line : result.hunks[0].lines) {
+    for (const auto& line : expand_hunk(result.hunks[0])) {
         if (line.op == DiffOp::Insert) {
             ++insert_count;
         }
@@ -184,6 +230,33 @@ TEST(DiffLines, MultipleInserts) {
     EXPECT_EQ(insert_count, 2);
 }
 
+TEST(DiffLines, HunkRuns) {
+    const auto result = diff_lines("1\n2\n3\n4\n5\n6", "1\n2\n3\nX\nY\n5\n6", 1);
+    ASSERT_EQ(result.hunks.size(), 1);
+    const auto& hunk = result.hunks[0];
+    EXPECT_EQ(hunk.old_start, 2);
+    EXPECT_EQ(hunk.old_count, 3);
+    EXPECT_EQ(hunk.new_start, 2);
+    EXPECT_EQ(hunk.new_count, 4);
+    const std::vector<EditRun> expected = {
+        {DiffOp::Equal, 1}, {DiffOp::Delete, 1}, {DiffOp::Insert, 2}, {DiffOp::Equal, 1}};
+    EXPECT_EQ(hunk.runs, expected);
+    const auto lines = expand_hunk(hunk);
+    ASSERT_EQ(lines.size(), 5);
+    EXPECT_EQ(lines[1].old_index, 3);
+    EXPECT_EQ(lines[1].new_index, SIZE_MAX);
+    EXPECT_EQ(lines[3].new_index, 4);
+}
+
+TEST(DiffLines, InsertOnlyHunkStart) {
+    const auto result = diff_lines("a\nb\nd", "a\nb\nc\nd", 0);
+    ASSERT_EQ(result.hunks.size(), 1);
+    EXPECT_EQ(result.hunks[0].old_start, 2);
+    EXPECT_EQ(result.hunks[0].old_count, 0);
+    EXPECT_EQ(result.hunks[0].new_start, 2);
+    EXPECT_EQ(result.hunks[0].new_count, 1);
+}
+
 TEST(DiffLines, VectorOverload) {
     std::vector<std::string> old_lines = {"a", "b", "c"};
     std::vector<std::string> new_lines = {"a", "x", "c"};
@@ -192,12 +265,73 @@ TEST(DiffLines, VectorOverload) {
     ASSERT_EQ(result.hunks.size(), 1);
 }
 
+TEST(DiffLines, ViewsCallerBuffers) {
+    const std::string old_text = "a\nb\nc";
+    const std::string new_text = "a\nx\nc";
+    const auto result = diff_lines(old_text, new_text, 1);
+    EXPECT_EQ(result.old_lines.text().data(), old_text.data());
+    EXPECT_EQ(result.new_lines.text().data(), new_text.data());
+    EXPECT_EQ(result.old_lines[1], "b");
+    EXPECT_EQ(result.new_lines[1], "x");
+}
+
+TEST(DiffLines, LineTableOverload) {
+    const auto result = diff_lines(LineTable::copy("a\nb"), LineTable::copy("a\nc"), 0);
+    ASSERT_EQ(result.hunks.size(), 1);
+    EXPECT_EQ(result.hunks[0].old_start, 1);
+    EXPECT_EQ(result.old_lines[1], "b");
+}
+
+TEST(DiffLines, AlgorithmOption) {
+    const std::string_view old_text = "a() {\n  1\n}\nc() {\n  3\n}";
+    const std::string_view new_text = "a() {\n  1\n}\nb() {\n  2\n}\nc() {\n  3\n}";
+    for (const auto algorithm : {DiffAlgorithm::Myers, DiffAlgorithm::Patience, DiffAlgorithm::Histogram}) {
+        DiffOptions options;
+        options.context_lines = 0;
+        options.algorithm = algorithm;
+        const auto result = diff_lines(old_text, new_text, options);
+        ASSERT_EQ(result.hunks.size(), 1);
+        EXPECT_EQ(result.hunks[0].old_count, 0);
+        EXPECT_EQ(result.hunks[0].new_count, 3);
+    }
+    DiffOptions options;
+    options.context_lines = 0;
+    options.algorithm = DiffAlgorithm::Histogram;
+    const auto result = diff_lines(old_text, new_text, options);
+    EXPECT_EQ(result.new_lines[result.hunks[0].new_start], "b() {");
+}
+
+TEST(DiffLines, CostBudget) {
+    // Unrelated files: the exact search would run to D = 2 * line_count
+    constexpr size_t line_count = 20000;
+    std::string old_text, new_text;
+    for (size_t i = 0; i < line_count; ++i) {
+        old_text += "old " + std::to_string(i * 7 % 13) + "\n";
+        new_text += "new " + std::to_string(i * 5 % 11) + "\n";
+    }
+    for (const auto algorithm : {DiffAlgorithm::Myers, DiffAlgorithm::Histogram}) {
+        DiffOptions options;
+        options.algorithm = algorithm;
+        options.max_cost = 64;
+        const auto result = diff_lines(old_text, new_text, options);
+        EXPECT_TRUE(result.approximate);
+        size_t old_count = 0, new_count = 0;
+        for (const auto& hunk : result.hunks) {
+            old_count += hunk.old_count;
+            new_count += hunk.new_count;
+        }
+        EXPECT_EQ(old_count, result.old_lines.size());
+        EXPECT_EQ(new_count, result.new_lines.size());
+    }
+    EXPECT_FALSE(diff_lines("a\nb\nc", "a\nx\nc").approximate);
+}
+
 TEST(DiffLines, AllDifferent) {
     const auto result = diff_lines("a\nb\nc", "x\ny\nz", 0);
     ASSERT_EQ(result.hunks.size(), 1);
 
     size_t delete_count = 0, insert_count = 0;
-    for (const auto& line : result.hunks[0].lines) {
+    for (const auto& line : expand_hunk(result.hunks[0])) {
         if (line.op == DiffOp::Delete) ++delete_count;
         if (line.op == DiffOp::Insert) ++insert_count;
     }
@@ -237,3 +371,216 @@ TEST(DiffLines, OnlyDeletes) {
     EXPECT_EQ(result.hunks[0].old_count, 3);
     EXPECT_EQ(result.hunks[0].new_count, 0);
 }
+
+TEST(DiffLines, LargeInputBoundedMemory) {
+    // 200k lines with 2000 modified lines (D = 4000). Keeping a copy of the
+    // whole frontier per edit step would need about 4000 * 1.6M ints = 25 GB.
+    constexpr size_t line_count = 200000;
+    std::string old_text, new_text;
+    for (size_t i = 0; i < line_count; ++i) {
+        const auto line = "line " + std::to_string(i) + "\n";
+        old_text += line;
+        new_text += (i % 100 == 50) ? "changed " + std::to_string(i) + "\n" : line;
+    }
+    with_memory_limit(size_t{512} << 20, [&] {
+        const auto result = diff_lines(old_text, new_text, 0);
+        ASSERT_EQ(result.hunks.size(), line_count / 100);
+        for (const auto& hunk : result.hunks) {
+            EXPECT_EQ(hunk.old_count, 1);
+            EXPECT_EQ(hunk.new_count, 1);
+            EXPECT_EQ(hunk.old_start % 100, 50);
+            EXPECT_EQ(hunk.old_start, hunk.new_start);
+        }
+    });
+}
+
+TEST(DiffLines, ReusedEngine) {
+    std::mt19937 rng(31);
+    DiffEngine engine;
+    // Sizes up and down, so that the scratch buffers are reused both larger and smaller
+    for (const size_t line_count : {2000, 10, 500, 0, 3000, 40}) {
+        const auto old_text = test::random_text(rng, line_count, 20);
+        const auto new_text = test::random_text(rng, line_count + line_count / 3, 20);
+        for (const auto algorithm : {DiffAlgorithm::Myers, DiffAlgorithm::Patience, DiffAlgorithm::Histogram}) {
+            DiffOptions options;
+            options.algorithm = algorithm;
+            DiffEngine fresh;
+            const auto reused = engine.diff_lines(LineTable::view(old_text), LineTable::view(new_text), options);
+            const auto expected = fresh.diff_lines(LineTable::view(old_text), LineTable::view(new_text), options);
+            ASSERT_EQ(reused.hunks.size(), expected.hunks.size());
+            for (size_t i = 0; i < reused.hunks.size(); ++i) {
+                EXPECT_EQ(reused.hunks[i].old_start, expected.hunks[i].old_start);
+                EXPECT_EQ(reused.hunks[i].new_start, expected.hunks[i].new_start);
+                EXPECT_EQ(reused.hunks[i].runs, expected.hunks[i].runs);
+            }
+        }
+    }
+}
+
+TEST(DiffLines, EngineEditRuns) {
+    std::mt19937 rng(37);
+    const auto old_text = test::random_text(rng, 300, 10);
+    const auto new_text = test::random_text(rng, 280, 10);
+    std::pmr::monotonic_buffer_resource resource;
+    DiffEngine engine(&resource);
+    bool approximate = true;
+    const auto runs = engine.edit_runs(old_text, new_text, {}, &approximate);
+    EXPECT_FALSE(approximate);
+    EXPECT_EQ(runs.get_allocator().resource(), &resource);
+
+    // The script covers every line and has the changes of the hunks
+    const auto result = diff_lines(old_text, new_text, DiffOptions{.context_lines = 0});
+    size_t old_count = 0, new_count = 0, changed = 0, hunk_changed = 0;
+    for (const auto& [op, length] : runs) {
+        old_count += op != DiffOp::Insert ? length : 0;
+        new_count += op != DiffOp::Delete ? length : 0;
+        changed += op != DiffOp::Equal ? length : 0;
+    }
+    for (const auto& hunk : result.hunks) {
+        hunk_changed += hunk.old_count + hunk.new_count;
+    }
+    EXPECT_EQ(old_count, result.old_lines.size());
+    EXPECT_EQ(new_count, result.new_lines.size());
+    EXPECT_EQ(changed, hunk_changed);
+}
+
+TEST(DiffLines, CancelledBeforeStart) {
+    CancelToken token;
+    token.cancel();
+    for (const auto algorithm : {DiffAlgorithm::Myers, DiffAlgorithm::Patience, DiffAlgorithm::Histogram}) {
+        DiffOptions options;
+        options.algorithm = algorithm;
+        options.cancel = &token;
+        const auto result = diff_lines("a\nb\n", "a\nc\n", options);
+        EXPECT_TRUE(result.cancelled);
+        EXPECT_FALSE(result.approximate);
+        EXPECT_TRUE(result.hunks.empty());
+    }
+}
+
+TEST(DiffLines, CancelledByDeadline) {
+    const CancelToken token(std::chrono::steady_clock::now() - std::chrono::seconds(1));
+    DiffOptions options;
+    options.cancel = &token;
+    EXPECT_TRUE(diff_lines("a\n", "b\n", options).cancelled);
+
+    const CancelToken later(std::chrono::steady_clock::now() + std::chrono::hours(1));
+    options.cancel = &later;
+    const auto result = diff_lines("a\n", "b\n", options);
+    EXPECT_FALSE(result.cancelled);
+    EXPECT_EQ(result.hunks.size(), 1);
+}
+
+TEST(DiffLines, CancelledFromAnotherThread) {
+    // Unrelated texts: a minimal script would take Myers minutes
+    std::mt19937 rng(41);
+    const auto old_text = test::random_text(rng, 40000, 1000000);
+    const auto new_text = test::random_text(rng, 40000, 1000000);
+    CancelToken token;
+    DiffOptions options;
+    options.cancel = &token;
+    const auto start = std::chrono::steady_clock::now();
+    std::thread canceller([&token] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        token.cancel();
+    });
+    const auto result = diff_lines(old_text, new_text, options);
+    canceller.join();
+    EXPECT_TRUE(result.cancelled);
+    EXPECT_TRUE(result.hunks.empty());
+    EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
+
+TEST(DiffLines, Progress) {
+    std::mt19937 rng(43);
+    const auto old_text = test::random_text(rng, 500, 10);
+    const auto new_text = test::random_text(rng, 500, 10);
+    std::vector<std::pair<DiffPhase, double>> reports;
+    DiffOptions options;
+    options.progress = [&reports](const DiffPhase phase, const double fraction) {
+        reports.emplace_back(phase, fraction);
+    };
+    diff_lines(old_text, new_text, options);
+    ASSERT_GE(reports.size(), 2);
+    EXPECT_EQ(reports.front(), std::make_pair(DiffPhase::Lines, 0.0));
+    EXPECT_EQ(reports.back(), std::make_pair(DiffPhase::Lines, 1.0));
+}
+
+TEST(DiffLines, ProgressDuringSearch) {
+    const auto old_text = test::numbered_lines(10000, 0);
+    const auto new_text = test::numbered_lines(10000, 9);
+    ThreadPool pool(4);
+    for (const auto algorithm : {DiffAlgorithm::Myers, DiffAlgorithm::Patience, DiffAlgorithm::Histogram}) {
+        for (ThreadPool* const run_on : {static_cast<ThreadPool*>(nullptr), &pool}) {
+            std::vector<double> fractions;
+            DiffOptions options;
+            options.algorithm = algorithm;
+            options.pool = run_on;
+            options.parallel_threshold = 1000;
+            options.progress = [&fractions](const DiffPhase phase, const double fraction) {
+                EXPECT_EQ(phase, DiffPhase::Lines);
+                fractions.push_back(fraction);
+            };
+            diff_lines(old_text, new_text, options);
+            // Reported as lines are placed, at most once per percent
+            ASSERT_GT(fractions.size(), 10);
+            EXPECT_LE(fractions.size(), 101);
+            EXPECT_EQ(fractions.front(), 0.0);
+            EXPECT_EQ(fractions.back(), 1.0);
+            EXPECT_TRUE(std::is_sorted(fractions.begin(), fractions.end()));
+        }
+    }
+}
+
+TEST(DiffLines, ProgressCallbackDiffsAgain) {
+    // The callback runs inside the search; diffs it starts on the same
+    // thread must not use the scratch memory of the running one
+    const auto old_text = test::numbered_lines(10000, 0);
+    const auto new_text = test::numbered_lines(10000, 9);
+    const auto expected_chars = diff_chars("the quick brown fox", "the quack brown box");
+    for (const auto algorithm : {DiffAlgorithm::Myers, DiffAlgorithm::Patience, DiffAlgorithm::Histogram}) {
+        DiffOptions options;
+        options.algorithm = algorithm;
+        const auto expected = diff_lines(old_text, new_text, options);
+        size_t calls = 0;
+        options.progress = [&](DiffPhase, double) {
+            ++calls;
+            const auto chars = diff_chars("the quick brown fox", "the quack brown box");
+            EXPECT_EQ(chars.old_segments.size(), expected_chars.old_segments.size());
+            EXPECT_EQ(chars.new_segments.size(), expected_chars.new_segments.size());
+            EXPECT_EQ(diff_lines("a\nb\nc\n", "a\nc\nd\n").hunks.size(), 1);
+        };
+        const auto result = diff_lines(old_text, new_text, options);
+        EXPECT_GT(calls, 2);
+        ASSERT_EQ(result.hunks.size(), expected.hunks.size());
+        for (size_t i = 0; i < result.hunks.size(); ++i) {
+            EXPECT_EQ(result.hunks[i].old_start, expected.hunks[i].old_start);
+            EXPECT_EQ(result.hunks[i].new_start, expected.hunks[i].new_start);
+            EXPECT_EQ(result.hunks[i].runs, expected.hunks[i].runs);
+        }
+    }
+}
+
+TEST(DiffLines, CancelledDuringAnchoring) {
+    // Sparse changes: anchoring does nearly all the work
+    const auto old_text = test::numbered_lines(30000, 0);
+    const auto new_text = test::numbered_lines(30000, 7);
+    for (const auto algorithm : {DiffAlgorithm::Patience, DiffAlgorithm::Histogram}) {
+        CancelToken token;
+        double last = 0;
+        DiffOptions options;
+        options.algorithm = algorithm;
+        options.cancel = &token;
+        options.progress = [&token, &last](DiffPhase, const double fraction) {
+            last = fraction;
+            if (fraction >= 0.1) {
+                token.cancel();
+            }
+        };
+        const auto result = diff_lines(old_text, new_text, options);
+        EXPECT_TRUE(result.cancelled);
+        EXPECT_TRUE(result.hunks.empty());
+        // Stopped within a few regions of the cancel
+        EXPECT_LT(last, 0.2);
+    }
+}
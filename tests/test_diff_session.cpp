@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include "diff_session.h"
+#include "test_utils.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace diff_view;
+
+namespace {
+
+/**
+ * Every line of both sides is shown once, and context rows show equal lines.
+ */
+void expect_valid_rows(const ViewModel& vm) {
+    std::vector<uint32_t> line_counts(vm.lines.size(), 1);
+    for (const auto& [row, count] : vm.folds) {
+        line_counts[row] = count;
+    }
+    std::vector<int> old_seen(vm.old_lines.size()), new_seen(vm.new_lines.size());
+    for (size_t row = 0; row < vm.lines.size(); ++row) {
+        const auto& [left, right] = vm.lines[row];
+        if (left.kind != LineKind::Blank) {
+            ASSERT_GE(left.line_no, 1);
+            ASSERT_LE(left.line_no - 1 + line_counts[row], vm.old_lines.size());
+            for (uint32_t i = 0; i < line_counts[row]; ++i) {
+                ++old_seen[left.line_no - 1 + i];
+            }
+        }
+        if (right.kind != LineKind::Blank) {
+            ASSERT_GE(right.line_no, 1);
+            ASSERT_LE(right.line_no - 1 + line_counts[row], vm.new_lines.size());
+            for (uint32_t i = 0; i < line_counts[row]; ++i) {
+                ++new_seen[right.line_no - 1 + i];
+            }
+        }
+        if (left.kind == LineKind::Context) {
+            EXPECT_EQ(vm.old_lines[left.line_no - 1], vm.new_lines[right.line_no - 1]);
+        }
+    }
+    for (const int seen : old_seen) {
+        EXPECT_EQ(seen, 1);
+    }
+    for (const int seen : new_seen) {
+        EXPECT_EQ(seen, 1);
+    }
+}
+
+/**
+ * What a row shows: the text of both sides, the fold size and the highlights,
+ * with row indices dropped.
+ */
+struct RowContent {
+    std::string left;
+    std::string right;
+    uint32_t fold_count = 0;
+    std::vector<InlineHighlight> highlights;
+
+    bool operator==(const RowContent&) const = default;
+};
+
+std::vector<RowContent> row_contents(const ViewModel& vm) {
+    std::vector<RowContent> rows(vm.lines.size());
+    for (size_t row = 0; row < vm.lines.size(); ++row) {
+        const auto& [left, right] = vm.lines[row];
+        if (left.kind != LineKind::Blank) {
+            rows[row].left = vm.old_lines[left.line_no - 1];
+        }
+        if (right.kind != LineKind::Blank) {
+            rows[row].right = vm.new_lines[right.line_no - 1];
+        }
+    }
+    for (const auto& [row, count] : vm.folds) {
+        rows[row].fold_count = count;
+    }
+    for (auto highlight : vm.highlights) {
+        const uint32_t row = highlight.row;
+        highlight.row = 0;
+        rows[row].highlights.push_back(highlight);
+    }
+    return rows;
+}
+
+SideInfo shifted(SideInfo side, const int32_t shift) {
+    if (side.line_no != 0) {
+        side.line_no = static_cast<uint32_t>(static_cast<int64_t>(side.line_no) + shift);
+    }
+    return side;
+}
+
+} // namespace
+
+TEST(DiffSession, SeedMatchesCreateViewModel) {
+    std::mt19937 rng(1);
+    const auto old_text = test::random_text(rng, 300, 40);
+    const auto new_text = test::random_text(rng, 320, 40);
+    const DiffSession session(old_text, new_text);
+    test::expect_same_rows(session.view_model(), create_view_model(old_text, new_text));
+    EXPECT_EQ(session.old_text(), old_text);
+    EXPECT_EQ(session.new_text(), new_text);
+}
+
+TEST(DiffSession, EditInsideLine) {
+    std::mt19937 rng(3);
+    std::string old_text = test::random_text(rng, 200, 40);
+    std::string new_text = old_text;
+    new_text.replace(new_text.find("line", 300), 4, "LINE");
+    ViewOptions options;
+    options.fold_unchanged = true;
+    DiffSession session(old_text, new_text, options);
+
+    // Type one character into a line of the new side, far from the change
+    const size_t pos = new_text.find('\n', 1000);
+    new_text.insert(pos, "x");
+    const auto patch = session.apply({DiffSide::New, pos, pos, "x"});
+    EXPECT_EQ(session.new_text(), new_text);
+    test::expect_same_rows(session.view_model(), create_view_model(old_text, new_text, options));
+    EXPECT_EQ(patch.old_line_shift, 0);
+    EXPECT_EQ(patch.new_line_shift, 0);
+    EXPECT_GT(patch.inserted, 0);
+
+    // Typing it into the old side too makes the lines equal again
+    old_text.insert(pos, "x");
+    session.apply({DiffSide::Old, pos, pos, "x"});
+    test::expect_same_rows(session.view_model(), create_view_model(old_text, new_text, options));
+}
+
+TEST(DiffSession, EditInsidePairedLine) {
+    // The edited line already is a Removed/Added pair: the rows keep their
+    // kinds and line numbers, but the row's text and highlights change
+    DiffSession session("a\nfoo bar\nc\n", "a\nfoo baz\nc\n");
+    const auto previous = row_contents(session.view_model());
+    const auto patch = session.apply({DiffSide::New, 4, 5, "x"});
+    EXPECT_EQ(session.new_text(), "a\nfox baz\nc\n");
+    test::expect_same_rows(session.view_model(), create_view_model("a\nfoo bar\nc\n", "a\nfox baz\nc\n"));
+    ASSERT_EQ(session.view_model().lines[1].left.kind, LineKind::Removed);
+    ASSERT_EQ(session.view_model().lines[1].right.kind, LineKind::Added);
+    EXPECT_NE(row_contents(session.view_model())[1], previous[1]);
+    EXPECT_LE(patch.begin, 1);
+    EXPECT_GT(patch.begin + patch.inserted, 1);
+    EXPECT_EQ(patch.removed, patch.inserted);
+}
+
+TEST(DiffSession, RandomEdits) {
+    const std::vector<std::string> pieces = {"", "a", "\n", "line 3\n", "line 7\nline 8\n", "\r\n", "zz"};
+    for (const bool fold : {false, true}) {
+        std::mt19937 rng(11);
+        std::string texts[2] = {test::random_text(rng, 120, 40), test::random_text(rng, 120, 40)};
+        ViewOptions options;
+        options.fold_unchanged = fold;
+        DiffSession session(texts[0], texts[1], options);
+        for (int round = 0; round < 300; ++round) {
+            const size_t side = rng() % 2;
+            auto& text = texts[side];
+            const size_t begin = std::uniform_int_distribution<size_t>(0, text.size())(rng);
+            const size_t end = std::min(text.size(), begin + std::uniform_int_distribution<size_t>(0, 30)(rng));
+            const auto& piece = pieces[rng() % pieces.size()];
+            text.replace(begin, end - begin, piece);
+
+            const auto previous = session.view_model().lines;
+            const auto previous_contents = row_contents(session.view_model());
+            const auto patch = session.apply({side == 0 ? DiffSide::Old : DiffSide::New, begin, end, piece});
+            ASSERT_EQ(session.old_text(), texts[0]);
+            ASSERT_EQ(session.new_text(), texts[1]);
+            const auto& vm = session.view_model();
+            ASSERT_NO_FATAL_FAILURE(expect_valid_rows(vm));
+
+            // The patch turns the previous rows into the new ones; the rows
+            // outside it show the same text and highlights as before
+            ASSERT_EQ(previous.size() - patch.removed + patch.inserted, vm.lines.size());
+            const auto contents = row_contents(vm);
+            for (size_t row = 0; row < patch.begin; ++row) {
+                EXPECT_EQ(vm.lines[row], previous[row]) << "row " << row;
+                EXPECT_EQ(contents[row], previous_contents[row]) << "row " << row;
+            }
+            for (size_t row = patch.begin + patch.removed; row < previous.size(); ++row) {
+                const size_t now = row - patch.removed + patch.inserted;
+                EXPECT_EQ(vm.lines[now].left, shifted(previous[row].left, patch.old_line_shift)) << "row " << row;
+                EXPECT_EQ(vm.lines[now].right, shifted(previous[row].right, patch.new_line_shift)) << "row " << row;
+                EXPECT_EQ(contents[now], previous_contents[row]) << "row " << row;
+            }
+        }
+        // The script still covers every line
+        size_t old_count = 0, new_count = 0;
+        for (const auto& [op, length] : session.edit_runs()) {
+            old_count += op != DiffOp::Insert ? length : 0;
+            new_count += op != DiffOp::Delete ? length : 0;
+        }
+        EXPECT_EQ(old_count, session.view_model().old_lines.size());
+        EXPECT_EQ(new_count, session.view_model().new_lines.size());
+    }
+}
+
+TEST(DiffSession, ClearAndRefill) {
+    DiffSession session("a\nb\n", "a\nc\n");
+    session.apply({DiffSide::New, 0, 100, ""});
+    EXPECT_EQ(session.new_text(), "");
+    test::expect_same_rows(session.view_model(), create_view_model("a\nb\n", ""));
+    session.apply({DiffSide::New, 0, 0, "a\nb\n"});
+    EXPECT_TRUE(session.view_model().connectors.empty());
+    EXPECT_EQ(session.view_model().lines.size(), 3);
+}
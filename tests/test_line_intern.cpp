@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+#include "line_intern.h"
+
+using namespace diff_view;
+
+TEST(InternLines, BothEmpty) {
+    const auto interned = intern_lines(LineTable(), LineTable());
+    EXPECT_TRUE(interned.old_ids.empty());
+    EXPECT_TRUE(interned.new_ids.empty());
+    EXPECT_EQ(interned.class_count(), 0);
+}
+
+TEST(InternLines, DenseIdsInFirstAppearanceOrder) {
+    const auto interned = intern_lines(LineTable::from_lines({"a", "b", "a"}), LineTable::from_lines({"c", "b"}));
+    EXPECT_EQ(interned.old_ids, (std::vector<uint32_t>{0, 1, 0}));
+    EXPECT_EQ(interned.new_ids, (std::vector<uint32_t>{2, 1}));
+    EXPECT_EQ(interned.class_count(), 3);
+}
+
+TEST(InternLines, ClassCounts) {
+    const auto interned = intern_lines(LineTable::from_lines({"}", "x", "}", "}"}), LineTable::from_lines({"}", "y", ""}));
+    ASSERT_EQ(interned.class_count(), 4);
+    const uint32_t brace = interned.old_ids[0];
+    EXPECT_EQ(interned.old_counts[brace], 3);
+    EXPECT_EQ(interned.new_counts[brace], 1);
+    const uint32_t x = interned.old_ids[1];
+    EXPECT_EQ(interned.old_counts[x], 1);
+    EXPECT_EQ(interned.new_counts[x], 0);
+    const uint32_t y = interned.new_ids[1];
+    EXPECT_EQ(interned.old_counts[y], 0);
+    EXPECT_EQ(interned.new_counts[y], 1);
+}
+
+TEST(InternLines, EmptyLinesAreOneClass) {
+    const auto interned = intern_lines(LineTable::from_lines({"", ""}), LineTable::from_lines({""}));
+    EXPECT_EQ(interned.class_count(), 1);
+    EXPECT_EQ(interned.old_counts[0], 2);
+    EXPECT_EQ(interned.new_counts[0], 1);
+}
+
+TEST(InternLines, ManyDistinctLines) {
+    std::vector<std::string> old_lines, new_lines;
+    for (int i = 0; i < 1000; ++i) {
+        old_lines.push_back("line " + std::to_string(i));
+        new_lines.push_back("line " + std::to_string(999 - i));
+    }
+    const auto interned = intern_lines(LineTable::from_lines(old_lines), LineTable::from_lines(new_lines));
+    EXPECT_EQ(interned.class_count(), 1000);
+    for (size_t i = 0; i < 1000; ++i) {
+        EXPECT_EQ(interned.old_ids[i], i);
+        EXPECT_EQ(interned.new_ids[i], 999 - i);
+    }
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+#include "line_table.h"
+
+#include <random>
+
+using namespace diff_view;
+
+TEST(LineTable, Default) {
+    const LineTable table;
+    EXPECT_TRUE(table.empty());
+    EXPECT_EQ(table.size(), 0);
+    EXPECT_TRUE(table.text().empty());
+}
+
+TEST(LineTable, ViewDoesNotCopy) {
+    const std::string text = "line1\r\nline2\rline3\n";
+    const auto table = LineTable::view(text);
+    ASSERT_EQ(table.size(), 4);
+    EXPECT_EQ(table[0], "line1");
+    EXPECT_EQ(table[1], "line2");
+    EXPECT_EQ(table[2], "line3");
+    EXPECT_EQ(table[3], "");
+    EXPECT_EQ(table.text().data(), text.data());
+    EXPECT_EQ(table[1].data(), text.data() + 7);
+}
+
+TEST(LineTable, CopyOwnsBuffer) {
+    auto text = std::make_unique<std::string>("a\nb");
+    const auto table = LineTable::copy(*text);
+    text.reset();
+    ASSERT_EQ(table.size(), 2);
+    EXPECT_EQ(table[0], "a");
+    EXPECT_EQ(table[1], "b");
+}
+
+TEST(LineTable, CopiesShareStorage) {
+    const auto original = LineTable::copy("x\ny");
+    const auto copy = original;
+    EXPECT_EQ(copy.text().data(), original.text().data());
+    EXPECT_EQ(copy[1], "y");
+}
+
+TEST(LineTable, FromLines) {
+    const auto table = LineTable::from_lines({"a", "", "line\nwith break", "b"});
+    ASSERT_EQ(table.size(), 4);
+    EXPECT_EQ(table[0], "a");
+    EXPECT_EQ(table[1], "");
+    EXPECT_EQ(table[2], "line\nwith break");
+    EXPECT_EQ(table[3], "b");
+}
+
+TEST(LineTable, ToVector) {
+    const auto table = LineTable::view("a\nb\n");
+    EXPECT_EQ(table.to_vector(), (std::vector<std::string>{"a", "b", ""}));
+}
+
+TEST(LineTable, Spans) {
+    const auto table = LineTable::view("ab\r\ncd");
+    ASSERT_EQ(table.spans().size(), 2);
+    EXPECT_EQ(table.spans()[0].begin, 0);
+    EXPECT_EQ(table.spans()[0].end, 2);
+    EXPECT_EQ(table.spans()[1].begin, 4);
+    EXPECT_EQ(table.spans()[1].end, 6);
+}
+
+TEST(LineTable, ViewWithEndings) {
+    const std::string text = "a\r\nb\rc\n\nd";
+    const auto table = LineTable::view_with_endings(text);
+    EXPECT_EQ(table.to_vector(), (std::vector<std::string>{"a\r\n", "b\rc\n", "\n", "d"}));
+    EXPECT_EQ(table.text().data(), text.data());
+    EXPECT_EQ(table.hashes()[2], hash_line("\n"));
+    EXPECT_EQ(LineTable::view_with_endings("a\n").to_vector(), (std::vector<std::string>{"a\n"}));
+    EXPECT_TRUE(LineTable::view_with_endings("").empty());
+}
+
+TEST(LineTable, EditViewMatchesView) {
+    // Random edits, many around line endings, against a fresh index of the edited text
+    std::mt19937 rng(7);
+    const std::vector<std::string> pieces = {"", "a", "\n", "\r", "\r\n", "xy\nz", "\n\n", "line\r\n"};
+    std::string text = "one\ntwo\r\nthree\rfour\n";
+    auto table = LineTable::view(text);
+    for (int round = 0; round < 2000; ++round) {
+        const size_t begin = std::uniform_int_distribution<size_t>(0, text.size())(rng);
+        const size_t end = std::min(text.size(), begin + std::uniform_int_distribution<size_t>(0, 4)(rng));
+        const auto& inserted = pieces[std::uniform_int_distribution<size_t>(0, pieces.size() - 1)(rng)];
+        const size_t old_line_count = table.size();
+        text.replace(begin, end - begin, inserted);
+        const auto [first, removed, added] = table.edit_view(text, begin, end, inserted.size());
+        const auto expected = LineTable::view(text);
+        ASSERT_EQ(table.size(), expected.size()) << "round " << round;
+        ASSERT_EQ(old_line_count - removed + added, expected.size());
+        ASSERT_LE(first + added, expected.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            ASSERT_EQ(table.spans()[i].begin, expected.spans()[i].begin) << "round " << round;
+            ASSERT_EQ(table.spans()[i].end, expected.spans()[i].end) << "round " << round;
+            ASSERT_EQ(table.hashes()[i], expected.hashes()[i]);
+        }
+        if (text.size() > 200) {
+            text.erase(100);
+            table = LineTable::view(text);
+        }
+    }
+}
+
+TEST(LineTable, Slice) {
+    const std::string text = "a\nb\nc\nd";
+    const auto table = LineTable::view(text);
+    const auto slice = table.slice(1, 2);
+    EXPECT_EQ(slice.to_vector(), (std::vector<std::string>{"b", "c"}));
+    EXPECT_EQ(slice.hashes()[1], table.hashes()[2]);
+    EXPECT_EQ(slice.text().data(), text.data());
+}
+
+TEST(LineTable, ViewSpans) {
+    const std::string text = "ab\r\ncd";
+    const auto table = LineTable::view_spans(text, {{0, 4}, {2, 2}, {4, 6}});
+    EXPECT_EQ(table.to_vector(), (std::vector<std::string>{"ab\r\n", "", "cd"}));
+    EXPECT_EQ(table.hashes()[2], hash_line("cd"));
+    EXPECT_EQ(table.text().data(), text.data());
+}
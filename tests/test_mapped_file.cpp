@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include "mapped_file.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+using namespace diff_view;
+
+namespace {
+
+/**
+ * A file in the temporary directory, removed with the object.
+ */
+class TempFile {
+public:
+    TempFile(const std::string& name, const std::string& content)
+        : path_(std::filesystem::temp_directory_path() / name) {
+        std::ofstream(path_, std::ios::binary) << content;
+    }
+    ~TempFile() { std::filesystem::remove(path_); }
+
+    [[nodiscard]] std::string path() const { return path_.string(); }
+
+private:
+    std::filesystem::path path_;
+};
+
+} // namespace
+
+TEST(MappedFile, MapsRegularFile) {
+    const TempFile temp("diff_view_mapped_file.txt", "line 1\r\nline 2\n");
+    auto file = MappedFile::open(temp.path());
+    ASSERT_TRUE(file.has_value());
+    EXPECT_EQ(file->text(), "line 1\r\nline 2\n");
+#if defined(__unix__) || defined(__APPLE__)
+    EXPECT_TRUE(file->mapped());
+#endif
+    // The view survives moves
+    const auto text = file->text();
+    MappedFile moved = std::move(*file);
+    EXPECT_EQ(moved.text(), text);
+    EXPECT_EQ(moved.text().data(), text.data());
+}
+
+TEST(MappedFile, EmptyFile) {
+    const TempFile temp("diff_view_mapped_file_empty.txt", "");
+    const auto file = MappedFile::open(temp.path());
+    ASSERT_TRUE(file.has_value());
+    EXPECT_TRUE(file->text().empty());
+    EXPECT_FALSE(file->mapped());
+}
+
+TEST(MappedFile, MissingFile) {
+    std::string error;
+    const auto file = MappedFile::open("/nonexistent/diff_view_missing.txt", &error);
+    EXPECT_FALSE(file.has_value());
+    EXPECT_NE(error.find("/nonexistent/diff_view_missing.txt"), std::string::npos);
+}
+
+#if defined(__linux__)
+TEST(MappedFile, ReadsPipe) {
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    const std::string content = "from\na pipe\n";
+    ASSERT_EQ(write(fds[1], content.data(), content.size()), static_cast<ssize_t>(content.size()));
+    close(fds[1]);
+    auto file = MappedFile::open("/dev/fd/" + std::to_string(fds[0]));
+    close(fds[0]);
+    ASSERT_TRUE(file.has_value());
+    EXPECT_FALSE(file->mapped());
+    EXPECT_EQ(file->text(), content);
+    // A moved buffer is viewed at its new place
+    MappedFile moved = std::move(*file);
+    EXPECT_EQ(moved.text(), content);
+}
+#endif
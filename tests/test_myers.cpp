@@ -0,0 +1,247 @@
+#include <gtest/gtest.h>
+#include "myers.h"
+#include "thread_pool.h"
+
+#include <cctype>
+#include <chrono>
+#include <random>
+#include <string_view>
+
+using namespace diff_view;
+
+namespace {
+
+std::string ops_to_string(const std::vector<DiffOp>& script) {
+    std::string result;
+    for (const auto op : script) {
+        switch (op) {
+            case DiffOp::Equal: result += '='; break;
+            case DiffOp::Delete: result += '-'; break;
+            case DiffOp::Insert: result += '+'; break;
+        }
+    }
+    return result;
+}
+
+/**
+ * Count what the script consumes from each side and how many tokens it keeps.
+ */
+struct ScriptCounts {
+    size_t old_count = 0;
+    size_t new_count = 0;
+    size_t equal_count = 0;
+};
+
+ScriptCounts count_ops(const std::vector<DiffOp>& script) {
+    ScriptCounts counts;
+    for (const auto op : script) {
+        if (op != DiffOp::Insert) ++counts.old_count;
+        if (op != DiffOp::Delete) ++counts.new_count;
+        if (op == DiffOp::Equal) ++counts.equal_count;
+    }
+    return counts;
+}
+
+bool is_valid_script(const std::vector<uint32_t>& old_ids, const std::vector<uint32_t>& new_ids,
+                     const std::vector<DiffOp>& script) {
+    size_t i = 0, j = 0;
+    for (const auto op : script) {
+        if (op == DiffOp::Equal && (i >= old_ids.size() || j >= new_ids.size() || old_ids[i] != new_ids[j])) {
+            return false;
+        }
+        if (op != DiffOp::Insert) ++i;
+        if (op != DiffOp::Delete) ++j;
+    }
+    return i == old_ids.size() && j == new_ids.size();
+}
+
+std::vector<uint32_t> random_ids(std::mt19937& rng, const size_t count, const uint32_t alphabet) {
+    std::vector<uint32_t> ids(count);
+    for (auto& id : ids) {
+        id = rng() % alphabet;
+    }
+    return ids;
+}
+
+} // namespace
+
+TEST(Myers, BothEmpty) {
+    EXPECT_TRUE(myers_diff(std::vector<uint32_t>{}, std::vector<uint32_t>{}).empty());
+}
+
+TEST(Myers, IntegerIds) {
+    const std::vector<uint32_t> old_ids = {1, 2, 3, 4};
+    const std::vector<uint32_t> new_ids = {1, 3, 4, 5};
+    EXPECT_EQ(ops_to_string(myers_diff(old_ids, new_ids)), "=-==+");
+}
+
+TEST(Myers, EditRuns) {
+    const auto runs = myers_edit_runs(std::string_view("abcdef"), std::string_view("abXYef"));
+    const std::vector<EditRun> expected = {
+        {DiffOp::Equal, 2}, {DiffOp::Delete, 2}, {DiffOp::Insert, 2}, {DiffOp::Equal, 2}};
+    EXPECT_EQ(runs, expected);
+    EXPECT_EQ(expand_runs(runs), myers_diff(std::string_view("abcdef"), std::string_view("abXYef")));
+}
+
+TEST(Myers, RawBytes) {
+    EXPECT_EQ(ops_to_string(myers_diff(std::string_view("abc"), std::string_view("axc"))), "=-+=");
+    EXPECT_EQ(ops_to_string(myers_diff(std::string_view(""), std::string_view("ab"))), "++");
+    EXPECT_EQ(ops_to_string(myers_diff(std::string_view("ab"), std::string_view(""))), "--");
+}
+
+TEST(Myers, Words) {
+    const std::vector<std::string_view> old_words = {"the", "quick", "brown", "fox"};
+    const std::vector<std::string_view> new_words = {"the", "slow", "brown", "fox", "jumps"};
+    EXPECT_EQ(ops_to_string(myers_diff(old_words, new_words)), "=-+==+");
+}
+
+TEST(Myers, CustomPolicy) {
+    const auto case_insensitive = [](const char a, const char b) {
+        return std::tolower(static_cast<unsigned char>(a)) == std::tolower(static_cast<unsigned char>(b));
+    };
+    EXPECT_EQ(ops_to_string(myers_diff(std::string_view("Hello"), std::string_view("hELLo"), case_insensitive)), "=====");
+}
+
+TEST(Myers, LineTableTokens) {
+    const auto old_lines = LineTable::view("a\nb\nc");
+    const auto new_lines = LineTable::view("a\nc\nd");
+    EXPECT_EQ(ops_to_string(myers_diff(old_lines, new_lines)), "=-=+");
+}
+
+TEST(Myers, ScriptConsumesBothSequences) {
+    const std::string_view old_str = "abcabba";
+    const std::string_view new_str = "cbabac";
+    const auto [old_count, new_count, equal_count] = count_ops(myers_diff(old_str, new_str));
+    EXPECT_EQ(old_count, old_str.size());
+    EXPECT_EQ(new_count, new_str.size());
+    EXPECT_EQ(equal_count, 4); // LCS length, so the script is minimal (D = 5)
+}
+
+TEST(Myers, CostBudgetNotHit) {
+    const std::vector<uint32_t> old_ids = {1, 2, 3, 4, 5, 6};
+    const std::vector<uint32_t> new_ids = {1, 3, 4, 7, 5, 6};
+    MyersOptions options;
+    options.max_cost = 100;
+    bool approximate = true;
+    EXPECT_EQ(myers_diff(old_ids, new_ids, std::equal_to<>{}, options, &approximate), myers_diff(old_ids, new_ids));
+    EXPECT_FALSE(approximate);
+}
+
+TEST(Myers, CostBudgetKeepsScriptValid) {
+    std::mt19937 rng(11);
+    for (const int max_cost : {1, 4, 32}) {
+        const auto old_ids = random_ids(rng, 3000, 8);
+        const auto new_ids = random_ids(rng, 2500, 8);
+        MyersOptions options;
+        options.max_cost = max_cost;
+        bool approximate = false;
+        const auto script = myers_diff(old_ids, new_ids, std::equal_to<>{}, options, &approximate);
+        EXPECT_TRUE(approximate);
+        EXPECT_TRUE(is_valid_script(old_ids, new_ids, script));
+        EXPECT_LE(count_ops(script).equal_count, count_ops(myers_diff(old_ids, new_ids)).equal_count);
+    }
+}
+
+TEST(Myers, CostBudgetWorkIsLinear) {
+    // Unrelated sequences: every search hits the budget and peels about
+    // max_cost elements off the front of what is left
+    std::mt19937 rng(17);
+    constexpr int MAX_COST = 64;
+    for (const size_t count : {20000, 80000}) {
+        const auto old_ids = random_ids(rng, count, 1u << 30);
+        const auto new_ids = random_ids(rng, count, 1u << 30);
+        MyersScratch scratch;
+        MyersOptions options;
+        options.max_cost = MAX_COST;
+        options.scratch = &scratch;
+        size_t compares = 0;
+        bool approximate = false;
+        const auto script = myers_diff(old_ids, new_ids, [&compares](const uint32_t a, const uint32_t b) {
+            ++compares;
+            return a == b;
+        }, options, &approximate);
+        EXPECT_TRUE(approximate);
+        EXPECT_TRUE(is_valid_script(old_ids, new_ids, script));
+        // Buffers sized by the budget, not by the region
+        EXPECT_LE(scratch.frontier.size(), 2 * size_t{MAX_COST} + 3);
+        EXPECT_LE(scratch.trace.size(), size_t{MAX_COST + 2} * (MAX_COST + 2));
+        EXPECT_LE(compares, 2 * count * MAX_COST) << count;
+    }
+}
+
+TEST(Myers, DistanceBound) {
+    std::mt19937 rng(13);
+    // Small problems take the greedy search, the last one is split at middle snakes
+    for (const size_t count : {20, 300, 5000}) {
+        const auto old_ids = random_ids(rng, count, 16);
+        const auto new_ids = random_ids(rng, count + count / 10, 16);
+        const auto exact = myers_edit_runs(old_ids, new_ids);
+        const auto [old_count, new_count, equal_count] = count_ops(expand_runs(exact));
+        const auto distance = static_cast<int>(old_count + new_count - 2 * equal_count);
+        MyersOptions options;
+        options.max_distance = distance;
+        EXPECT_EQ(myers_edit_runs(old_ids, new_ids, std::equal_to<>{}, options), exact);
+        options.max_distance = distance - 1;
+        EXPECT_TRUE(myers_edit_runs(old_ids, new_ids, std::equal_to<>{}, options).empty());
+    }
+}
+
+TEST(Myers, ExpiredDeadline) {
+    std::mt19937 rng(5);
+    const auto old_ids = random_ids(rng, 5000, 1000);
+    const auto new_ids = random_ids(rng, 5000, 1000);
+    MyersOptions options;
+    options.deadline = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    bool approximate = false;
+    const auto script = myers_diff(old_ids, new_ids, std::equal_to<>{}, options, &approximate);
+    EXPECT_TRUE(approximate);
+    EXPECT_TRUE(is_valid_script(old_ids, new_ids, script));
+}
+
+TEST(Myers, ParallelMinimal) {
+    std::mt19937 rng(19);
+    const auto old_ids = random_ids(rng, 2000, 16);
+    const auto new_ids = random_ids(rng, 2200, 16);
+    const auto serial_equal = count_ops(myers_diff(old_ids, new_ids)).equal_count;
+    for (const size_t threshold : {64, 1000}) {
+        std::vector<std::vector<DiffOp>> scripts;
+        // One thread splits serially, more split with paired forward and backward passes
+        for (const size_t threads : {1, 2, 4, 8}) {
+            ThreadPool pool(threads);
+            MyersOptions options;
+            options.pool = &pool;
+            options.parallel_threshold = threshold;
+            bool approximate = true;
+            scripts.push_back(myers_diff(old_ids, new_ids, std::equal_to<>{}, options, &approximate));
+            EXPECT_FALSE(approximate);
+            EXPECT_TRUE(is_valid_script(old_ids, new_ids, scripts.back()));
+            EXPECT_EQ(count_ops(scripts.back()).equal_count, serial_equal);
+            EXPECT_EQ(scripts.back(), scripts.front()) << threshold << " " << threads;
+        }
+    }
+}
+
+TEST(Myers, ParallelBelowThreshold) {
+    std::mt19937 rng(23);
+    const auto old_ids = random_ids(rng, 500, 8);
+    const auto new_ids = random_ids(rng, 400, 8);
+    ThreadPool pool(4);
+    MyersOptions options;
+    options.pool = &pool;
+    EXPECT_EQ(myers_diff(old_ids, new_ids, std::equal_to<>{}, options), myers_diff(old_ids, new_ids));
+}
+
+TEST(Myers, ParallelExpiredDeadline) {
+    std::mt19937 rng(29);
+    const auto old_ids = random_ids(rng, 5000, 1000);
+    const auto new_ids = random_ids(rng, 5000, 1000);
+    ThreadPool pool(4);
+    MyersOptions options;
+    options.pool = &pool;
+    options.parallel_threshold = 256;
+    options.deadline = std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    bool approximate = false;
+    const auto script = myers_diff(old_ids, new_ids, std::equal_to<>{}, options, &approximate);
+    EXPECT_TRUE(approximate);
+    EXPECT_TRUE(is_valid_script(old_ids, new_ids, script));
+}
@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include "packed_view_model.h"
+
+#include <string>
+
+using namespace diff_view;
+
+TEST(PackedViewModel, Empty) {
+    const auto packed = pack_view_model(create_view_model("", ""));
+    EXPECT_EQ(packed.row_count(), 0);
+    EXPECT_TRUE(packed.highlights.empty());
+    EXPECT_TRUE(packed.connectors.empty());
+    EXPECT_TRUE(packed.text.empty());
+    EXPECT_EQ(packed.line_offsets, std::vector<uint32_t>{0});
+}
+
+TEST(PackedViewModel, MatchesViewModel) {
+    std::string old_text, new_text;
+    for (size_t i = 0; i < 200; ++i) {
+        old_text += "value" + std::to_string(i) + " = \xe4\xbd\xa0\xe5\xa5\xbd(" + std::to_string(i % 7) + ");\n";
+        if (i % 13 == 0) {
+            new_text += "value" + std::to_string(i) + " = \xe4\xbd\xa0\xe5\xa5\xbd(" + std::to_string(i % 5) + ", 1);\n";
+        } else if (i % 29 != 0) {
+            new_text += "value" + std::to_string(i) + " = \xe4\xbd\xa0\xe5\xa5\xbd(" + std::to_string(i % 7) + ");\r\n";
+        }
+    }
+    ViewOptions options;
+    options.diff.context_lines = 1;
+    options.fold_unchanged = true;
+    const auto vm = create_view_model(old_text, new_text, options);
+    const auto packed = pack_view_model(vm);
+    ASSERT_GT(vm.highlights.size(), 0);
+    ASSERT_GT(vm.folds.size(), 0);
+
+    ASSERT_EQ(packed.row_count(), vm.lines.size());
+    for (size_t i = 0; i < vm.lines.size(); ++i) {
+        const auto* row = &packed.rows[i * PACKED_ROW_STRIDE];
+        EXPECT_EQ(row[0], static_cast<uint32_t>(vm.lines[i].left.kind));
+        EXPECT_EQ(row[1], vm.lines[i].left.line_no);
+        EXPECT_EQ(row[2], static_cast<uint32_t>(vm.lines[i].right.kind));
+        EXPECT_EQ(row[3], vm.lines[i].right.line_no);
+    }
+    ASSERT_EQ(packed.highlights.size(), vm.highlights.size() * PACKED_HIGHLIGHT_STRIDE);
+    for (size_t i = 0; i < vm.highlights.size(); ++i) {
+        const auto* highlight = &packed.highlights[i * PACKED_HIGHLIGHT_STRIDE];
+        EXPECT_EQ(highlight[0], vm.highlights[i].row);
+        EXPECT_EQ(highlight[1], vm.highlights[i].start);
+        EXPECT_EQ(highlight[2], vm.highlights[i].end);
+        EXPECT_EQ(highlight[3], vm.highlights[i].is_left ? 1u : 0u);
+    }
+    ASSERT_EQ(packed.connectors.size(), vm.connectors.size() * PACKED_CONNECTOR_STRIDE);
+    for (size_t i = 0; i < vm.connectors.size(); ++i) {
+        const auto* connector = &packed.connectors[i * PACKED_CONNECTOR_STRIDE];
+        EXPECT_EQ(connector[0], vm.connectors[i].top);
+        EXPECT_EQ(connector[1], vm.connectors[i].bottom);
+        EXPECT_EQ(connector[2], vm.connectors[i].left_start);
+        EXPECT_EQ(connector[3], vm.connectors[i].left_end);
+        EXPECT_EQ(connector[4], vm.connectors[i].right_start);
+        EXPECT_EQ(connector[5], vm.connectors[i].right_end);
+    }
+    ASSERT_EQ(packed.folds.size(), vm.folds.size() * PACKED_FOLD_STRIDE);
+    for (size_t i = 0; i < vm.folds.size(); ++i) {
+        EXPECT_EQ(packed.folds[i * PACKED_FOLD_STRIDE], vm.folds[i].row);
+        EXPECT_EQ(packed.folds[i * PACKED_FOLD_STRIDE + 1], vm.folds[i].count);
+    }
+
+    ASSERT_EQ(packed.old_line_count, vm.old_lines.size());
+    ASSERT_EQ(packed.new_line_count, vm.new_lines.size());
+    ASSERT_EQ(packed.line_offsets.size(), vm.old_lines.size() + vm.new_lines.size() + 1);
+    EXPECT_EQ(packed.line_offsets.back(), packed.text.size());
+    for (size_t i = 0; i < vm.old_lines.size(); ++i) {
+        EXPECT_EQ(packed.line(true, i), vm.old_lines[i]);
+    }
+    for (size_t i = 0; i < vm.new_lines.size(); ++i) {
+        EXPECT_EQ(packed.line(false, i), vm.new_lines[i]);
+    }
+    EXPECT_FALSE(packed.approximate);
+    EXPECT_FALSE(packed.cancelled);
+}
+
+TEST(PackedViewModel, Flags) {
+    ViewModel vm;
+    vm.approximate = true;
+    vm.cancelled = true;
+    const auto packed = pack_view_model(vm);
+    EXPECT_TRUE(packed.approximate);
+    EXPECT_TRUE(packed.cancelled);
+}
@@ -0,0 +1,252 @@
+#include <gtest/gtest.h>
+#include "mapped_file.h"
+#include "serialization.h"
+#include "test_utils.h"
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace diff_view;
+
+namespace {
+
+std::string source_text(const size_t line_count, const size_t changed_every) {
+    std::string text;
+    for (size_t i = 0; i < line_count; ++i) {
+        text += "value" + std::to_string(i) + " = compute(" +
+                std::to_string(changed_every > 0 && i % changed_every == 0 ? i % 5 : i % 7) + ");\n";
+    }
+    return text;
+}
+
+} // namespace
+
+TEST(Serialization, DiffRoundTrip) {
+    std::mt19937 rng(47);
+    for (const size_t line_count : {0, 1, 50, 400}) {
+        const auto old_text = test::random_text(rng, line_count, 30, 5);
+        const auto new_text = test::random_text(rng, line_count + line_count / 4, 30, 5);
+        for (const auto algorithm : {DiffAlgorithm::Myers, DiffAlgorithm::Patience, DiffAlgorithm::Histogram}) {
+            DiffOptions options;
+            options.algorithm = algorithm;
+            options.context_lines = rng() % 4;
+            const auto result = diff_lines(old_text, new_text, options);
+
+            const auto data = serialize(result);
+            const auto read = deserialize_diff(data);
+            ASSERT_TRUE(read.has_value());
+            test::expect_same_diff(*read, result);
+
+            const auto compact = serialize(result, false);
+            EXPECT_LT(compact.size(), data.size() - old_text.size() - new_text.size() + 1);
+            EXPECT_FALSE(deserialize_diff(compact).has_value());
+            const auto reread = deserialize_diff(compact, LineTable::view(old_text), LineTable::view(new_text));
+            ASSERT_TRUE(reread.has_value());
+            test::expect_same_diff(*reread, result);
+        }
+    }
+}
+
+TEST(Serialization, ViewModelRoundTrip) {
+    const auto old_text = source_text(2000, 0);
+    const auto new_text = source_text(2000, 13);
+    for (const bool fold : {false, true}) {
+        ViewOptions options;
+        options.fold_unchanged = fold;
+        const auto vm = create_view_model(old_text, new_text, options);
+        ASSERT_FALSE(vm.highlights.empty());
+
+        const auto data = serialize(vm);
+        const auto read = deserialize_view_model(data);
+        ASSERT_TRUE(read.has_value());
+        test::expect_same_view_model(*read, vm);
+
+        const auto compact = serialize(vm, false);
+        const auto reread = deserialize_view_model(compact, LineTable::copy(old_text), LineTable::copy(new_text));
+        ASSERT_TRUE(reread.has_value());
+        test::expect_same_view_model(*reread, vm);
+        // Row runs and small differences: a fraction of the 16 bytes per row,
+        // highlight and connector of the packed arrays
+        EXPECT_LT(compact.size() * 4, (vm.lines.size() + vm.highlights.size() + vm.connectors.size()) * 16);
+    }
+}
+
+TEST(Serialization, UnusualModelsRoundTrip) {
+    ViewModel vm;
+    vm.old_lines = LineTable::copy("a\nb");
+    vm.new_lines = LineTable::copy("c");
+    vm.lines = {
+        {{LineKind::Blank, 0}, {LineKind::Blank, 0}},
+        {{LineKind::Removed, 2}, {LineKind::Added, 1}},
+        {{LineKind::Removed, 1}, {LineKind::Blank, 0}},
+        {{LineKind::Folded, 1}, {LineKind::Folded, 1}},
+    };
+    // Rows, highlights and connectors that go backwards, empty highlights
+    vm.highlights = {{2, 0, 1, true}, {1, 1, 1, false}};
+    vm.connectors = {{1, 2, 2, 2, 0, 0}, {0, 1, 1, 2, 1, 1}};
+    vm.folds = {{3, 1}};
+    vm.approximate = true;
+    const auto data = serialize(vm);
+    const auto read = deserialize_view_model(data);
+    ASSERT_TRUE(read.has_value());
+    test::expect_same_view_model(*read, vm);
+}
+
+TEST(Serialization, ListedLineSpans) {
+    // Tables that LineTable::view would split differently keep their spans
+    DiffResult result;
+    result.old_lines = LineTable::from_lines({"a\r", "", "b\nc"});
+    result.new_lines = LineTable::view_with_endings("a\r\n\nb\nc");
+    result.hunks = diff_lines(result.old_lines, result.new_lines).hunks;
+    const auto data = serialize(result);
+    const auto read = deserialize_diff(data);
+    ASSERT_TRUE(read.has_value());
+    test::expect_same_diff(*read, result);
+}
+
+TEST(Serialization, ReadsInPlace) {
+    const auto old_text = source_text(500, 0);
+    const auto new_text = source_text(500, 7);
+    const auto vm = create_view_model(old_text, new_text);
+    const auto path = std::filesystem::temp_directory_path() / "diff_view_serialized.bin";
+    {
+        const auto data = serialize(vm);
+        std::ofstream(path, std::ios::binary).write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+    {
+        const auto file = MappedFile::open(path.string());
+        ASSERT_TRUE(file.has_value());
+        const auto read = deserialize_view_model(file->text());
+        ASSERT_TRUE(read.has_value());
+        test::expect_same_view_model(*read, vm);
+        // The lines point into the file's bytes
+        const auto bytes = file->text();
+        EXPECT_GE(read->old_lines.text().data(), bytes.data());
+        EXPECT_LE(read->new_lines.text().data() + read->new_lines.text().size(), bytes.data() + bytes.size());
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(Serialization, RejectsDamagedData) {
+    std::mt19937 rng(53);
+    const auto old_text = source_text(60, 0);
+    const auto new_text = source_text(60, 7);
+    ViewOptions options;
+    options.fold_unchanged = true;
+    options.diff.context_lines = 1;
+    const auto vm = create_view_model(old_text, new_text, options);
+    const auto result = diff_lines(old_text, new_text, options.diff);
+    for (const auto& data : {serialize(vm), serialize(result), serialize(vm, false), serialize(result, false)}) {
+        const bool is_view = data == serialize(vm) || data == serialize(vm, false);
+        const bool has_text = data.size() > old_text.size();
+        const auto read = [&](const std::string_view bytes) {
+            if (is_view) {
+                return has_text ? deserialize_view_model(bytes).has_value()
+                                : deserialize_view_model(bytes, LineTable::view(old_text), LineTable::view(new_text)).has_value();
+            }
+            return has_text ? deserialize_diff(bytes).has_value()
+                            : deserialize_diff(bytes, LineTable::view(old_text), LineTable::view(new_text)).has_value();
+        };
+        ASSERT_TRUE(read(data));
+        for (size_t size = 0; size < data.size(); ++size) {
+            EXPECT_FALSE(read(std::string_view(data).substr(0, size))) << size;
+        }
+        EXPECT_FALSE(read(data + '\0'));
+        // Flipped bytes must be rejected or decode to something, never crash
+        for (int i = 0; i < 2000; ++i) {
+            auto damaged = data;
+            damaged[rng() % damaged.size()] ^= static_cast<char>(1 + rng() % 255);
+            (void)read(damaged);
+        }
+    }
+    auto other_version = serialize(vm);
+    other_version[4] = static_cast<char>(SERIALIZATION_VERSION + 1);
+    EXPECT_FALSE(deserialize_view_model(other_version).has_value());
+    EXPECT_FALSE(deserialize_diff(serialize(vm)).has_value());
+    EXPECT_FALSE(deserialize_view_model(serialize(vm, false), LineTable::view(old_text), LineTable::view(new_text + "extra\n")).has_value());
+
+    // Encodings that decode but describe a model that does not fit its rows
+    // or tables
+    ASSERT_GE(vm.folds.size(), 2u);
+    ASSERT_FALSE(vm.highlights.empty());
+    ASSERT_FALSE(vm.connectors.empty());
+    const auto rows = static_cast<uint32_t>(vm.lines.size());
+    const auto rejects = [&](const std::function<void(ViewModel&)>& damage) {
+        auto damaged = vm;
+        damage(damaged);
+        const auto data = serialize(damaged);
+        return !deserialize_view_model(data).has_value() &&
+               !deserialize_view_model(serialize(damaged, false), LineTable::view(old_text), LineTable::view(new_text)).has_value();
+    };
+    EXPECT_TRUE(rejects([](ViewModel& m) { m.folds[0].count = 0; }));
+    EXPECT_TRUE(rejects([](ViewModel& m) { m.folds[0].count = static_cast<uint32_t>(m.old_lines.size()) + 1; }));
+    EXPECT_TRUE(rejects([](ViewModel& m) { std::swap(m.folds[0], m.folds[1]); }));
+    EXPECT_TRUE(rejects([](ViewModel& m) { m.folds[1].row = m.folds[0].row; }));
+    EXPECT_TRUE(rejects([](ViewModel& m) { m.lines[m.folds[0].row].left.line_no = 0; }));
+    EXPECT_TRUE(rejects([&](ViewModel& m) { m.highlights[0].row = rows; }));
+    EXPECT_TRUE(rejects([](ViewModel& m) { m.highlights[0].start = m.highlights[0].end + 1; }));
+    EXPECT_TRUE(rejects([](ViewModel& m) { m.highlights[0].end = 1000; }));
+    EXPECT_TRUE(rejects([](ViewModel& m) { m.connectors[0].top = m.connectors[0].bottom + 1; }));
+    EXPECT_TRUE(rejects([&](ViewModel& m) { m.connectors[0].bottom = rows; }));
+    EXPECT_TRUE(rejects([](ViewModel& m) { m.connectors[0].left_end = static_cast<uint32_t>(m.old_lines.size()) + 1; }));
+    EXPECT_TRUE(rejects([](ViewModel& m) { m.connectors[0].right_start = 0; }));
+    EXPECT_TRUE(rejects([](ViewModel& m) { m.connectors[0].right_start = static_cast<uint32_t>(m.new_lines.size()) + 1; }));
+    EXPECT_FALSE(rejects([](ViewModel&) {}));
+
+    // Hunks that go backwards, overlap or leave different unchanged lines
+    // on the two sides
+    ASSERT_GE(result.hunks.size(), 2u);
+    const auto rejects_diff = [&](const std::function<void(DiffResult&)>& damage) {
+        auto damaged = result;
+        damage(damaged);
+        return !deserialize_diff(serialize(damaged)).has_value() &&
+               !deserialize_diff(serialize(damaged, false), LineTable::view(old_text), LineTable::view(new_text)).has_value();
+    };
+    EXPECT_TRUE(rejects_diff([](DiffResult& r) { std::swap(r.hunks[0], r.hunks[1]); }));
+    EXPECT_TRUE(rejects_diff([](DiffResult& r) { r.hunks[1].old_start = r.hunks[0].old_start; }));
+    EXPECT_TRUE(rejects_diff([](DiffResult& r) {
+        r.hunks[0].runs.push_back({DiffOp::Insert, 1});
+        ++r.hunks[0].new_count;
+    }));
+    EXPECT_FALSE(rejects_diff([](DiffResult&) {}));
+}
+
+TEST(Serialization, RandomViewModelsRoundTrip) {
+    // Similar and dissimilar lines mixed, so that hunks pair some of their
+    // lines and not others, and connectors may end before they start
+    std::mt19937 rng(59);
+    const std::vector<std::string> lines = {"int value = 1;", "int value = 2;", "return value;", "}", "",
+                                            "for (auto& item : items) {", "unrelated text here"};
+    const auto random_lines = [&](const size_t count) {
+        std::string text;
+        for (size_t i = 0; i < count; ++i) {
+            text += lines[rng() % lines.size()] + "\n";
+        }
+        return text;
+    };
+    size_t reversed = 0;
+    for (int round = 0; round < 500; ++round) {
+        const auto old_text = random_lines(rng() % 40);
+        const auto new_text = random_lines(rng() % 40);
+        ViewOptions options;
+        options.diff.context_lines = rng() % 4;
+        options.fold_unchanged = rng() % 2 == 0;
+        const auto vm = create_view_model(old_text, new_text, options);
+        for (const auto& connector : vm.connectors) {
+            reversed += connector.left_end < connector.left_start || connector.right_end < connector.right_start;
+        }
+        const auto data = serialize(vm);
+        const auto read = deserialize_view_model(data);
+        ASSERT_TRUE(read.has_value()) << "round " << round;
+        test::expect_same_view_model(*read, vm);
+        const auto compact = serialize(vm, false);
+        const auto reread = deserialize_view_model(compact, LineTable::copy(old_text), LineTable::copy(new_text));
+        ASSERT_TRUE(reread.has_value()) << "round " << round;
+        test::expect_same_view_model(*reread, vm);
+    }
+    EXPECT_GT(reversed, 0);
+}
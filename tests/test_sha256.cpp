@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+#include "sha256.h"
+
+#include <string>
+
+using namespace diff_view;
+
+TEST(Sha256, KnownDigests) {
+    EXPECT_EQ(to_hex(sha256("")), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    EXPECT_EQ(to_hex(sha256("abc")), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    EXPECT_EQ(to_hex(sha256("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq")),
+              "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    EXPECT_EQ(to_hex(sha256(std::string(1000000, 'a'))),
+              "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST(Sha256, PaddingBoundaries) {
+    // The padding fits in the last block up to 55 bytes, then needs another one
+    EXPECT_EQ(to_hex(sha256(std::string(55, 'x'))), "d5e285683cd4efc02d021a5c62014694958901005d6f71e89e0989fac77e4072");
+    EXPECT_EQ(to_hex(sha256(std::string(56, 'x'))), "04c26261370ee7541549d16dee320c723e3fd14671e66a099afe0a377c16888e");
+    EXPECT_EQ(to_hex(sha256(std::string(63, 'x'))), "75220b47218278e656f2013bb8f0c455a25eaf01e86c64924e9d48d89776d6f2");
+    EXPECT_EQ(to_hex(sha256(std::string(64, 'x'))), "7ce100971f64e7001e8fe5a51973ecdfe1ced42befe7ee8d5fd6219506b5393c");
+    EXPECT_EQ(to_hex(sha256(std::string(119, 'x'))), "000b48d4edf0fa7bee3c6236ecd2785baa5db4eeb8bb54341b029e0d9fa5fb0c");
+}
+
+TEST(Sha256, IncrementalUpdates) {
+    std::string data;
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        for (int byte = 0; byte < 256; ++byte) {
+            data += static_cast<char>(byte);
+        }
+    }
+    for (const size_t piece : {1, 7, 63, 64, 65, 300}) {
+        Sha256 hash;
+        for (size_t i = 0; i < data.size(); i += piece) {
+            hash.update(std::string_view(data).substr(i, piece));
+        }
+        EXPECT_EQ(to_hex(hash.finish()), "f3a25aa93aa2fbba28d79260535bbd6a5eb0fc1c24a8b0f04e12b484c1dfe363");
+    }
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include "string_utils.h"
 
+#include <random>
+
 using namespace diff_view;
 
 TEST(SplitLines, EmptyString) {
@@ -88,6 +90,86 @@ TEST(SplitLines, UTF8Content) {
     EXPECT_EQ(lines[2], "🎉");
 }
 
+TEST(FindLines, MatchesSplitLines) {
+    const std::string_view text = "unix\nwindows\r\nmac\rend\n";
+    const auto spans = find_lines(text);
+    const auto lines = split_lines(text);
+    ASSERT_EQ(spans.size(), lines.size());
+    for (size_t i = 0; i < spans.size(); ++i) {
+        EXPECT_EQ(text.substr(spans[i].begin, spans[i].end - spans[i].begin), lines[i]);
+    }
+}
+
+TEST(FindLines, EmptyString) {
+    EXPECT_TRUE(find_lines("").empty());
+}
+
+TEST(IndexLines, AllLevelsMatchSplitLines) {
+    std::mt19937 rng(7);
+    constexpr char alphabet[] = {'a', 'b', '\r', '\n', ' '};
+    for (size_t length : {0, 1, 15, 16, 17, 63, 64, 65, 127, 128, 129, 1000}) {
+        for (int round = 0; round < 20; ++round) {
+            std::string text;
+            for (size_t i = 0; i < length; ++i) {
+                text += alphabet[rng() % sizeof(alphabet)];
+            }
+            const auto lines = split_lines(text);
+            for (const auto level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::Best}) {
+                std::vector<LineSpan> spans;
+                std::vector<uint64_t> hashes;
+                index_lines(text, spans, hashes, level);
+                ASSERT_EQ(spans.size(), lines.size());
+                ASSERT_EQ(hashes.size(), lines.size());
+                for (size_t i = 0; i < spans.size(); ++i) {
+                    const auto line = std::string_view(text).substr(spans[i].begin, spans[i].end - spans[i].begin);
+                    EXPECT_EQ(line, lines[i]);
+                    EXPECT_EQ(hashes[i], hash_line(lines[i]));
+                }
+            }
+        }
+    }
+}
+
+TEST(IndexLines, CRLFAcrossBlockBoundary) {
+    for (size_t position : {15, 31, 63, 127}) {
+        std::string text(position, 'x');
+        text += "\r\nyy\r";
+        for (const auto level : {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2}) {
+            std::vector<LineSpan> spans;
+            std::vector<uint64_t> hashes;
+            index_lines(text, spans, hashes, level);
+            ASSERT_EQ(spans.size(), 3);
+            EXPECT_EQ(spans[0].end, position);
+            EXPECT_EQ(spans[1].begin, position + 2);
+            EXPECT_EQ(spans[1].end, position + 4);
+            EXPECT_EQ(spans[2].begin, text.size());
+            EXPECT_EQ(spans[2].end, text.size());
+        }
+    }
+}
+
+TEST(IndexLines, AppendsToOutputs) {
+    std::vector<LineSpan> spans;
+    std::vector<uint64_t> hashes;
+    index_lines("a\nb", spans, hashes);
+    index_lines("c", spans, hashes);
+    ASSERT_EQ(spans.size(), 3);
+    EXPECT_EQ(hashes[2], hash_line("c"));
+}
+
+TEST(HashLine, Deterministic) {
+    EXPECT_EQ(hash_line("hello world"), hash_line("hello world"));
+    EXPECT_EQ(hash_line(""), hash_line(""));
+}
+
+TEST(HashLine, DifferentStrings) {
+    EXPECT_NE(hash_line("hello"), hash_line("world"));
+    EXPECT_NE(hash_line("abc"), hash_line("abd"));
+    EXPECT_NE(hash_line(""), hash_line(std::string_view("\0", 1)));
+    EXPECT_NE(hash_line("12345678"), hash_line("123456789"));
+    EXPECT_NE(hash_line("abcdefgh12345678"), hash_line("12345678abcdefgh"));
+}
+
 TEST(HashString, EmptyString) {
     const auto h = hash_string("");
     EXPECT_NE(h, 0);
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include "thread_pool.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace diff_view;
+
+TEST(ThreadPool, RunsEveryIndexOnce) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+    for (const size_t count : {0, 1, 3, 1000}) {
+        std::vector<std::atomic<int>> runs(count);
+        pool.run(count, [&runs](const size_t i) { ++runs[i]; });
+        for (const auto& run : runs) {
+            EXPECT_EQ(run, 1);
+        }
+    }
+}
+
+TEST(ThreadPool, SingleThread) {
+    ThreadPool pool(1);
+    EXPECT_EQ(pool.size(), 1);
+    std::vector<size_t> order;
+    pool.run(5, [&order](const size_t i) { order.push_back(i); });
+    EXPECT_EQ(order, (std::vector<size_t>{0, 1, 2, 3, 4}));
+}
+
+TEST(ThreadPool, NestedRunStaysInline) {
+    ThreadPool pool(3);
+    std::atomic<size_t> total = 0;
+    pool.run(8, [&pool, &total](size_t) {
+        pool.run(10, [&total](size_t) { ++total; });
+    });
+    EXPECT_EQ(total, 80);
+}
+
+TEST(ThreadPool, RethrowsTaskException) {
+    ThreadPool pool(4);
+    EXPECT_THROW(pool.run(100, [](const size_t i) {
+        if (i == 42) {
+            throw std::runtime_error("task failed");
+        }
+    }), std::runtime_error);
+    // The pool stays usable
+    std::atomic<size_t> total = 0;
+    pool.run(100, [&total](size_t) { ++total; });
+    EXPECT_EQ(total, 100);
+}
+
+TEST(ThreadPool, ParallelForWithoutPool) {
+    std::vector<size_t> order;
+    parallel_for(nullptr, 4, [&order](const size_t i) { order.push_back(i); });
+    EXPECT_EQ(order, (std::vector<size_t>{0, 1, 2, 3}));
+}
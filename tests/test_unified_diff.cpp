@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include "unified_diff.h"
+
+#include <cstdio>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+using namespace diff_view;
+
+namespace {
+
+DiffResult diff_texts(const std::string_view old_text, const std::string_view new_text, const size_t context_lines = 3) {
+    return diff_lines(LineTable::view_with_endings(old_text), LineTable::view_with_endings(new_text),
+                      context_lines);
+}
+
+std::string unified(const DiffResult& result, const UnifiedDiffOptions& options = {}) {
+    std::string out;
+    EXPECT_TRUE(write_unified_diff(result, options, [&out](const std::span<const std::string_view> slices) {
+        for (const auto slice : slices) {
+            out += slice;
+        }
+        return true;
+    }));
+    return out;
+}
+
+} // namespace
+
+TEST(UnifiedDiff, NoChanges) {
+    const std::string text = "a\nb\n";
+    EXPECT_EQ(unified(diff_texts(text, text), {"a/x", "b/x"}), "");
+}
+
+TEST(UnifiedDiff, GitFormat) {
+    // As printed by `git diff --no-index`, headers aside
+    const std::string old_text = "a\nb\nc\nd\ne\nf\ng\nh\ni\nj\nk\nl\n";
+    const std::string new_text = "a\nB\nc\nd\ne\nf\ng\nh\ni\nj\nk\nl\nm";
+    EXPECT_EQ(unified(diff_texts(old_text, new_text), {"a/o1", "b/n1"}),
+              "--- a/o1\n"
+              "+++ b/n1\n"
+              "@@ -1,5 +1,5 @@\n"
+              " a\n"
+              "-b\n"
+              "+B\n"
+              " c\n"
+              " d\n"
+              " e\n"
+              "@@ -10,3 +10,4 @@ i\n"
+              " j\n"
+              " k\n"
+              " l\n"
+              "+m\n"
+              "\\ No newline at end of file\n");
+}
+
+TEST(UnifiedDiff, EmptySides) {
+    EXPECT_EQ(unified(diff_texts("", "x\ny\n")), "@@ -0,0 +1,2 @@\n+x\n+y\n");
+    EXPECT_EQ(unified(diff_texts("x\n", "")), "@@ -1 +0,0 @@\n-x\n");
+    EXPECT_EQ(unified(diff_texts("x\r\ny", "x\ny")), "@@ -1,2 +1,2 @@\n-x\r\n+x\n y\n\\ No newline at end of file\n");
+}
+
+TEST(UnifiedDiff, FunctionNames) {
+    const std::string long_name(100, 'f');
+    std::string old_text = long_name + " \t\n";
+    for (int i = 0; i < 20; ++i) {
+        old_text += i == 10 ? "_second()\n" : " body " + std::to_string(i) + "\n";
+    }
+    std::string new_text = old_text;
+    new_text.replace(new_text.find(" body 0"), 5, " BODY");    // Line 2
+    new_text.replace(new_text.find(" body 19"), 5, " BODY");  // Line 21
+    const auto result = diff_texts(old_text, new_text, 0);
+    ASSERT_EQ(result.hunks.size(), 2);
+    EXPECT_EQ(unified(result),
+              "@@ -2 +2 @@ " + long_name.substr(0, 80) + "\n- body 0\n+ BODY 0\n"
+              "@@ -21 +21 @@ _second()\n- body 19\n+ BODY 19\n");
+    EXPECT_EQ(unified(result, {"", "", false}),
+              "@@ -2 +2 @@\n- body 0\n+ BODY 0\n@@ -21 +21 @@\n- body 19\n+ BODY 19\n");
+
+    // A hunk with no name of its own keeps the previous one
+    const std::string old_body = "main\n 1\n 2\n 3\n 4\n 5\n 6\n 7\n 8\n 9\n";
+    const std::string new_body = "main\n 1\n x\n 3\n 4\n 5\n 6\n 7\n 8\n x\n";
+    const auto moved = diff_texts(old_body, new_body, 1);
+    ASSERT_EQ(moved.hunks.size(), 2);
+    EXPECT_EQ(unified(moved), "@@ -2,3 +2,3 @@ main\n  1\n- 2\n+ x\n  3\n@@ -9,2 +9,2 @@ main\n  8\n- 9\n+ x\n");
+}
+
+TEST(UnifiedDiff, LargeOutputInBatches) {
+    std::string old_text, new_text, expected = "@@ -1,3000 +1,3000 @@\n";
+    for (int i = 0; i < 3000; ++i) {
+        const std::string line = std::string(i % 200, 'x') + std::to_string(i) + "\n";
+        old_text += line;
+        new_text += "y" + line;
+        expected += "-" + line;
+    }
+    for (int i = 0; i < 3000; ++i) {
+        expected += "+y" + std::string(i % 200, 'x') + std::to_string(i) + "\n";
+    }
+    const auto result = diff_texts(old_text, new_text);
+    std::string out;
+    size_t batches = 0;
+    write_unified_diff(result, {}, [&](const std::span<const std::string_view> slices) {
+        ++batches;
+        EXPECT_LE(slices.size(), 1024);
+        for (const auto slice : slices) {
+            out += slice;
+        }
+        return true;
+    });
+    EXPECT_EQ(out, expected);
+    EXPECT_GT(batches, 1);
+}
+
+TEST(UnifiedDiff, SinkStops) {
+    std::string old_text, new_text;
+    for (int i = 0; i < 5000; ++i) {
+        old_text += std::string(100, 'a') + std::to_string(i) + "\n";
+        new_text += std::string(100, 'b') + std::to_string(i) + "\n";
+    }
+    size_t calls = 0;
+    EXPECT_FALSE(write_unified_diff(diff_texts(old_text, new_text), {}, [&](std::span<const std::string_view>) {
+        ++calls;
+        return false;
+    }));
+    EXPECT_EQ(calls, 1);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST(UnifiedDiff, FileDescriptor) {
+    const std::string old_text = "one\ntwo\nthree\n";
+    const std::string new_text = "one\n2\nthree\n";
+    const auto result = diff_texts(old_text, new_text);
+    std::FILE* file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    ASSERT_TRUE(write_unified_diff(result, {"old", "new"}, fileno(file)));
+    std::rewind(file);
+    std::string out(256, '\0');
+    out.resize(std::fread(out.data(), 1, out.size(), file));
+    std::fclose(file);
+    EXPECT_EQ(out, "--- old\n+++ new\n@@ -1,3 +1,3 @@\n one\n-two\n+2\n three\n");
+    EXPECT_EQ(out, unified(result, {"old", "new"}));
+}
+#endif
@@ -0,0 +1,82 @@
+#ifndef DIFF_VIEW_TEST_UTILS_H
+#define DIFF_VIEW_TEST_UTILS_H
+
+#include <gtest/gtest.h>
+#include "diff.h"
+#include "line_table.h"
+#include "view_model.h"
+
+#include <random>
+#include <string>
+
+namespace diff_view::test {
+
+/**
+ * Distinct lines "line 0", "line 1", ..., every `changed_every`-th one
+ * changed (0 = none).
+ */
+inline std::string numbered_lines(const size_t line_count, const size_t changed_every = 0) {
+    std::string text;
+    for (size_t i = 0; i < line_count; ++i) {
+        text += "line " + std::to_string(i) + (changed_every > 0 && i % changed_every == 0 ? " changed\n" : "\n");
+    }
+    return text;
+}
+
+/**
+ * Lines "line n" with n drawn below `alphabet`; about one line in
+ * `crlf_every` ends in "\r\n" (0 = none).
+ */
+inline std::string random_text(std::mt19937& rng, const size_t line_count, const unsigned alphabet,
+                               const unsigned crlf_every = 0) {
+    std::string text;
+    for (size_t i = 0; i < line_count; ++i) {
+        text += "line " + std::to_string(rng() % alphabet);
+        text += crlf_every > 0 && rng() % crlf_every == 0 ? "\r\n" : "\n";
+    }
+    return text;
+}
+
+/**
+ * The rows, highlights, connectors and folds of two view models are equal.
+ */
+inline void expect_same_rows(const ViewModel& actual, const ViewModel& expected) {
+    EXPECT_EQ(actual.lines, expected.lines);
+    EXPECT_EQ(actual.highlights, expected.highlights);
+    EXPECT_EQ(actual.connectors, expected.connectors);
+    EXPECT_EQ(actual.folds, expected.folds);
+}
+
+/**
+ * Two line tables hold the same lines and hashes.
+ */
+inline void expect_same_lines(const LineTable& actual, const LineTable& expected) {
+    EXPECT_EQ(actual.to_vector(), expected.to_vector());
+    EXPECT_EQ(actual.hashes(), expected.hashes());
+}
+
+/**
+ * Two line diffs have the same lines, hunks and flags.
+ */
+inline void expect_same_diff(const DiffResult& actual, const DiffResult& expected) {
+    expect_same_lines(actual.old_lines, expected.old_lines);
+    expect_same_lines(actual.new_lines, expected.new_lines);
+    EXPECT_EQ(actual.hunks, expected.hunks);
+    EXPECT_EQ(actual.approximate, expected.approximate);
+    EXPECT_EQ(actual.cancelled, expected.cancelled);
+}
+
+/**
+ * Two view models have the same lines, rows and flags.
+ */
+inline void expect_same_view_model(const ViewModel& actual, const ViewModel& expected) {
+    expect_same_lines(actual.old_lines, expected.old_lines);
+    expect_same_lines(actual.new_lines, expected.new_lines);
+    expect_same_rows(actual, expected);
+    EXPECT_EQ(actual.approximate, expected.approximate);
+    EXPECT_EQ(actual.cancelled, expected.cancelled);
+}
+
+} // namespace diff_view::test
+
+#endif //DIFF_VIEW_TEST_UTILS_H
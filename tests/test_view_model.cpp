@@ -1,6 +1,12 @@
 #include <gtest/gtest.h>
+#include "test_utils.h"
 #include "view_model.h"
 
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 using namespace diff_view;
 
 TEST(ViewModel, BothEmpty) {
@@ -145,3 +151,276 @@ TEST(ViewModel, BlankAlignment) {
     }
     EXPECT_TRUE(found_blank_right);
 }
+
+TEST(ViewModel, OwnsLineText) {
+    auto old_text = std::make_unique<std::string>("a\nb");
+    auto new_text = std::make_unique<std::string>("a\nc");
+    const auto vm = create_view_model(*old_text, *new_text);
+    old_text.reset();
+    new_text.reset();
+    ASSERT_EQ(vm.old_lines.size(), 2);
+    EXPECT_EQ(vm.old_lines[1], "b");
+    EXPECT_EQ(vm.new_lines[1], "c");
+}
+
+TEST(ViewModel, DiffOptions) {
+    DiffOptions options;
+    options.context_lines = 1;
+    options.algorithm = DiffAlgorithm::Histogram;
+    const auto vm = create_view_model("a\n}\nb\n}", "a\n}\nx\n}\nb\n}", options);
+    ASSERT_EQ(vm.connectors.size(), 1);
+    size_t added = 0;
+    for (const auto& [left, right] : vm.lines) {
+        if (right.kind == LineKind::Added) {
+            ++added;
+        }
+    }
+    EXPECT_EQ(added, 2);
+    EXPECT_EQ(vm.lines.size(), 6);
+}
+
+TEST(ViewModel, FoldIdentical) {
+    ViewOptions options;
+    options.fold_unchanged = true;
+    const auto vm = create_view_model(test::numbered_lines(1000), test::numbered_lines(1000), options);
+    ASSERT_EQ(vm.lines.size(), 1);
+    EXPECT_EQ(vm.lines[0].left.kind, LineKind::Folded);
+    EXPECT_EQ(vm.lines[0].left.line_no, 1);
+    ASSERT_EQ(vm.folds.size(), 1);
+    EXPECT_EQ(vm.folds[0].row, 0);
+    EXPECT_EQ(vm.folds[0].count, 1001);
+}
+
+TEST(ViewModel, FoldUnchangedRegions) {
+    auto new_text = test::numbered_lines(1000);
+    for (const std::string line : {"\nline 10\n", "\nline 500\n", "\nline 990\n"}) {
+        new_text.replace(new_text.find(line), line.size(), "\nX\n");
+    }
+    ViewOptions options;
+    options.diff.context_lines = 2;
+    options.fold_unchanged = true;
+    const auto folded = create_view_model(test::numbered_lines(1000), new_text, options);
+    options.fold_unchanged = false;
+    const auto full = create_view_model(test::numbered_lines(1000), new_text, options);
+
+    // 4 folds and 3 hunks of 6 rows: 2 + 2 context, one removed and one added
+    EXPECT_EQ(folded.lines.size(), 22);
+    ASSERT_EQ(folded.connectors.size(), 3);
+    ASSERT_EQ(folded.folds.size(), 4);
+    size_t hidden = 0;
+    for (const auto& [row, count] : folded.folds) {
+        EXPECT_EQ(folded.lines[row].left.kind, LineKind::Folded);
+        EXPECT_EQ(folded.lines[row].right.kind, LineKind::Folded);
+        hidden += count;
+    }
+    EXPECT_EQ(folded.lines.size() - 4 + hidden, full.lines.size());
+
+    // Expanding every fold gives back the full view model
+    auto expanded = folded;
+    for (size_t row = 0; row < expanded.lines.size(); ++row) {
+        row += expand_fold(expanded, row);
+    }
+    EXPECT_TRUE(expanded.folds.empty());
+    ASSERT_EQ(expanded.lines.size(), full.lines.size());
+    for (size_t row = 0; row < full.lines.size(); ++row) {
+        EXPECT_EQ(expanded.lines[row].left.kind, full.lines[row].left.kind);
+        EXPECT_EQ(expanded.lines[row].left.line_no, full.lines[row].left.line_no);
+        EXPECT_EQ(expanded.lines[row].right.line_no, full.lines[row].right.line_no);
+    }
+    ASSERT_EQ(expanded.highlights.size(), full.highlights.size());
+    for (size_t i = 0; i < full.highlights.size(); ++i) {
+        EXPECT_EQ(expanded.highlights[i].row, full.highlights[i].row);
+    }
+    for (size_t i = 0; i < full.connectors.size(); ++i) {
+        EXPECT_EQ(expanded.connectors[i].top, full.connectors[i].top);
+        EXPECT_EQ(expanded.connectors[i].bottom, full.connectors[i].bottom);
+    }
+}
+
+TEST(ViewModel, ExpandNonFoldedRow) {
+    auto vm = create_view_model("a\nb", "a\nc");
+    const auto rows = vm.lines.size();
+    EXPECT_EQ(expand_fold(vm, 0), 0);
+    EXPECT_EQ(expand_fold(vm, rows), 0);
+    EXPECT_EQ(vm.lines.size(), rows);
+}
+
+TEST(LazyViewModel, WindowsMatchFullViewModel) {
+    auto new_text = test::numbered_lines(300);
+    for (const std::string line : {"\nline 10\n", "\nline 150\n", "\nline 290\n"}) {
+        new_text.replace(new_text.find(line), line.size(), line + "inserted\n");
+    }
+    new_text.replace(new_text.find("\nline 200\n"), 10, "\nline 2000\n");
+    ViewOptions options;
+    options.diff.context_lines = 2;
+    const auto full = create_view_model(test::numbered_lines(300), new_text, options);
+    LazyViewModel lazy(test::numbered_lines(300), new_text, options);
+    ASSERT_EQ(lazy.row_count(), full.lines.size());
+    ASSERT_EQ(lazy.hunks().size(), full.connectors.size());
+    for (size_t i = 0; i < full.connectors.size(); ++i) {
+        EXPECT_EQ(lazy.hunks()[i].first_row, full.connectors[i].top);
+        EXPECT_EQ(lazy.hunks()[i].first_row + lazy.hunks()[i].row_count - 1, full.connectors[i].bottom);
+    }
+
+    for (const size_t size : {1, 7, 60}) {
+        size_t highlight_count = 0;
+        for (size_t begin = 0; begin < lazy.row_count(); begin += size) {
+            const auto window = lazy.rows(begin, begin + size);
+            EXPECT_EQ(window.begin, begin);
+            ASSERT_EQ(window.lines.size(), std::min(size, lazy.row_count() - begin));
+            for (size_t i = 0; i < window.lines.size(); ++i) {
+                EXPECT_EQ(window.lines[i].left.kind, full.lines[begin + i].left.kind);
+                EXPECT_EQ(window.lines[i].left.line_no, full.lines[begin + i].left.line_no);
+                EXPECT_EQ(window.lines[i].right.line_no, full.lines[begin + i].right.line_no);
+            }
+            for (const auto& highlight : window.highlights) {
+                EXPECT_GE(highlight.row, begin);
+                EXPECT_LT(highlight.row, begin + size);
+            }
+            for (const auto& connector : window.connectors) {
+                EXPECT_LT(connector.top, begin + size);
+                EXPECT_GE(connector.bottom, begin);
+            }
+            highlight_count += window.highlights.size();
+        }
+        EXPECT_EQ(highlight_count, full.highlights.size());
+    }
+}
+
+TEST(LazyViewModel, ClampsWindow) {
+    LazyViewModel lazy("a\nb", "a\nc");
+    EXPECT_EQ(lazy.row_count(), 3);
+    EXPECT_EQ(lazy.rows(1, 100).lines.size(), 2);
+    EXPECT_TRUE(lazy.rows(5, 10).lines.empty());
+    EXPECT_TRUE(lazy.rows(1, 0).lines.empty());
+}
+
+TEST(LazyViewModel, ExpandFold) {
+    auto new_text = test::numbered_lines(100);
+    new_text.replace(new_text.find("\nline 50\n"), 9, "\nX\n");
+    ViewOptions options;
+    options.diff.context_lines = 1;
+    options.fold_unchanged = true;
+    LazyViewModel lazy(test::numbered_lines(100), new_text, options);
+    const auto rows = lazy.row_count();
+    const auto window = lazy.rows(0, rows);
+    ASSERT_EQ(window.folds.size(), 2);
+    const auto [row, count] = window.folds[1];
+    EXPECT_EQ(lazy.expand_fold(row), count - 1);
+    EXPECT_EQ(lazy.row_count(), rows + count - 1);
+    EXPECT_EQ(lazy.expand_fold(row), 0);
+    const auto expanded = lazy.rows(row, row + count);
+    ASSERT_EQ(expanded.lines.size(), count);
+    EXPECT_EQ(expanded.lines[0].left.kind, LineKind::Context);
+    EXPECT_TRUE(expanded.folds.empty());
+}
+
+TEST(ViewModel, ParallelMatchesSerial) {
+    // Many hunks of modified, inserted and deleted lines
+    std::string old_text, new_text;
+    for (size_t i = 0; i < 2000; ++i) {
+        const auto line = "value" + std::to_string(i) + " = compute(" + std::to_string(i * 7 % 13) + ");\n";
+        old_text += line;
+        if (i % 11 == 0) {
+            new_text += "value" + std::to_string(i) + " = compute(" + std::to_string(i % 5) + ", 1);\n";
+        } else if (i % 17 == 0) {
+            new_text += line + "inserted" + std::to_string(i) + "\n";
+        } else if (i % 23 != 0) {
+            new_text += line;
+        }
+    }
+    ThreadPool pool(4);
+    for (const bool fold : {false, true}) {
+        ViewOptions options;
+        options.fold_unchanged = fold;
+        LazyViewModel serial_lazy(old_text, new_text, options);
+        const auto serial_stats = serial_lazy.similarity_stats();
+        const auto serial = std::move(serial_lazy).to_view_model();
+        options.pool = &pool;
+        LazyViewModel parallel_lazy(old_text, new_text, options);
+        EXPECT_EQ(parallel_lazy.similarity_stats().compared, serial_stats.compared);
+        EXPECT_EQ(parallel_lazy.similarity_stats().avoided(), serial_stats.avoided());
+        const auto parallel = std::move(parallel_lazy).to_view_model();
+
+        ASSERT_GT(serial.connectors.size(), 100);
+        test::expect_same_rows(parallel, serial);
+    }
+}
+
+TEST(ViewModel, Cancelled) {
+    CancelToken token;
+    token.cancel();
+    DiffOptions options;
+    options.cancel = &token;
+    const auto vm = create_view_model("a\nb\n", "a\nc\n", options);
+    EXPECT_TRUE(vm.cancelled);
+    EXPECT_TRUE(vm.lines.empty());
+    EXPECT_TRUE(vm.connectors.empty());
+
+    options.cancel = nullptr;
+    EXPECT_FALSE(create_view_model("a\nb\n", "a\nc\n", options).cancelled);
+}
+
+TEST(ViewModel, CancelledInEachPhase) {
+    std::string old_text, new_text;
+    for (size_t i = 0; i < 300; ++i) {
+        old_text += "line " + std::to_string(i) + "\n";
+        new_text += "line " + std::to_string(i) + (i % 10 == 0 ? " changed\n" : "\n");
+    }
+    ThreadPool pool(2);
+    for (const auto phase : {DiffPhase::Lines, DiffPhase::Pairing, DiffPhase::Highlights}) {
+        for (ThreadPool* view_pool : {static_cast<ThreadPool*>(nullptr), &pool}) {
+            CancelToken token;
+            ViewOptions options;
+            options.pool = view_pool;
+            options.diff.cancel = &token;
+            options.diff.progress = [&token, phase](const DiffPhase current, double) {
+                if (current == phase) {
+                    token.cancel();
+                }
+            };
+            LazyViewModel lazy(old_text, new_text, options);
+            EXPECT_EQ(lazy.cancelled(), phase != DiffPhase::Highlights);
+            const auto vm = std::move(lazy).to_view_model();
+            EXPECT_TRUE(vm.cancelled);
+            EXPECT_TRUE(vm.lines.empty());
+        }
+    }
+}
+
+TEST(ViewModel, Progress) {
+    std::string old_text, new_text;
+    for (size_t i = 0; i < 2000; ++i) {
+        old_text += "line " + std::to_string(i) + "\n";
+        new_text += "line " + std::to_string(i) + (i % 7 == 0 ? " changed\n" : "\n");
+    }
+    ThreadPool pool(4);
+    for (ThreadPool* view_pool : {static_cast<ThreadPool*>(nullptr), &pool}) {
+        std::vector<std::pair<DiffPhase, double>> reports;
+        ViewOptions options;
+        options.pool = view_pool;
+        options.diff.progress = [&reports](const DiffPhase phase, const double fraction) {
+            reports.emplace_back(phase, fraction);
+        };
+        const auto vm = create_view_model(old_text, new_text, options);
+        EXPECT_FALSE(vm.cancelled);
+        ASSERT_FALSE(vm.lines.empty());
+
+        // Every phase in order, each from 0 to 1 and rising
+        std::vector<DiffPhase> phases;
+        for (size_t i = 0; i < reports.size(); ++i) {
+            const auto [phase, fraction] = reports[i];
+            if (i == 0 || phase != reports[i - 1].first) {
+                phases.push_back(phase);
+                EXPECT_EQ(fraction, 0.0);
+            } else {
+                EXPECT_GT(fraction, reports[i - 1].second);
+            }
+            if (i + 1 == reports.size() || reports[i + 1].first != phase) {
+                EXPECT_EQ(fraction, 1.0);
+            }
+        }
+        EXPECT_EQ(phases, (std::vector{DiffPhase::Lines, DiffPhase::Pairing, DiffPhase::Highlights}));
+        EXPECT_LE(reports.size(), 2 + 101 * 2);
+    }
+}
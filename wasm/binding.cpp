@@ -1,15 +1,102 @@
+#include "packed_view_model.h"
 #include "view_model.h"
 #include <emscripten/bind.h>
 
 using namespace emscripten;
 using namespace diff_view;
 
+namespace {
+
+std::vector<std::string> get_old_lines(const ViewModel& vm) {
+    return vm.old_lines.to_vector();
+}
+
+void set_old_lines(ViewModel& vm, const std::vector<std::string>& lines) {
+    vm.old_lines = LineTable::from_lines(lines);
+}
+
+std::vector<std::string> get_new_lines(const ViewModel& vm) {
+    return vm.new_lines.to_vector();
+}
+
+void set_new_lines(ViewModel& vm, const std::vector<std::string>& lines) {
+    vm.new_lines = LineTable::from_lines(lines);
+}
+
+ViewModel create_folded_view_model(const std::string& old_text, const std::string& new_text, const uint32_t context) {
+    ViewOptions options;
+    options.diff.context_lines = context;
+    options.fold_unchanged = true;
+    return create_view_model(old_text, new_text, options);
+}
+
+ViewModel expand_fold_row(ViewModel vm, const uint32_t row) {
+    expand_fold(vm, row);
+    return vm;
+}
+
+LazyViewModel* create_lazy_view_model(const std::string& old_text, const std::string& new_text,
+                                      const uint32_t context, const bool fold) {
+    ViewOptions options;
+    options.diff.context_lines = context;
+    options.fold_unchanged = fold;
+    return new LazyViewModel(old_text, new_text, options);
+}
+
+uint32_t lazy_row_count(const LazyViewModel& lazy) {
+    return static_cast<uint32_t>(lazy.row_count());
+}
+
+std::string lazy_old_line(const LazyViewModel& lazy, const uint32_t index) {
+    return std::string(lazy.old_lines()[index]);
+}
+
+std::string lazy_new_line(const LazyViewModel& lazy, const uint32_t index) {
+    return std::string(lazy.new_lines()[index]);
+}
+
+PackedViewModel* create_packed_view_model(const std::string& old_text, const std::string& new_text,
+                                          const uint32_t context, const bool fold) {
+    ViewOptions options;
+    options.diff.context_lines = context;
+    options.fold_unchanged = fold;
+    return new PackedViewModel(pack_view_model(create_view_model(old_text, new_text, options)));
+}
+
+// Views of WASM memory: valid until the packed model is deleted or the memory grows
+val packed_rows(const PackedViewModel& packed) {
+    return val(typed_memory_view(packed.rows.size(), packed.rows.data()));
+}
+
+val packed_highlights(const PackedViewModel& packed) {
+    return val(typed_memory_view(packed.highlights.size(), packed.highlights.data()));
+}
+
+val packed_connectors(const PackedViewModel& packed) {
+    return val(typed_memory_view(packed.connectors.size(), packed.connectors.data()));
+}
+
+val packed_folds(const PackedViewModel& packed) {
+    return val(typed_memory_view(packed.folds.size(), packed.folds.data()));
+}
+
+val packed_text(const PackedViewModel& packed) {
+    return val(typed_memory_view(packed.text.size(), reinterpret_cast<const uint8_t*>(packed.text.data())));
+}
+
+val packed_line_offsets(const PackedViewModel& packed) {
+    return val(typed_memory_view(packed.line_offsets.size(), packed.line_offsets.data()));
+}
+
+} // namespace
+
 EMSCRIPTEN_BINDINGS(DiffViewWASM) {
     enum_<LineKind>("LineKind")
         .value("Blank", LineKind::Blank)
         .value("Context", LineKind::Context)
         .value("Removed", LineKind::Removed)
-        .value("Added", LineKind::Added);
+        .value("Added", LineKind::Added)
+        .value("Folded", LineKind::Folded);
 
     value_object<SideInfo>("SideInfo")
         .field("kind", &SideInfo::kind)
@@ -33,17 +120,63 @@ EMSCRIPTEN_BINDINGS(DiffViewWASM) {
         .field("rightStart", &Connector::right_start)
         .field("rightEnd", &Connector::right_end);
 
+    value_object<Fold>("Fold")
+        .field("row", &Fold::row)
+        .field("count", &Fold::count);
+
     register_vector<std::string>("VectorString");
     register_vector<ViewLine>("VectorViewLine");
     register_vector<InlineHighlight>("VectorInlineHighlight");
     register_vector<Connector>("VectorConnector");
+    register_vector<Fold>("VectorFold");
+    register_vector<HunkRows>("VectorHunkRows");
 
     value_object<ViewModel>("ViewModel")
-        .field("oldLines", &ViewModel::old_lines)
-        .field("newLines", &ViewModel::new_lines)
+        .field("oldLines", &get_old_lines, &set_old_lines)
+        .field("newLines", &get_new_lines, &set_new_lines)
         .field("lines", &ViewModel::lines)
         .field("highlights", &ViewModel::highlights)
-        .field("connectors", &ViewModel::connectors);
+        .field("connectors", &ViewModel::connectors)
+        .field("folds", &ViewModel::folds)
+        .field("approximate", &ViewModel::approximate)
+        .field("cancelled", &ViewModel::cancelled);
+
+    value_object<HunkRows>("HunkRows")
+        .field("firstRow", &HunkRows::first_row)
+        .field("rowCount", &HunkRows::row_count);
+
+    value_object<ViewWindow>("ViewWindow")
+        .field("begin", &ViewWindow::begin)
+        .field("lines", &ViewWindow::lines)
+        .field("highlights", &ViewWindow::highlights)
+        .field("connectors", &ViewWindow::connectors)
+        .field("folds", &ViewWindow::folds);
+
+    class_<LazyViewModel>("LazyViewModel")
+        .constructor(&create_lazy_view_model, allow_raw_pointers())
+        .function("rowCount", &lazy_row_count)
+        .function("hunks", &LazyViewModel::hunks)
+        .function("rows", &LazyViewModel::rows)
+        .function("expandFold", &LazyViewModel::expand_fold)
+        .function("oldLine", &lazy_old_line)
+        .function("newLine", &lazy_new_line)
+        .function("approximate", &LazyViewModel::approximate);
+
+    class_<PackedViewModel>("PackedViewModel")
+        .constructor(&create_packed_view_model, allow_raw_pointers())
+        .function("rows", &packed_rows)
+        .function("highlights", &packed_highlights)
+        .function("connectors", &packed_connectors)
+        .function("folds", &packed_folds)
+        .function("text", &packed_text)
+        .function("lineOffsets", &packed_line_offsets)
+        .property("oldLineCount", &PackedViewModel::old_line_count)
+        .property("newLineCount", &PackedViewModel::new_line_count)
+        .property("approximate", &PackedViewModel::approximate)
+        .property("cancelled", &PackedViewModel::cancelled);
 
-    function("createViewModel", &create_view_model);
+    function("createViewModel",
+             select_overload<ViewModel(const std::string&, const std::string&, uint32_t)>(&create_view_model));
+    function("createFoldedViewModel", &create_folded_view_model);
+    function("expandFold", &expand_fold_row);
 }
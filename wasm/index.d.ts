@@ -6,9 +6,10 @@ export const LineKind: {
     readonly Context: 1;
     readonly Removed: 2;
     readonly Added: 3;
+    readonly Folded: 4;
 };
 
-export type LineKindValue = 0 | 1 | 2 | 3;
+export type LineKindValue = 0 | 1 | 2 | 3 | 4;
 
 export function getKindValue(kind: unknown): LineKindValue;
 
@@ -38,6 +39,11 @@ export interface Connector {
     rightEnd: number;
 }
 
+export interface Fold {
+    row: number;
+    count: number;
+}
+
 export interface WasmVector<T> {
     size(): number;
     get(index: number): T;
@@ -49,9 +55,68 @@ export interface ViewModel {
     lines: WasmVector<ViewLine>;
     highlights: WasmVector<InlineHighlight>;
     connectors: WasmVector<Connector>;
+    folds: WasmVector<Fold>;
+    approximate: boolean;
+    cancelled: boolean;
+}
+
+export function createViewModel(oldText: string, newText: string, context?: number, fold?: boolean): ViewModel;
+
+export function expandFold(vm: ViewModel, row: number): ViewModel;
+
+export interface HunkRows {
+    firstRow: number;
+    rowCount: number;
+}
+
+export interface ViewWindow {
+    begin: number;
+    lines: WasmVector<ViewLine>;
+    highlights: WasmVector<InlineHighlight>;
+    connectors: WasmVector<Connector>;
+    folds: WasmVector<Fold>;
 }
 
-export function createViewModel(oldText: string, newText: string, context?: number): ViewModel;
+export interface LazyViewModel {
+    rowCount(): number;
+    hunks(): WasmVector<HunkRows>;
+    rows(begin: number, end: number): ViewWindow;
+    expandFold(row: number): number;
+    oldLine(index: number): string;
+    newLine(index: number): string;
+    approximate(): boolean;
+    delete(): void;
+}
+
+export function createLazyViewModel(oldText: string, newText: string, context?: number, fold?: boolean): LazyViewModel;
+
+export const PACKED_ROW_STRIDE: 4;
+export const PACKED_HIGHLIGHT_STRIDE: 4;
+export const PACKED_CONNECTOR_STRIDE: 6;
+export const PACKED_FOLD_STRIDE: 2;
+
+export interface PackedViewModel {
+    // Per row: left kind, left lineNo, right kind, right lineNo
+    rows: Uint32Array;
+    // Per highlight: row, start, end, isLeft (0 or 1)
+    highlights: Uint32Array;
+    // Per connector: top, bottom, leftStart, leftEnd, rightStart, rightEnd
+    connectors: Uint32Array;
+    // Per fold: row, count
+    folds: Uint32Array;
+    // UTF-8 text of the old lines, then the new lines, without line endings
+    text: Uint8Array;
+    // Line i of text is text[lineOffsets[i], lineOffsets[i + 1])
+    lineOffsets: Uint32Array;
+    oldLineCount: number;
+    newLineCount: number;
+    approximate: boolean;
+    cancelled: boolean;
+}
+
+export function createPackedViewModel(oldText: string, newText: string, context?: number, fold?: boolean): PackedViewModel;
+
+export function getPackedLine(packed: PackedViewModel, lineNo: number, isLeft: boolean): string;
 
 export function toArray<T>(vec: WasmVector<T>): T[];
 
@@ -73,6 +138,10 @@ export interface ProcessedViewModel {
     lines: ProcessedLine[];
     highlights: InlineHighlight[];
     connectors: Connector[];
+    folds: Fold[];
+    approximate: boolean;
 }
 
 export function processViewModel(vm: ViewModel): ProcessedViewModel;
+
+export function processPackedViewModel(packed: PackedViewModel): ProcessedViewModel;
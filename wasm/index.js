@@ -21,6 +21,7 @@ export const LineKind = {
     Context: 1,
     Removed: 2,
     Added: 3,
+    Folded: 4,
 };
 
 // Extract numeric value from embind enum (handles both plain numbers and embind enum objects)
@@ -36,10 +37,64 @@ export function getKindValue(kind) {
     return kind;
 }
 
-export function createViewModel(oldText, newText, context = 3) {
+export function createViewModel(oldText, newText, context = 3, fold = false) {
+    if (fold) {
+        return getModule().createFoldedViewModel(oldText, newText, context);
+    }
     return getModule().createViewModel(oldText, newText, context);
 }
 
+// Rows are built on demand with lazy.rows(begin, end); call lazy.delete() when done
+export function createLazyViewModel(oldText, newText, context = 3, fold = false) {
+    const module = getModule();
+    return new module.LazyViewModel(oldText, newText, context, fold);
+}
+
+// Returns a new view model with the folded row at `row` replaced by its lines
+export function expandFold(vm, row) {
+    return getModule().expandFold(vm, row);
+}
+
+// Numbers per row, highlight, connector and fold in the arrays of a packed view model
+export const PACKED_ROW_STRIDE = 4;
+export const PACKED_HIGHLIGHT_STRIDE = 4;
+export const PACKED_CONNECTOR_STRIDE = 6;
+export const PACKED_FOLD_STRIDE = 2;
+
+// The view model as typed arrays, each copied out of WASM memory in one go
+export function createPackedViewModel(oldText, newText, context = 3, fold = false) {
+    const module = getModule();
+    const packed = new module.PackedViewModel(oldText, newText, context, fold);
+    try {
+        // The views are only valid until the memory grows: copy them right away
+        return {
+            rows: packed.rows().slice(),
+            highlights: packed.highlights().slice(),
+            connectors: packed.connectors().slice(),
+            folds: packed.folds().slice(),
+            text: packed.text().slice(),
+            lineOffsets: packed.lineOffsets().slice(),
+            oldLineCount: packed.oldLineCount,
+            newLineCount: packed.newLineCount,
+            approximate: packed.approximate,
+            cancelled: packed.cancelled,
+        };
+    } finally {
+        packed.delete();
+    }
+}
+
+const textDecoder = new TextDecoder();
+
+// Text of a 1-based line of a packed view model, '' for 0
+export function getPackedLine(packed, lineNo, isLeft) {
+    if (lineNo === 0) {
+        return '';
+    }
+    const index = (isLeft ? 0 : packed.oldLineCount) + lineNo - 1;
+    return textDecoder.decode(packed.text.subarray(packed.lineOffsets[index], packed.lineOffsets[index + 1]));
+}
+
 export function toArray(vec) {
     const arr = [];
     for (let i = 0; i < vec.size(); i++) {
@@ -49,7 +104,8 @@ export function toArray(vec) {
 }
 
 export function getLineContent(vm, side, isLeft) {
-    if (getKindValue(side.kind) === LineKind.Blank || side.lineNo === 0) {
+    const kind = getKindValue(side.kind);
+    if (kind === LineKind.Blank || kind === LineKind.Folded || side.lineNo === 0) {
         return '';
     }
     const lines = isLeft ? vm.oldLines : vm.newLines;
@@ -87,5 +143,52 @@ export function processViewModel(vm) {
         rightEnd: c.rightEnd,
     }));
 
-    return { lines, highlights, connectors };
+    const folds = toArray(vm.folds).map(f => ({
+        row: f.row,
+        count: f.count,
+    }));
+
+    return { lines, highlights, connectors, folds, approximate: vm.approximate };
+}
+
+function processPackedSide(packed, kind, lineNo, isLeft) {
+    const hasContent = kind !== LineKind.Blank && kind !== LineKind.Folded;
+    return { kind, lineNo, content: hasContent ? getPackedLine(packed, lineNo, isLeft) : '' };
+}
+
+// Same result as processViewModel, read from the arrays of createPackedViewModel
+export function processPackedViewModel(packed) {
+    const { rows, highlights: h, connectors: c, folds: f } = packed;
+    const lines = [];
+    for (let i = 0; i < rows.length; i += PACKED_ROW_STRIDE) {
+        lines.push({
+            index: i / PACKED_ROW_STRIDE,
+            left: processPackedSide(packed, rows[i], rows[i + 1], true),
+            right: processPackedSide(packed, rows[i + 2], rows[i + 3], false),
+        });
+    }
+
+    const highlights = [];
+    for (let i = 0; i < h.length; i += PACKED_HIGHLIGHT_STRIDE) {
+        highlights.push({ row: h[i], start: h[i + 1], end: h[i + 2], isLeft: h[i + 3] !== 0 });
+    }
+
+    const connectors = [];
+    for (let i = 0; i < c.length; i += PACKED_CONNECTOR_STRIDE) {
+        connectors.push({
+            top: c[i],
+            bottom: c[i + 1],
+            leftStart: c[i + 2],
+            leftEnd: c[i + 3],
+            rightStart: c[i + 4],
+            rightEnd: c[i + 5],
+        });
+    }
+
+    const folds = [];
+    for (let i = 0; i < f.length; i += PACKED_FOLD_STRIDE) {
+        folds.push({ row: f[i], count: f[i + 1] });
+    }
+
+    return { lines, highlights, connectors, folds, approximate: packed.approximate };
 }
@@ -1,5 +1,8 @@
 import { describe, it, expect, beforeAll } from 'vitest';
-import { init, createViewModel, processViewModel, toArray, LineKind, getKindValue } from '../index.js';
+import {
+    init, createViewModel, createLazyViewModel, createPackedViewModel, expandFold, getPackedLine,
+    processViewModel, processPackedViewModel, toArray, LineKind, getKindValue, PACKED_ROW_STRIDE,
+} from '../index.js';
 
 beforeAll(async () => {
     await init();
@@ -53,6 +56,34 @@ describe('createViewModel', () => {
         expect(connectors.length).toBe(1);
         expect(connectors[0].top).toBeLessThanOrEqual(connectors[0].bottom);
     });
+
+    it('folds unchanged regions on request', () => {
+        const oldText = Array.from({ length: 100 }, (_, i) => `${i}`).join('\n');
+        const newText = oldText.replace('\n50\n', '\nX\n');
+        const vm = createViewModel(oldText, newText, 1, true);
+        const folds = toArray(vm.folds);
+        expect(folds.length).toBe(2);
+        expect(getKindValue(vm.lines.get(folds[0].row).left.kind)).toBe(LineKind.Folded);
+
+        const expanded = expandFold(vm, folds[0].row);
+        expect(toArray(expanded.folds).length).toBe(1);
+        expect(expanded.lines.size()).toBe(vm.lines.size() + folds[0].count - 1);
+    });
+});
+
+describe('createLazyViewModel', () => {
+    it('builds only the requested rows', () => {
+        const oldText = Array.from({ length: 1000 }, (_, i) => `${i}`).join('\n');
+        const newText = oldText.replace('\n500\n', '\nX\n');
+        const full = createViewModel(oldText, newText);
+        const lazy = createLazyViewModel(oldText, newText);
+        expect(lazy.rowCount()).toBe(full.lines.size());
+        const window = lazy.rows(490, 510);
+        expect(window.begin).toBe(490);
+        expect(window.lines.size()).toBe(20);
+        expect(window.connectors.size()).toBe(1);
+        lazy.delete();
+    });
 });
 
 describe('processViewModel', () => {
@@ -88,12 +119,36 @@ describe('processViewModel', () => {
     });
 });
 
+describe('createPackedViewModel', () => {
+    it('matches processViewModel', () => {
+        const oldText = Array.from({ length: 100 }, (_, i) => `line ${i} 你好`).join('\n');
+        const newText = oldText.replace('line 50 你好', 'line 50 世界').replace('line 80 你好\n', '');
+        for (const fold of [false, true]) {
+            const packed = createPackedViewModel(oldText, newText, 2, fold);
+            expect(packed.rows).toBeInstanceOf(Uint32Array);
+            expect(packed.rows.length / PACKED_ROW_STRIDE).toBe(createViewModel(oldText, newText, 2, fold).lines.size());
+            expect(processPackedViewModel(packed)).toEqual(processViewModel(createViewModel(oldText, newText, 2, fold)));
+        }
+    });
+
+    it('stores the lines in one blob', () => {
+        const packed = createPackedViewModel('a\nb', 'a\nc\nd');
+        expect(packed.oldLineCount).toBe(2);
+        expect(packed.newLineCount).toBe(3);
+        expect(packed.lineOffsets.length).toBe(6);
+        expect(getPackedLine(packed, 2, true)).toBe('b');
+        expect(getPackedLine(packed, 3, false)).toBe('d');
+        expect(getPackedLine(packed, 0, false)).toBe('');
+    });
+});
+
 describe('LineKind', () => {
     it('has correct values', () => {
         expect(LineKind.Blank).toBe(0);
         expect(LineKind.Context).toBe(1);
         expect(LineKind.Removed).toBe(2);
         expect(LineKind.Added).toBe(3);
+        expect(LineKind.Folded).toBe(4);
     });
 });
 
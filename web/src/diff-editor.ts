@@ -1,5 +1,5 @@
 // @ts-ignore
-import { createViewModel, processViewModel } from '../../wasm/index.js';
+import { createPackedViewModel, processPackedViewModel } from '../../wasm/index.js';
 import type { Elements, State } from './types';
 import { DIFF_DEBOUNCE_MS } from './constants';
 import { queryElements } from './utils';
@@ -325,8 +325,8 @@ export class DiffEditor {
     const oldText = this.el.leftEditor.value;
     const newText = this.el.rightEditor.value;
 
-    const vm = createViewModel(oldText, newText);
-    this.state.diffResult = processViewModel(vm);
+    const packed = createPackedViewModel(oldText, newText);
+    this.state.diffResult = processPackedViewModel(packed);
 
     updateEditor(this.state, this.el, 'left');
     updateEditor(this.state, this.el, 'right');